@@ -85,7 +85,10 @@ LOCAL_C_INCLUDES := \
   $(LOCAL_PATH)/src
 
 LOCAL_SRC_FILES := \
+  src/allocation_tracker.cpp \
   src/camera.cpp \
+  src/component_profiler.cpp \
+  src/component_scheduler.cpp \
   src/components/attributes.cpp \
   src/components/audio_listener.cpp \
   src/components/lap_dependent.cpp \
@@ -105,14 +108,19 @@ LOCAL_SRC_FILES := \
   src/components/time_limit.cpp \
   src/default_entity_factory.cpp \
   src/default_graph_factory.cpp \
+  src/frame_pacer.cpp \
+  src/frame_profiler.cpp \
   src/full_screen_fader.cpp \
   src/game.cpp \
   src/gpg_manager.cpp \
   src/gui.cpp \
   src/inputcontrollers/android_cardboard_controller.cpp \
   src/inputcontrollers/gamepad_controller.cpp \
+  src/inputcontrollers/headless_controller.cpp \
   src/inputcontrollers/onscreen_controller.cpp \
+  src/intercept_kernel.cpp \
   src/main.cpp \
+  src/mapped_file.cpp \
   src/modules/attributes.cpp \
   src/modules/gpg.cpp \
   src/modules/patron.cpp \
@@ -121,7 +129,10 @@ LOCAL_SRC_FILES := \
   src/modules/state.cpp \
   src/modules/ui_string.cpp \
   src/modules/zooshi.cpp \
+  src/projectile_grid.cpp \
+  src/rail_denizen_kernel.cpp \
   src/railmanager.cpp \
+  src/render_snapshot.cpp \
   src/states/game_menu_state.cpp \
   src/states/game_over_state.cpp \
   src/states/gameplay_state.cpp \
@@ -130,7 +141,10 @@ LOCAL_SRC_FILES := \
   src/states/pause_state.cpp \
   src/states/states_common.cpp \
   src/states/scene_lab_state.cpp \
+  src/stress_scene.cpp \
+  src/trace.cpp \
   src/unlockable_manager.cpp \
+  src/worker_pool.cpp \
   src/world.cpp \
   src/world_renderer.cpp \
   src/xp_system.cpp
@@ -26,8 +26,11 @@ generated files, you can call this script with the argument 'clean'.
 
 import sys
 import glob
+import math
 import os
 import json
+import struct
+import subprocess
 
 # The project root directory, which is two levels up from this script's
 # directory.
@@ -63,6 +66,25 @@ ASSET_META = os.path.join(RAW_ASSETS_PATH, 'asset_meta.json')
 # Directory where unprocessed rail flatbuffer data can be found.
 RAW_RAIL_PATH = os.path.join(RAW_ASSETS_PATH, 'rails')
 
+# Directory where baked rails are written, and the extension they're given.
+BAKED_RAIL_PATH = os.path.join(ASSETS_PATH, 'rails')
+BAKED_RAIL_EXTENSION = '.zoorail'
+
+# Directory where the sources of baked rails are written.
+INTERMEDIATE_RAIL_PATH = os.path.join(PROJECT_ROOT, 'obj', 'assets', 'rails')
+
+# Entity files which may hold RailNode entities, whose rails are baked.
+RAIL_ENTITY_FILES = ([os.path.join(RAW_ASSETS_PATH, 'entity_rails.json')] +
+                     glob.glob(os.path.join(RAW_ASSETS_PATH, 'lvl_*.json')))
+
+# Where to look for the zooshi_headless binary, which bakes the rails.
+RAIL_BAKER_PATHS = [os.path.join(PROJECT_ROOT, 'bin', 'zooshi_headless'),
+                    os.path.join(PROJECT_ROOT, 'bin', 'zooshi_headless.exe')]
+
+# Positions and times are rounded to this many steps per unit when hashed.
+# Must match kBakedRailHashScale in src/railmanager.cpp.
+BAKED_RAIL_HASH_SCALE = 1000.0
+
 # Directory where unprocessed event graph flatbuffer data can be found.
 RAW_GRAPH_DEF_PATH = os.path.join(RAW_ASSETS_PATH, 'graphs')
 
@@ -214,6 +236,175 @@ def anim_files_to_convert():
   return glob.glob(os.path.join(RAW_ANIM_PATH, '*.fbx'))
 
 
+def strip_json_comments(text):
+  """Remove the // comments that flatc accepts in JSON, outside of strings.
+
+  Args:
+    text: JSON text, possibly with comments.
+
+  Returns:
+    The text without comments.
+  """
+  result = []
+  in_string = False
+  i = 0
+  while i < len(text):
+    c = text[i]
+    if in_string:
+      result.append(c)
+      if c == '\\' and i + 1 < len(text):
+        result.append(text[i + 1])
+        i += 1
+      elif c == '"':
+        in_string = False
+    elif c == '"':
+      in_string = True
+      result.append(c)
+    elif text.startswith('//', i):
+      while i < len(text) and text[i] != '\n':
+        i += 1
+      continue
+    else:
+      result.append(c)
+    i += 1
+  return ''.join(result)
+
+
+def rails_in_entity_file(entity_file):
+  """Find the rails made of RailNode entities in an entity file.
+
+  Args:
+    entity_file: Path of a JSON entity file.
+
+  Returns:
+    A dict from rail name to a list of (ordering, RailNodeDef data, position)
+    tuples, one per node, in the order they're defined.
+  """
+  with open(entity_file) as f:
+    entities = json.loads(strip_json_comments(f.read()))
+  rails = {}
+  for entity in entities.get('entity_list', []):
+    components = dict((component['data_type'], component.get('data', {}))
+                      for component in entity.get('component_list', []))
+    node = components.get('RailNodeDef')
+    if node is None or 'rail_name' not in node:
+      continue
+    position = components.get('corgi_TransformDef', {}).get('position', {})
+    rails.setdefault(node['rail_name'], []).append(
+        (node.get('ordering', 0.0), node,
+         [position.get(axis, 0.0) for axis in ('x', 'y', 'z')]))
+  return rails
+
+
+def baked_rail_hash(positions, reliable_distance, total_time, wraps):
+  """Hash what a rail is fit to, as BakedRailFileName() does at runtime.
+
+  Args:
+    positions: The rail's node positions, with the first repeated at the end
+      if it wraps.
+    reliable_distance: The rail's reliable distance.
+    total_time: The rail's total time.
+    wraps: Whether the rail wraps.
+
+  Returns:
+    The hash, as 16 hex digits.
+  """
+  fnv_prime = 1099511628211
+  mask = (1 << 64) - 1
+  result = [14695981039346656037]
+
+  def add_byte(byte):
+    result[0] = ((result[0] ^ byte) * fnv_prime) & mask
+
+  def add(value):
+    single = struct.unpack('<f', struct.pack('<f', value))[0]
+    rounded = int(math.floor(single * BAKED_RAIL_HASH_SCALE + 0.5))
+    for byte in struct.pack('<I', rounded & 0xffffffff):
+      add_byte(byte if isinstance(byte, int) else ord(byte))
+
+  for position in positions:
+    for value in position:
+      add(value)
+  add(reliable_distance)
+  add(total_time)
+  add_byte(1 if wraps else 0)
+  return '%016x' % result[0]
+
+
+def find_rail_baker():
+  """Path of the zooshi_headless binary, or None if it hasn't been built."""
+  baker = os.environ.get('ZOOSHI_HEADLESS')
+  if baker and os.path.isfile(baker):
+    return baker
+  for path in RAIL_BAKER_PATHS:
+    if os.path.isfile(path):
+      return path
+  return None
+
+
+def bake_rails():
+  """Bake the rails made of RailNode entities, so they needn't be fit at load.
+
+  Each rail's nodes are written to a source file, which zooshi_headless fits
+  a rail to and bakes into `BAKED_RAIL_PATH`. The baked rail's name includes a
+  hash of what it's fit to, so the game only finds it if the level still has
+  the same rail. Rails that aren't baked are fit when they're loaded, so
+  baking is skipped if zooshi_headless hasn't been built.
+
+  Returns:
+    0 on success.
+  """
+  baker = find_rail_baker()
+  if baker is None:
+    print('zooshi_headless not found, skipping rail baking.')
+    return 0
+  for directory in (INTERMEDIATE_RAIL_PATH, BAKED_RAIL_PATH):
+    if not os.path.isdir(directory):
+      os.makedirs(directory)
+
+  for entity_file in RAIL_ENTITY_FILES:
+    for rail_name, nodes in sorted(rails_in_entity_file(entity_file).items()):
+      # Later nodes replace earlier ones with the same ordering, and the rail's
+      # settings come from the node that's first in order, as in RailManager.
+      by_ordering = {}
+      for ordering, node, position in nodes:
+        by_ordering[ordering] = (node, position)
+      ordered = [by_ordering[ordering] for ordering in sorted(by_ordering)]
+      first = ordered[0][0]
+      # Zero means unset, which RailNodeComponent stores as -1.
+      total_time = first.get('total_time', 0.0) or -1.0
+      reliable_distance = first.get('reliable_distance', 0.0) or -1.0
+      wraps = first.get('wraps', True)
+      positions = [position for _, position in ordered]
+      hashed_positions = positions + ([positions[0]] if wraps else [])
+
+      name = '%s_%s' % (rail_name, baked_rail_hash(
+          hashed_positions, reliable_distance, total_time, wraps))
+      source = os.path.join(INTERMEDIATE_RAIL_PATH, name + '.txt')
+      baked = os.path.join(BAKED_RAIL_PATH, name + BAKED_RAIL_EXTENSION)
+      if (os.path.exists(baked) and
+          os.path.getmtime(baked) >= os.path.getmtime(entity_file) and
+          os.path.getmtime(baked) >= os.path.getmtime(baker)):
+        continue
+      with open(source, 'w') as f:
+        f.write('%r %r %d\n' % (float(total_time), float(reliable_distance),
+                                 1 if wraps else 0))
+        for position in positions:
+          f.write('%r %r %r\n' % tuple(float(value) for value in position))
+      if subprocess.call([baker, 'bake_rail', source, baked]) != 0:
+        print('Failed to bake rail %s from %s.' % (rail_name, entity_file))
+        return 1
+  return 0
+
+
+def clean_baked_rails():
+  """Delete the baked rails and their sources."""
+  for path in (glob.glob(os.path.join(BAKED_RAIL_PATH,
+                                      '*' + BAKED_RAIL_EXTENSION)) +
+               glob.glob(os.path.join(INTERMEDIATE_RAIL_PATH, '*.txt'))):
+    os.remove(path)
+
+
 def main():
   """Builds or cleans the assets needed for the game.
 
@@ -221,12 +412,13 @@ def main():
   alternatively, call it with the argument 'all'. To just convert the
   flatbuffer json files, call it with 'flatbuffers'. Likewise to convert the
   png files to webp files, call it with 'webp'. To clean all converted files,
-  call it with 'clean'.
+  call it with 'clean'. Rails are baked after the other assets are built, if
+  zooshi_headless has been built.
 
   Returns:
     Returns 0 on success.
   """
-  return builder.main(
+  result = builder.main(
       project_root=PROJECT_ROOT,
       assets_path=ASSETS_PATH,
       asset_meta=ASSET_META,
@@ -239,6 +431,12 @@ def main():
       fbx_files_to_convert=fbx_files_to_convert,
       flatbuffers_conversion_data=lambda: FLATBUFFERS_CONVERSION_DATA,
       schema_output_path='flatbufferschemas')
+  if result != 0:
+    return result
+  if 'clean' in sys.argv[1:]:
+    clean_baked_rails()
+    return 0
+  return bake_rails()
 
 
 if __name__ == '__main__':
@@ -0,0 +1,309 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "allocation_tracker.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+#include "fplbase/utilities.h"
+
+using fplbase::LogInfo;
+
+namespace fpl {
+namespace zooshi {
+
+#if ZOOSHI_TRACK_ALLOCATIONS
+
+// Threads past this many share the last slot.
+static const int kMaxThreads = 16;
+
+// Scopes per thread. Past this many, allocations count against the last one.
+static const int kMaxScopes = 64;
+
+// Allocations inside markers nested deeper than this count against the
+// deepest marker within the limit.
+static const int kMaxScopeDepth = 32;
+
+// Frames ignored after a reset, while caches fill and pools grow.
+static const int kWarmupFrames = 60;
+
+// Scopes listed per thread by AllocationLogStats().
+static const int kScopesToLog = 5;
+
+static const char kUntaggedScope[] = "(untagged)";
+static const char kOtherScopes[] = "(other)";
+
+// Allocation counts of one scope on one thread. The counts are written by the
+// thread that owns them, and everything else by whichever thread calls
+// AllocationFrameEnd().
+struct ScopeAllocations {
+  std::atomic<const char*> name;
+  std::atomic<uint64_t> count;
+
+  uint64_t last_count;
+  uint64_t total_count;
+};
+
+struct ThreadAllocations {
+  std::atomic<const char*> name;
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> bytes;
+  std::atomic<int> scope_count;
+  ScopeAllocations scopes[kMaxScopes];
+
+  uint64_t last_count;
+  uint64_t last_bytes;
+  uint64_t total_count;
+  uint64_t total_bytes;
+  uint64_t max_count;
+};
+
+// Per-thread bookkeeping.
+struct ThreadState {
+  ThreadAllocations* allocations;
+  const char* scopes[kMaxScopeDepth];
+  int depth;
+
+  // Set while the tracker is itself allocating, e.g. to log.
+  bool ignore;
+};
+
+// Everything here is plain data, so it is zero initialized before any
+// constructor can allocate.
+static ThreadAllocations thread_allocations[kMaxThreads];
+static std::atomic<int> thread_count;
+static thread_local ThreadState thread_state;
+
+static std::atomic<bool> reset_requested;
+static int warmup_frames_left;
+static int tracked_frames;
+static int log_interval;
+
+static ThreadAllocations* AllocationsForThread(ThreadState* state) {
+  if (!state->allocations) {
+    const int index = thread_count.fetch_add(1, std::memory_order_relaxed);
+    state->allocations = &thread_allocations[std::min(index, kMaxThreads - 1)];
+  }
+  return state->allocations;
+}
+
+// Find or add the counter for `scope`. Only the owning thread adds scopes.
+static ScopeAllocations* FindScope(ThreadAllocations* allocations,
+                                   const char* scope) {
+  const int count = allocations->scope_count.load(std::memory_order_relaxed);
+  for (int i = 0; i < count; ++i) {
+    if (allocations->scopes[i].name.load(std::memory_order_relaxed) == scope) {
+      return &allocations->scopes[i];
+    }
+  }
+  ScopeAllocations* last = &allocations->scopes[kMaxScopes - 1];
+  if (count == kMaxScopes) return last;
+
+  ScopeAllocations* added = &allocations->scopes[count];
+  added->name.store(count == kMaxScopes - 1 ? kOtherScopes : scope,
+                    std::memory_order_relaxed);
+  allocations->scope_count.store(count + 1, std::memory_order_release);
+  return added;
+}
+
+static void RecordAllocation(size_t size) {
+  ThreadState* state = &thread_state;
+  if (state->ignore) return;
+  ThreadAllocations* allocations = AllocationsForThread(state);
+  allocations->count.fetch_add(1, std::memory_order_relaxed);
+  allocations->bytes.fetch_add(size, std::memory_order_relaxed);
+
+  // The overflow slot is shared between threads, so can't add scopes safely.
+  if (allocations == &thread_allocations[kMaxThreads - 1]) return;
+  const char* scope =
+      state->depth > 0
+          ? state->scopes[std::min(state->depth, kMaxScopeDepth) - 1]
+          : kUntaggedScope;
+  FindScope(allocations, scope)->count.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void* TrackedAllocate(size_t size) {
+  RecordAllocation(size);
+  return malloc(size != 0 ? size : 1);
+}
+
+bool AllocationTrackingEnabled() { return true; }
+
+void AllocationSetThreadName(const char* name) {
+  ThreadState* state = &thread_state;
+  AllocationsForThread(state)->name.store(name, std::memory_order_relaxed);
+}
+
+void AllocationScopePush(const char* scope) {
+  ThreadState* state = &thread_state;
+  if (state->depth < kMaxScopeDepth) state->scopes[state->depth] = scope;
+  state->depth++;
+}
+
+void AllocationScopePop() {
+  ThreadState* state = &thread_state;
+  if (state->depth > 0) state->depth--;
+}
+
+void AllocationFrameEnd() {
+  ThreadState* state = &thread_state;
+  state->ignore = true;
+
+  const bool reset = reset_requested.exchange(false);
+  if (reset) {
+    warmup_frames_left = kWarmupFrames;
+    tracked_frames = 0;
+  }
+  const bool tracking = warmup_frames_left == 0;
+
+  const int threads =
+      std::min(thread_count.load(std::memory_order_relaxed), kMaxThreads);
+  for (int i = 0; i < threads; ++i) {
+    ThreadAllocations& thread = thread_allocations[i];
+    const uint64_t count = thread.count.load(std::memory_order_relaxed);
+    const uint64_t bytes = thread.bytes.load(std::memory_order_relaxed);
+    const uint64_t frame_count = count - thread.last_count;
+    const uint64_t frame_bytes = bytes - thread.last_bytes;
+    thread.last_count = count;
+    thread.last_bytes = bytes;
+    if (reset) {
+      thread.total_count = 0;
+      thread.total_bytes = 0;
+      thread.max_count = 0;
+    }
+    if (tracking) {
+      thread.total_count += frame_count;
+      thread.total_bytes += frame_bytes;
+      thread.max_count = std::max(thread.max_count, frame_count);
+    }
+
+    const int scopes = thread.scope_count.load(std::memory_order_acquire);
+    for (int j = 0; j < scopes; ++j) {
+      ScopeAllocations& scope = thread.scopes[j];
+      const uint64_t scope_count = scope.count.load(std::memory_order_relaxed);
+      if (reset) scope.total_count = 0;
+      if (tracking) scope.total_count += scope_count - scope.last_count;
+      scope.last_count = scope_count;
+    }
+  }
+
+  if (tracking) {
+    tracked_frames++;
+    if (log_interval > 0 && tracked_frames % log_interval == 0) {
+      AllocationLogStats();
+    }
+  } else {
+    warmup_frames_left--;
+  }
+  state->ignore = false;
+}
+
+void AllocationTrackerReset() { reset_requested = true; }
+
+void AllocationLogStats() {
+  if (tracked_frames == 0) return;
+  ThreadState* state = &thread_state;
+  const bool was_ignoring = state->ignore;
+  state->ignore = true;
+
+  LogInfo("Heap allocations per frame over %d frames:", tracked_frames);
+  LogInfo("---------------------------------");
+  const int threads =
+      std::min(thread_count.load(std::memory_order_relaxed), kMaxThreads);
+  for (int i = 0; i < threads; ++i) {
+    const ThreadAllocations& thread = thread_allocations[i];
+    if (thread.total_count == 0) continue;
+    const char* name = thread.name.load(std::memory_order_relaxed);
+    LogInfo("%-28s mean %8.2f (%.0f bytes)  max %llu",
+            name ? name : "(unnamed thread)",
+            static_cast<double>(thread.total_count) / tracked_frames,
+            static_cast<double>(thread.total_bytes) / tracked_frames,
+            static_cast<unsigned long long>(thread.max_count));
+
+    int order[kMaxScopes];
+    const int scopes = thread.scope_count.load(std::memory_order_acquire);
+    for (int j = 0; j < scopes; ++j) order[j] = j;
+    const int listed = std::min(scopes, kScopesToLog);
+    std::partial_sort(order, order + listed, order + scopes,
+                      [&thread](int a, int b) {
+                        return thread.scopes[a].total_count >
+                               thread.scopes[b].total_count;
+                      });
+    for (int j = 0; j < listed; ++j) {
+      const ScopeAllocations& scope = thread.scopes[order[j]];
+      if (scope.total_count == 0) break;
+      LogInfo("    %-32s %8.2f",
+              scope.name.load(std::memory_order_relaxed),
+              static_cast<double>(scope.total_count) / tracked_frames);
+    }
+  }
+  LogInfo("---------------------------------");
+  state->ignore = was_ignoring;
+}
+
+void AllocationSetLogInterval(int frame_count) { log_interval = frame_count; }
+
+#else  // !ZOOSHI_TRACK_ALLOCATIONS
+
+bool AllocationTrackingEnabled() { return false; }
+void AllocationSetThreadName(const char* /*name*/) {}
+void AllocationScopePush(const char* /*scope*/) {}
+void AllocationScopePop() {}
+void AllocationFrameEnd() {}
+void AllocationTrackerReset() {}
+void AllocationLogStats() {}
+void AllocationSetLogInterval(int /*frame_count*/) {}
+
+#endif  // ZOOSHI_TRACK_ALLOCATIONS
+
+}  // zooshi
+}  // fpl
+
+#if ZOOSHI_TRACK_ALLOCATIONS
+
+void* operator new(size_t size) {
+  void* ptr = fpl::zooshi::TrackedAllocate(size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  void* ptr = fpl::zooshi::TrackedAllocate(size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return fpl::zooshi::TrackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return fpl::zooshi::TrackedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+
+void operator delete[](void* ptr) noexcept { free(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  free(ptr);
+}
+
+#endif  // ZOOSHI_TRACK_ALLOCATIONS
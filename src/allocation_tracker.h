@@ -0,0 +1,68 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_ALLOCATION_TRACKER_H_
+#define ZOOSHI_ALLOCATION_TRACKER_H_
+
+// Heap allocation counting.
+//
+// When the game is built with ZOOSHI_TRACK_ALLOCATIONS (the CMake option
+// zooshi_track_allocations), the global operator new is replaced with one
+// that counts every allocation against the calling thread and against the
+// innermost trace marker open on that thread (see trace.h), so allocations
+// can be attributed to a component update or render pass. Memory allocated
+// with malloc() directly, e.g. by SDL, isn't seen.
+//
+// Counts are gathered into per-frame totals by AllocationFrameEnd(). Frames
+// shortly after AllocationTrackerReset() are ignored, so the stats describe
+// the steady state, which in gameplay should eventually be zero.
+//
+// Without ZOOSHI_TRACK_ALLOCATIONS nothing is counted and the functions below
+// do nothing.
+
+namespace fpl {
+namespace zooshi {
+
+// Whether allocations are being counted in this build.
+bool AllocationTrackingEnabled();
+
+// Name the calling thread in the stats. `name` must outlive the tracker, so
+// should be a string literal.
+void AllocationSetThreadName(const char* name);
+
+// Attribute the calling thread's allocations to `scope` until the matching
+// AllocationScopePop(). Called by the trace markers, so code shouldn't need
+// to call these directly. `scope` must outlive the tracker.
+void AllocationScopePush(const char* scope);
+void AllocationScopePop();
+
+// Mark the end of a game frame. Call once per frame, from one thread; the
+// counts of every thread are collected.
+void AllocationFrameEnd();
+
+// Discard the stats, and ignore the next few frames while things warm up.
+void AllocationTrackerReset();
+
+// Write the per-frame allocation stats of each thread to the log, with the
+// scopes that allocate the most.
+void AllocationLogStats();
+
+// Call AllocationLogStats() every `frame_count` frames. Zero, the default,
+// never logs.
+void AllocationSetLogInterval(int frame_count);
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_ALLOCATION_TRACKER_H_
@@ -0,0 +1,80 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_COMPILED_DEF_CACHE_H_
+#define ZOOSHI_COMPILED_DEF_CACHE_H_
+
+#include <unordered_map>
+#include <utility>
+
+namespace fpl {
+namespace zooshi {
+
+// Component settings decoded from a flatbuffer definition, kept by the address
+// of the definition they came from.
+//
+// Every entity spawned from a prototype, whether while loading a level or at
+// runtime, hands its components the prototype's definitions from the entity
+// library. With this cache a component decodes each of those definitions
+// once, and fills in later entities from the decoded copy.
+//
+// Because entries are keyed by address, the cache must be cleared whenever a
+// definition it has seen may be freed, and disabled while definitions are
+// being built on the fly, as they are in Scene Lab.
+//
+// `Compiled` must be default constructible and copyable.
+template <typename Def, typename Compiled>
+class CompiledDefCache {
+ public:
+  CompiledDefCache() : enabled_(true) {}
+
+  // Return `def` decoded by `compile(def, &compiled)`, which is only called
+  // the first time `def` is seen. The reference is valid until the next call.
+  template <typename CompileFn>
+  const Compiled& Get(const Def* def, const CompileFn& compile) {
+    if (!enabled_) {
+      uncached_ = Compiled();
+      compile(def, &uncached_);
+      return uncached_;
+    }
+    auto it = compiled_.find(def);
+    if (it == compiled_.end()) {
+      it = compiled_.insert(std::make_pair(def, Compiled())).first;
+      compile(def, &it->second);
+    }
+    return it->second;
+  }
+
+  // Forget every decoded definition.
+  void Clear() { compiled_.clear(); }
+
+  // When disabled, Get() decodes every time and remembers nothing.
+  void set_enabled(bool enabled) {
+    enabled_ = enabled;
+    if (!enabled) Clear();
+  }
+  bool enabled() const { return enabled_; }
+
+ private:
+  std::unordered_map<const Def*, Compiled> compiled_;
+
+  // What Get() returns while the cache is disabled.
+  Compiled uncached_;
+  bool enabled_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_COMPILED_DEF_CACHE_H_
@@ -0,0 +1,134 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "component_profiler.h"
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+
+#include "fplbase/utilities.h"
+
+using fplbase::LogInfo;
+
+namespace fpl {
+namespace zooshi {
+
+ComponentProfiler::ComponentProfiler(int history_size)
+    : history_size_(history_size),
+      next_sample_(0),
+      sample_count_(0),
+      last_frame_time_(0.0f),
+      log_interval_(0),
+      time_since_log_(0) {
+  assert(history_size_ > 0);
+}
+
+int ComponentProfiler::AddComponent(const char* name) {
+  Entry entry;
+  entry.name = name;
+  entry.samples.resize(history_size_, 0.0f);
+  entries_.push_back(entry);
+  return static_cast<int>(entries_.size()) - 1;
+}
+
+void ComponentProfiler::FrameFinished(float frame_time,
+                                      corgi::WorldTime delta_time) {
+  last_frame_time_ = frame_time;
+  next_sample_ = (next_sample_ + 1) % history_size_;
+  sample_count_ = std::min(sample_count_ + 1, history_size_);
+
+  if (log_interval_ > 0) {
+    time_since_log_ += delta_time;
+    if (time_since_log_ >= log_interval_) {
+      time_since_log_ = 0;
+      LogStats();
+    }
+  }
+}
+
+int ComponentProfiler::FindComponent(const char* name) const {
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (strcmp(entries_[i].name, name) == 0) return static_cast<int>(i);
+  }
+  return -1;
+}
+
+bool ComponentProfiler::GetStats(int index,
+                                 ComponentTimingStats* stats) const {
+  assert(0 <= index && index < ComponentCount());
+  if (sample_count_ == 0) return false;
+
+  // Samples are only valid from the start of the buffer until it first wraps,
+  // after which every slot has been written.
+  const std::vector<float>& samples = entries_[index].samples;
+  sorted_.assign(samples.begin(), samples.begin() + sample_count_);
+  std::sort(sorted_.begin(), sorted_.end());
+
+  float total = 0.0f;
+  for (auto it = sorted_.begin(); it != sorted_.end(); ++it) total += *it;
+
+  // Nearest-rank percentile.
+  const int p95_index = std::min(
+      sample_count_ - 1, static_cast<int>(0.95f * sample_count_ + 0.5f));
+
+  stats->min = sorted_.front();
+  stats->max = sorted_.back();
+  stats->mean = total / sample_count_;
+  stats->p95 = sorted_[p95_index];
+  stats->sample_count = sample_count_;
+  return true;
+}
+
+void ComponentProfiler::LogStats() const {
+  if (sample_count_ == 0) return;
+
+  // Gather everything first, since GetStats() reuses the scratch buffer.
+  std::vector<std::pair<ComponentTimingStats, int>> all_stats;
+  all_stats.reserve(entries_.size());
+  for (int i = 0; i < ComponentCount(); ++i) {
+    ComponentTimingStats stats;
+    GetStats(i, &stats);
+    all_stats.push_back(std::make_pair(stats, i));
+  }
+  std::sort(all_stats.begin(), all_stats.end(),
+            [](const std::pair<ComponentTimingStats, int>& a,
+               const std::pair<ComponentTimingStats, int>& b) {
+              return a.first.mean > b.first.mean;
+            });
+
+  LogInfo("Component update times over %d frames (ms):", sample_count_);
+  LogInfo("---------------------------------");
+  LogInfo("%-28s %8s %8s %8s %8s", "component", "min", "mean", "p95", "max");
+  for (auto it = all_stats.begin(); it != all_stats.end(); ++it) {
+    const ComponentTimingStats& s = it->first;
+    LogInfo("%-28s %8.3f %8.3f %8.3f %8.3f", ComponentName(it->second), s.min,
+            s.mean, s.p95, s.max);
+  }
+  LogInfo("---------------------------------");
+}
+
+void ComponentProfiler::Reset() {
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    std::fill(it->samples.begin(), it->samples.end(), 0.0f);
+  }
+  next_sample_ = 0;
+  sample_count_ = 0;
+  last_frame_time_ = 0.0f;
+  time_since_log_ = 0;
+}
+
+}  // zooshi
+}  // fpl
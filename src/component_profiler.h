@@ -0,0 +1,132 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_COMPONENT_PROFILER_H_
+#define ZOOSHI_COMPONENT_PROFILER_H_
+
+#include <assert.h>
+#include <vector>
+
+#include "corgi/entity_common.h"
+
+namespace fpl {
+namespace zooshi {
+
+// Summary of the most recent update times of one component, in milliseconds.
+struct ComponentTimingStats {
+  ComponentTimingStats()
+      : min(0.0f), mean(0.0f), p95(0.0f), max(0.0f), sample_count(0) {}
+
+  float min;
+  float mean;
+  float p95;
+  float max;
+
+  // Number of frames the stats were computed over. At most the profiler's
+  // history size.
+  int sample_count;
+};
+
+// Keeps the update times of each component, as recorded by the
+// ComponentScheduler that drives the per-frame component updates. The last
+// `history_size` timings of each component are kept in a ring buffer, which
+// can be summarized on demand or dumped to the log periodically.
+//
+// Not thread safe. Query from the thread that updates the game, or while
+// holding whatever lock serializes game updates.
+class ComponentProfiler {
+ public:
+  // Five seconds of history at 60 frames per second.
+  static const int kDefaultHistorySize = 300;
+
+  explicit ComponentProfiler(int history_size = kDefaultHistorySize);
+
+  // Add a component to be timed, and return its index. `name` is used in the
+  // log dump and for lookups with FindComponent(), so must outlive the
+  // profiler.
+  int AddComponent(const char* name);
+
+  // Record how long the component at `index` took to update this frame, in
+  // milliseconds.
+  void RecordUpdate(int index, float update_time) {
+    entries_[index].samples[next_sample_] = update_time;
+  }
+
+  // Finish the frame once every component's update has been recorded.
+  // `frame_time` is the time spent updating components, in milliseconds, and
+  // `delta_time` the world time the update covered.
+  void FrameFinished(float frame_time, corgi::WorldTime delta_time);
+
+  // Number of components being profiled.
+  int ComponentCount() const { return static_cast<int>(entries_.size()); }
+
+  // Name of the component at `index`, as passed to AddComponent().
+  const char* ComponentName(int index) const {
+    return entries_[index].name;
+  }
+
+  // Index of the component with the given name, or -1 if there is none.
+  int FindComponent(const char* name) const;
+
+  // Summarize the recorded timings of the component at `index`. Returns false
+  // if nothing has been recorded for it yet.
+  bool GetStats(int index, ComponentTimingStats* stats) const;
+
+  // Time spent updating components on the most recent frame, in
+  // milliseconds. Components that were updated at the same time only count
+  // once.
+  float last_frame_time() const { return last_frame_time_; }
+
+  // Write the stats of every component to the log, slowest first.
+  void LogStats() const;
+
+  // Call LogStats() every `log_interval` milliseconds of world time. Zero, the
+  // default, never logs.
+  void set_log_interval(corgi::WorldTime log_interval) {
+    log_interval_ = log_interval;
+  }
+  corgi::WorldTime log_interval() const { return log_interval_; }
+
+  // Clear all recorded timings.
+  void Reset();
+
+ private:
+  struct Entry {
+    const char* name;
+
+    // Ring buffer of update times, in milliseconds.
+    std::vector<float> samples;
+  };
+
+  std::vector<Entry> entries_;
+
+  // Ring buffer position shared by all entries, since every component is
+  // sampled exactly once per frame.
+  int history_size_;
+  int next_sample_;
+  int sample_count_;
+
+  float last_frame_time_;
+
+  corgi::WorldTime log_interval_;
+  corgi::WorldTime time_since_log_;
+
+  // Scratch space for computing percentiles, to avoid allocating per query.
+  mutable std::vector<float> sorted_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_COMPONENT_PROFILER_H_
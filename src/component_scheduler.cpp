@@ -0,0 +1,171 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "component_scheduler.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "component_profiler.h"
+#include "corgi/entity_manager.h"
+#include "fplbase/utilities.h"
+#include "trace.h"
+
+using fplbase::LogInfo;
+
+namespace fpl {
+namespace zooshi {
+
+typedef std::chrono::high_resolution_clock ScheduleClock;
+
+static inline float ElapsedMilliseconds(
+    const ScheduleClock::time_point& start,
+    const ScheduleClock::time_point& end) {
+  return std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+ComponentScheduler::ComponentScheduler(ComponentProfiler* profiler)
+    : profiler_(profiler),
+      waves_dirty_(true),
+      current_wave_(nullptr),
+      delta_time_(0) {
+  update_task_ = [this](int i) { UpdateEntry((*current_wave_)[i]); };
+}
+
+void ComponentScheduler::AddComponent(corgi::ComponentInterface* component,
+                                      const char* name) {
+  Entry entry;
+  entry.component = component;
+  entry.name = name;
+  entry.skip_updates = false;
+  entry.profiler_index = profiler_->AddComponent(name);
+  entry.update_time = 0.0f;
+  entries_.push_back(entry);
+  waves_dirty_ = true;
+}
+
+ComponentScheduler::Entry* ComponentScheduler::FindEntry(
+    corgi::ComponentInterface* component) {
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->component == component) return &*it;
+  }
+  assert(false);
+  return nullptr;
+}
+
+void ComponentScheduler::SetAccess(corgi::ComponentInterface* component,
+                                   const ComponentAccess& access) {
+  FindEntry(component)->access = access;
+  waves_dirty_ = true;
+}
+
+void ComponentScheduler::SetFinish(corgi::ComponentInterface* component,
+                                   const std::function<void()>& finish) {
+  FindEntry(component)->finish = finish;
+}
+
+void ComponentScheduler::SkipUpdates(corgi::ComponentInterface* component) {
+  FindEntry(component)->skip_updates = true;
+  waves_dirty_ = true;
+}
+
+void ComponentScheduler::SetWorkerThreadCount(int thread_count) {
+  worker_pool_.reset(thread_count > 0 ? new WorkerPool(thread_count)
+                                      : nullptr);
+  LogInfo("Updating components with %d worker threads.", thread_count);
+}
+
+void ComponentScheduler::BuildWaves() {
+  // Each component goes in the wave after the last earlier component it
+  // conflicts with. Skipped components aren't in any wave, so they can't
+  // hold anything back.
+  std::vector<int> entry_wave(entries_.size(), 0);
+  waves_.clear();
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (entries_[i].skip_updates) continue;
+    int wave = 0;
+    for (size_t j = 0; j < i; ++j) {
+      if (!entries_[j].skip_updates &&
+          entries_[i].access.ConflictsWith(entries_[j].access)) {
+        wave = std::max(wave, entry_wave[j] + 1);
+      }
+    }
+    entry_wave[i] = wave;
+    if (wave >= static_cast<int>(waves_.size())) waves_.resize(wave + 1);
+    waves_[wave].push_back(static_cast<int>(i));
+  }
+  waves_dirty_ = false;
+
+  for (size_t wave = 0; wave < waves_.size(); ++wave) {
+    if (waves_[wave].size() < 2) continue;
+    std::string names;
+    for (auto it = waves_[wave].begin(); it != waves_[wave].end(); ++it) {
+      if (!names.empty()) names += ", ";
+      names += entries_[*it].name;
+    }
+    LogInfo("Updating together: %s", names.c_str());
+  }
+}
+
+void ComponentScheduler::UpdateEntry(int index) {
+  Entry& entry = entries_[index];
+  TraceBegin(entry.name);
+  const ScheduleClock::time_point start = ScheduleClock::now();
+  entry.component->UpdateAllEntities(delta_time_);
+  entry.update_time = ElapsedMilliseconds(start, ScheduleClock::now());
+  TraceEnd();
+}
+
+void ComponentScheduler::UpdateComponents(corgi::EntityManager* entity_manager,
+                                          corgi::WorldTime delta_time) {
+  if (waves_dirty_) BuildWaves();
+
+  const ScheduleClock::time_point start = ScheduleClock::now();
+  delta_time_ = delta_time;
+  for (auto it = waves_.begin(); it != waves_.end(); ++it) {
+    // Skipped components never make it into a wave, so a wave of two or more
+    // always has that much real work to share out.
+    if (worker_pool_ && it->size() > 1) {
+      current_wave_ = &*it;
+      worker_pool_->ParallelFor(static_cast<int>(it->size()), update_task_);
+    } else {
+      for (auto index = it->begin(); index != it->end(); ++index) {
+        UpdateEntry(*index);
+      }
+    }
+
+    for (auto index = it->begin(); index != it->end(); ++index) {
+      Entry& entry = entries_[*index];
+      if (!entry.finish) continue;
+      const ScheduleClock::time_point finish_start = ScheduleClock::now();
+      entry.finish();
+      entry.update_time +=
+          ElapsedMilliseconds(finish_start, ScheduleClock::now());
+    }
+  }
+  current_wave_ = nullptr;
+  const float frame_time = ElapsedMilliseconds(start, ScheduleClock::now());
+
+  entity_manager->DeleteMarkedEntities();
+
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    profiler_->RecordUpdate(it->profiler_index, it->update_time);
+  }
+  profiler_->FrameFinished(frame_time, delta_time);
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,178 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_COMPONENT_SCHEDULER_H_
+#define ZOOSHI_COMPONENT_SCHEDULER_H_
+
+#include <assert.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "corgi/component_interface.h"
+#include "corgi/entity_common.h"
+#include "worker_pool.h"
+
+namespace corgi {
+class EntityManager;
+}  // corgi
+
+namespace fpl {
+namespace zooshi {
+
+class ComponentProfiler;
+
+// Systems that component updates share, other than component data.
+enum SharedSystem {
+  // The motive engine owned by the AnimationComponent, which every motivator
+  // in the game lives in. Reading a motivator reads it, and advancing the
+  // engine or creating motivators writes it.
+  kSharedSystemMotiveEngine,
+
+  // The pindrop audio engine, whose channels and listeners aren't thread safe.
+  kSharedSystemAudioEngine,
+
+  kNumSharedSystems
+};
+
+// The data that a component's UpdateAllEntities() reads and writes. Bit `id`
+// of each mask stands for the data of the component whose corgi::ComponentId
+// is `id`, and the top kNumSharedSystems bits stand for the shared systems.
+//
+// The default is exclusive access to everything. That is what any update that
+// creates or deletes entities, broadcasts events, or calls into systems that
+// aren't thread safe, such as physics, needs.
+struct ComponentAccess {
+  typedef uint64_t Mask;
+
+  static const int kMaskBits = static_cast<int>(sizeof(Mask) * 8);
+
+  ComponentAccess() : reads(~Mask(0)), writes(~Mask(0)) {}
+  ComponentAccess(Mask reads, Mask writes) : reads(reads), writes(writes) {}
+
+  static Mask Bit(corgi::ComponentId id) {
+    assert(id < static_cast<corgi::ComponentId>(kMaskBits -
+                                                kNumSharedSystems));
+    return Mask(1) << id;
+  }
+
+  static Mask Bit(SharedSystem system) {
+    return Mask(1) << (kMaskBits - 1 - system);
+  }
+
+  // Whether the two updates must not run at the same time.
+  bool ConflictsWith(const ComponentAccess& other) const {
+    return (writes & (other.reads | other.writes)) != 0 ||
+           (reads & other.writes) != 0;
+  }
+
+  Mask reads;
+  Mask writes;
+};
+
+// Drives the per-frame component updates in place of
+// EntityManager::UpdateComponents(), and times each component's
+// UpdateAllEntities() call with a ComponentProfiler.
+//
+// Components are updated in the order they were added, which should match the
+// order they were registered with the EntityManager, except that components
+// whose ComponentAccess doesn't conflict are grouped into waves, and are
+// updated at the same time on worker threads. A component is never moved
+// ahead of an earlier one it conflicts with.
+//
+// Not thread safe. Call from the thread that updates the game.
+class ComponentScheduler {
+ public:
+  // Record update times in `profiler`, which must outlive the scheduler.
+  explicit ComponentScheduler(ComponentProfiler* profiler);
+
+  // Add a component to be updated and timed. `name` is passed on to the
+  // profiler, and used as the component's trace marker, so must outlive the
+  // scheduler.
+  // The component is given exclusive access until SetAccess() says otherwise.
+  void AddComponent(corgi::ComponentInterface* component, const char* name);
+
+  // Declare the data a component's update touches.
+  void SetAccess(corgi::ComponentInterface* component,
+                 const ComponentAccess& access);
+
+  // Call `finish` on the updating thread after the component's wave has been
+  // updated, for the part of its update that needs exclusive access, such as
+  // broadcasting events.
+  void SetFinish(corgi::ComponentInterface* component,
+                 const std::function<void()>& finish);
+
+  // Never update a component whose UpdateAllEntities() does nothing, so that
+  // it takes no part in the waves.
+  void SkipUpdates(corgi::ComponentInterface* component);
+
+  // Update waves of two or more components on `thread_count` worker threads,
+  // in addition to the thread that calls UpdateComponents(). Zero, the
+  // default, updates everything on the calling thread.
+  void SetWorkerThreadCount(int thread_count);
+
+  // The pool that updates components, or null if there are no worker threads.
+  // Other systems may post background jobs to it.
+  WorkerPool* worker_pool() const { return worker_pool_.get(); }
+
+  // Update every component, then delete entities that were marked for
+  // deletion, just like EntityManager::UpdateComponents().
+  void UpdateComponents(corgi::EntityManager* entity_manager,
+                        corgi::WorldTime delta_time);
+
+ private:
+  struct Entry {
+    corgi::ComponentInterface* component;
+    const char* name;
+    ComponentAccess access;
+    std::function<void()> finish;
+    bool skip_updates;
+
+    // The component's index in the profiler, and the time it took to update
+    // this frame, in milliseconds.
+    int profiler_index;
+    float update_time;
+  };
+
+  Entry* FindEntry(corgi::ComponentInterface* component);
+
+  // Group the components into waves that can each be updated at once.
+  void BuildWaves();
+
+  // Update and time the component at `index`.
+  void UpdateEntry(int index);
+
+  ComponentProfiler* profiler_;
+
+  std::vector<Entry> entries_;
+
+  // Indices of the components in each wave. Waves are updated in order, and
+  // rebuilt whenever a component or its access changes.
+  std::vector<std::vector<int>> waves_;
+  bool waves_dirty_;
+
+  std::unique_ptr<WorkerPool> worker_pool_;
+
+  // State for `update_task_`, which is made once so that handing a wave to
+  // the workers doesn't allocate.
+  std::function<void(int)> update_task_;
+  const std::vector<int>* current_wave_;
+  corgi::WorldTime delta_time_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_COMPONENT_SCHEDULER_H_
@@ -14,6 +14,7 @@
 
 #include "components/patron.h"
 
+#include <algorithm>
 #include <vector>
 #include "components/attributes.h"
 #include "components/player.h"
@@ -64,6 +65,18 @@ using motive::kMotiveTimeEndless;
 static const float kLapWaitAmount = 0.5f;
 static const float kHeightRangeBuffer = 0.05f;
 
+// Smallest projectile grid cell, in meters, for when no patron searches.
+static const float kMinProjectileGridCellSize = 1.0f;
+
+// Activation windows are found from the straight segments between the raft
+// rail's lookup table samples, which the rail curves away from by a few
+// centimeters. Reach this much further, in meters, to allow for it.
+static const float kRailTableTolerance = 0.5f;
+
+// A patron whose position has changed by more than this, in meters, since its
+// activation windows were found, needs them found again.
+static const float kActivationPositionTolerance = 0.01f;
+
 static inline vec3 ZeroHeight(const vec3& v) {
   vec3 v_copy = v;
   v_copy.z = 0.0f;
@@ -104,8 +117,16 @@ void PatronComponent::Init() {
   // Only set up callbacks if we actually have a Scene Lab.
   SceneLab* scene_lab = services->scene_lab();
   if (scene_lab) {
-    scene_lab->AddOnEnterEditorCallback([this]() { UpdateAndEnablePhysics(); });
-    scene_lab->AddOnExitEditorCallback([this]() { PostLoadFixup(); });
+    // Scene Lab hands over PatronDefs that it builds and frees as entities
+    // are edited, so they mustn't be remembered by address.
+    scene_lab->AddOnEnterEditorCallback([this]() {
+      compiled_defs_.set_enabled(false);
+      UpdateAndEnablePhysics();
+    });
+    scene_lab->AddOnExitEditorCallback([this]() {
+      compiled_defs_.set_enabled(true);
+      PostLoadFixup();
+    });
   }
 }
 
@@ -116,62 +137,98 @@ static Interpolants LoadInterpolants(const InterpolantsDef* def) {
                             motive::Range(def->start_time(), def->end_time()));
 }
 
-void PatronComponent::AddFromRawData(corgi::EntityRef& entity,
-                                     const void* raw_data) {
-  auto patron_def = static_cast<const PatronDef*>(raw_data);
-  PatronData* patron_data = AddEntity(entity);
-  patron_data->anim_object = patron_def->anim_object();
+void PatronComponent::CompileDef(const PatronDef* patron_def,
+                                 CompiledDef* compiled) {
+  compiled->anim_object = patron_def->anim_object();
+  compiled->pop_in_radius = LoadInterpolants(patron_def->pop_in_radius());
+  compiled->pop_out_radius = patron_def->pop_out_radius();
+  assert(compiled->pop_out_radius >= compiled->pop_in_radius.values.end());
 
-  patron_data->pop_in_radius = LoadInterpolants(patron_def->pop_in_radius());
-  patron_data->pop_out_radius = patron_def->pop_out_radius();
-  assert(patron_data->pop_out_radius >=
-         patron_data->pop_in_radius.values.end());
+  compiled->min_lap = patron_def->min_lap();
+  compiled->max_lap = patron_def->max_lap();
+  compiled->patience = LoadInterpolants(patron_def->patience());
 
-  patron_data->min_lap = patron_def->min_lap();
-  patron_data->max_lap = patron_def->max_lap();
-  patron_data->patience = LoadInterpolants(patron_def->patience());
-
-  if (patron_def->events()) {
-    patron_data->events.resize(patron_def->events()->size());
+  compiled->has_events = patron_def->events() != nullptr;
+  if (compiled->has_events) {
+    compiled->events.resize(patron_def->events()->size());
     for (size_t i = 0; i < patron_def->events()->size(); ++i) {
       flatbuffers::uoffset_t index = static_cast<flatbuffers::uoffset_t>(i);
       auto event = patron_def->events()->Get(index);
-      patron_data->events[i] = PatronEvent(event->action(), event->time());
+      compiled->events[i] = PatronEvent(event->action(), event->time());
     }
   }
 
-  if (patron_def->target_tag()) {
-    patron_data->target_tag = patron_def->target_tag()->str();
+  compiled->has_target_tag = patron_def->target_tag() != nullptr;
+  if (compiled->has_target_tag) {
+    compiled->target_tag = patron_def->target_tag()->str();
   }
 
-  patron_data->max_catch_distance = patron_def->max_catch_distance();
-  patron_data->max_catch_distance_for_search =
+  compiled->max_catch_distance = patron_def->max_catch_distance();
+  compiled->max_catch_distance_for_search =
       patron_def->max_catch_distance_for_search();
-  patron_data->max_catch_angle = patron_def->max_catch_angle();
-  patron_data->point_display_height = patron_def->point_display_height();
-  patron_data->max_face_angle_away_from_raft =
+  compiled->max_catch_angle = patron_def->max_catch_angle();
+  compiled->point_display_height = patron_def->point_display_height();
+  compiled->max_face_angle_away_from_raft =
       motive::Angle::FromDegrees(patron_def->max_face_angle_away_from_raft());
-  patron_data->time_to_face_raft = patron_def->time_to_face_raft();
-  patron_data->play_eating_animation = patron_def->play_eating_animation() != 0;
+  compiled->time_to_face_raft = patron_def->time_to_face_raft();
+  compiled->play_eating_animation = patron_def->play_eating_animation() != 0;
 
-  patron_data->catch_time_for_search =
+  compiled->catch_time_for_search =
       motive::Range(patron_def->min_catch_time_for_search(),
                     patron_def->max_catch_time_for_search());
-  patron_data->catch_time =
+  compiled->catch_time =
       motive::Range(patron_def->min_catch_time(), patron_def->max_catch_time());
-  patron_data->catch_speed = motive::Range(patron_def->min_catch_speed(),
-                                           patron_def->max_catch_speed());
-  patron_data->time_between_catch_searches =
+  compiled->catch_speed = motive::Range(patron_def->min_catch_speed(),
+                                        patron_def->max_catch_speed());
+  compiled->time_between_catch_searches =
       patron_def->time_between_catch_searches();
-  patron_data->return_time = patron_def->return_time();
-  patron_data->rail_accelerate_time = patron_def->rail_accelerate_time();
+  compiled->return_time = patron_def->return_time();
+  compiled->rail_accelerate_time = patron_def->rail_accelerate_time();
 
-  patron_data->time_exasperated_before_disappearing =
+  compiled->time_exasperated_before_disappearing =
       patron_def->time_exasperated_before_disappearing();
-  patron_data->exasperated_playback_rate =
+  compiled->exasperated_playback_rate =
       patron_def->exasperated_playback_rate();
 }
 
+void PatronComponent::AddFromRawData(corgi::EntityRef& entity,
+                                     const void* raw_data) {
+  const CompiledDef& def = compiled_defs_.Get(
+      static_cast<const PatronDef*>(raw_data), &PatronComponent::CompileDef);
+  PatronData* patron_data = AddEntity(entity);
+  patron_data->anim_object = def.anim_object;
+  active_lists_dirty_ = true;
+
+  patron_data->pop_in_radius = def.pop_in_radius;
+  patron_data->pop_out_radius = def.pop_out_radius;
+  patron_data->min_lap = def.min_lap;
+  patron_data->max_lap = def.max_lap;
+  patron_data->patience = def.patience;
+  if (def.has_events) patron_data->events = def.events;
+  if (def.has_target_tag) patron_data->target_tag = def.target_tag;
+
+  patron_data->max_catch_distance = def.max_catch_distance;
+  patron_data->max_catch_distance_for_search =
+      def.max_catch_distance_for_search;
+  patron_data->max_catch_angle = def.max_catch_angle;
+  patron_data->point_display_height = def.point_display_height;
+  patron_data->max_face_angle_away_from_raft =
+      def.max_face_angle_away_from_raft;
+  patron_data->time_to_face_raft = def.time_to_face_raft;
+  patron_data->play_eating_animation = def.play_eating_animation;
+
+  patron_data->catch_time_for_search = def.catch_time_for_search;
+  patron_data->catch_time = def.catch_time;
+  patron_data->catch_speed = def.catch_speed;
+  patron_data->time_between_catch_searches = def.time_between_catch_searches;
+  patron_data->return_time = def.return_time;
+  patron_data->rail_accelerate_time = def.rail_accelerate_time;
+
+  patron_data->time_exasperated_before_disappearing =
+      def.time_exasperated_before_disappearing;
+  patron_data->exasperated_playback_rate = def.exasperated_playback_rate;
+}
+
 static inline flatbuffers::Offset<InterpolantsDef> SaveInterpolants(
     flatbuffers::FlatBufferBuilder& fbb, const Interpolants& in) {
   return CreateInterpolantsDef(fbb, in.values.start(), in.times.start(),
@@ -235,6 +292,11 @@ corgi::ComponentInterface::RawDataUniquePtr PatronComponent::ExportRawData(
 
 void PatronComponent::InitEntity(corgi::EntityRef& entity) { (void)entity; }
 
+void PatronComponent::CleanupEntity(corgi::EntityRef& entity) {
+  (void)entity;
+  active_lists_dirty_ = true;
+}
+
 void PatronComponent::UpdateAndEnablePhysics() {
   // Make the patrons stand up
   RenderMeshComponent* render_mesh_component =
@@ -256,6 +318,8 @@ void PatronComponent::PostLoadFixup() {
 
   // Initialize each patron.
   auto physics_component = entity_manager_->GetComponent<PhysicsComponent>();
+  RenderMeshComponent* render_mesh_component =
+      entity_manager_->GetComponent<RenderMeshComponent>();
   for (auto iter = component_data_.begin(); iter != component_data_.end();
        ++iter) {
     corgi::EntityRef patron = iter->entity;
@@ -274,8 +338,10 @@ void PatronComponent::PostLoadFixup() {
         Data<AnimationData>(patron_data->render_child);
     animation_data->anim_table_object = patron_data->anim_object;
 
-    // Initialize state machine.
+    // Initialize state machine. Visibility is only changed with the state
+    // from here on.
     SetState(kPatronStateLayingDown, patron_data);
+    render_mesh_component->SetVisibilityRecursively(patron, false);
 
     // Reset the last lap the patron stood up.
     patron_data->last_lap_upright = -1.0f;
@@ -296,6 +362,7 @@ void PatronComponent::PostLoadFixup() {
       rail_denizen_data->SetSplinePlaybackRate(0.0f);
     }
   }
+  active_lists_dirty_ = true;
 }
 
 // Return time until the patron's patience has expired.
@@ -459,139 +526,325 @@ bool PatronComponent::ShouldDisappear(
   return time_until_exasperated <= 0.0f;
 }
 
-void PatronComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
-  corgi::EntityRef raft =
-      entity_manager_->GetComponent<ServicesComponent>()->raft_entity();
-  if (!raft) return;
-  const RailDenizenData* raft_rail_denizen = Data<RailDenizenData>(raft);
+void PatronComponent::RebuildActiveLists(
+    const RailDenizenData* raft_rail_denizen) {
+  event_patrons_.clear();
+  awake_patrons_.clear();
   for (auto iter = component_data_.begin(); iter != component_data_.end();
        ++iter) {
-    corgi::EntityRef patron = iter->entity;
-    TransformData* transform_data = Data<TransformData>(patron);
-    PatronData* patron_data = Data<PatronData>(patron);
-    RenderMeshComponent* rm_component =
-        entity_manager_->GetComponent<RenderMeshComponent>();
-    PhysicsComponent* physics_component =
-        entity_manager_->GetComponent<PhysicsComponent>();
-
-    // Animate patrons in the event.
-    const int num_events = static_cast<int>(patron_data->events.size());
-    if (event_time_ >= 0 && num_events > 0) {
-      const bool anim_ending = AnimationEnding(patron_data, delta_time);
-      if (patron_data->event_index < num_events) {
-        const PatronEvent& event =
-            patron_data->events[patron_data->event_index];
-        if ((event.time >= 0 && event.time <= event_time_) ||
-            (event.time < 0 && anim_ending)) {
-          // Start new animation.
-          Animate(patron_data, event.action);
-          patron_data->event_index++;
-          SetState(kPatronStateInEvent, patron_data);
-        }
-      } else if (anim_ending) {
-        // Disable event patron since we've played the last event.
-        SetState(kPatronStateLayingDown, patron_data);
-      }
+    if (iter->data.events.empty()) {
+      iter->data.awake = true;
+      awake_patrons_.push_back(iter->entity);
+    } else {
+      event_patrons_.push_back(iter->entity);
     }
+  }
+  RebuildTimeline(raft_rail_denizen);
+  active_lists_dirty_ = false;
+}
 
-    const PatronState state = patron_data->state;
-    rm_component->SetVisibilityRecursively(patron,
-                                           state != kPatronStateLayingDown);
-    if (num_events > 0) continue;
+// Find the activation windows of every patron along the raft's rail.
+void PatronComponent::RebuildTimeline(
+    const RailDenizenData* raft_rail_denizen) {
+  raft_rail_ = raft_rail_denizen->rail;
 
-    // Remember the last idle position so we can return to later.
-    if (patron_data->move_state == kPatronMoveStateIdle) {
-      patron_data->return_position = transform_data->position;
+  timeline_.clear();
+  for (auto iter = component_data_.begin(); iter != component_data_.end();
+       ++iter) {
+    PatronData* patron_data = &iter->data;
+    if (!patron_data->events.empty()) continue;
+    ComputeActivationWindows(Data<TransformData>(iter->entity)->position,
+                             patron_data);
+    for (auto it = patron_data->activation_windows.begin();
+         it != patron_data->activation_windows.end(); ++it) {
+      timeline_.push_back(ActivationEvent(it->start(), iter->entity));
     }
+  }
+  std::sort(timeline_.begin(), timeline_.end());
+  timeline_progress_ = raft_rail_denizen->lap_progress;
+}
+
+// Find the spans of lap progress during which the raft's rail passes within
+// the largest pop in radius of `position`. The rail finds the spans of time
+// from its segment tree, and lap progress is time along the rail as a
+// fraction of the whole.
+void PatronComponent::ComputeActivationWindows(const vec3& position,
+                                               PatronData* patron_data) const {
+  std::vector<motive::Range>& windows = patron_data->activation_windows;
+  windows.clear();
+  patron_data->activation_position = position;
+
+  // Without a rail to follow, the raft could be anywhere at any time.
+  const float end_time = raft_rail_ != nullptr ? raft_rail_->EndTime() : 0.0f;
+  if (end_time <= 0.0f) {
+    windows.push_back(motive::Range(0.0f, 1.0f));
+    return;
+  }
 
-    // Move patron towards the target.
-    UpdateMovement(patron);
+  const motive::Range& pop_in_radii = patron_data->pop_in_radius.values;
+  const float reach =
+      std::max(pop_in_radii.start(), pop_in_radii.end()) + kRailTableTolerance;
+  raft_rail_->TimesWithin(position, reach, &windows);
+  for (auto it = windows.begin(); it != windows.end(); ++it) {
+    *it = motive::Range(it->start() / end_time,
+                        std::min(it->end() / end_time, 1.0f));
+  }
+}
+
+// Patrons that have been moved since their activation windows were found,
+// by riding a rail or chasing sushi, need them found again.
+void PatronComponent::MoveActivationWindows(const EntityRef& patron,
+                                            PatronData* patron_data) {
+  const vec3& position = Data<TransformData>(patron)->position;
+  const float tolerance_sq =
+      kActivationPositionTolerance * kActivationPositionTolerance;
+  if ((position - patron_data->activation_position).LengthSquared() <=
+      tolerance_sq) {
+    return;
+  }
+
+  timeline_.erase(std::remove_if(timeline_.begin(), timeline_.end(),
+                                 [&patron](const ActivationEvent& event) {
+                                   return event.patron == patron;
+                                 }),
+                  timeline_.end());
+  ComputeActivationWindows(position, patron_data);
+  for (auto it = patron_data->activation_windows.begin();
+       it != patron_data->activation_windows.end(); ++it) {
+    const ActivationEvent event(it->start(), patron);
+    timeline_.insert(
+        std::upper_bound(timeline_.begin(), timeline_.end(), event), event);
+  }
+}
+
+// Wake the sleeping patrons with a window opening in
+// (begin_progress, end_progress].
+void PatronComponent::WakePatrons(float begin_progress, float end_progress) {
+  const auto begin = std::upper_bound(
+      timeline_.begin(), timeline_.end(),
+      ActivationEvent(begin_progress, EntityRef()));
+  const auto end =
+      std::upper_bound(begin, timeline_.end(),
+                       ActivationEvent(end_progress, EntityRef()));
+  for (auto it = begin; it != end; ++it) {
+    PatronData* patron_data = GetComponentData(it->patron);
+    if (patron_data->awake) continue;
+    patron_data->awake = true;
+    awake_patrons_.push_back(it->patron);
+  }
+}
 
-    // Set the patron's movement target.
-    if (state == kPatronStateUpright &&
-        (patron_data->move_state != kPatronMoveStateMoveToTarget ||
-         patron_data->time_in_move_state >
-             patron_data->time_between_catch_searches)) {
-      FindProjectileAndCatch(patron);
+// Move the cursor from where the raft was last frame to where it is now. The
+// raft only moves forwards, so if its progress has decreased it has wrapped
+// around the end of the lap. Everyone is woken if the raft changes rails.
+void PatronComponent::AdvanceTimeline(
+    const RailDenizenData* raft_rail_denizen) {
+  if (raft_rail_denizen->rail != raft_rail_) {
+    RebuildActiveLists(raft_rail_denizen);
+    return;
+  }
+
+  const float progress = raft_rail_denizen->lap_progress;
+  if (progress >= timeline_progress_) {
+    WakePatrons(timeline_progress_, progress);
+  } else {
+    WakePatrons(timeline_progress_, 1.0f);
+    WakePatrons(-1.0f, progress);
+  }
+  timeline_progress_ = progress;
+}
+
+// A patron can sleep once it's laying down and has stopped moving, since
+// nothing changes until it stands up again.
+bool PatronComponent::CanSleep(const PatronData* patron_data) const {
+  return patron_data->state == kPatronStateLayingDown &&
+         patron_data->move_state == kPatronMoveStateIdle &&
+         !patron_data->delta_position.Valid() &&
+         !patron_data->delta_face_angle.Valid();
+}
+
+// Patrons stay awake while the raft is inside one of their activation
+// windows, so that ShouldAppear() is checked every frame the raft might be
+// within range.
+bool PatronComponent::ShouldSleep(const EntityRef& patron,
+                                  float lap_progress) {
+  PatronData* patron_data = GetComponentData(patron);
+  if (!CanSleep(patron_data)) return false;
+
+  MoveActivationWindows(patron, patron_data);
+  const std::vector<motive::Range>& windows = patron_data->activation_windows;
+  for (auto it = windows.begin(); it != windows.end(); ++it) {
+    if (it->Contains(lap_progress)) return false;
+  }
+  patron_data->awake = false;
+  return true;
+}
+
+void PatronComponent::ChangeState(EntityRef& patron, PatronState state,
+                                  PatronData* patron_data) {
+  const bool was_visible = patron_data->state != kPatronStateLayingDown;
+  SetState(state, patron_data);
+  const bool visible = state != kPatronStateLayingDown;
+  if (visible != was_visible) {
+    entity_manager_->GetComponent<RenderMeshComponent>()
+        ->SetVisibilityRecursively(patron, visible);
+  }
+}
+
+void PatronComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
+  corgi::EntityRef raft =
+      entity_manager_->GetComponent<ServicesComponent>()->raft_entity();
+  if (!raft) {
+    pending_collisions_.clear();
+    return;
+  }
+  const RailDenizenData* raft_rail_denizen = Data<RailDenizenData>(raft);
+  projectile_grid_dirty_ = true;
+  DispatchCollisions(raft_rail_denizen);
+  if (active_lists_dirty_) RebuildActiveLists(raft_rail_denizen);
+  AdvanceTimeline(raft_rail_denizen);
+
+  // Animate patrons in the event.
+  if (event_time_ >= 0) {
+    for (auto it = event_patrons_.begin(); it != event_patrons_.end(); ++it) {
+      UpdateEventPatron(*it, delta_time);
     }
-    if ((state == kPatronStateUpright || state == kPatronStateGettingUp) &&
-        patron_data->move_state == kPatronMoveStateIdle) {
-      FaceRaft(patron);
+  }
+
+  // Update the patrons that are awake, and put those that have settled back
+  // to sleep.
+  size_t num_awake = 0;
+  for (size_t i = 0; i < awake_patrons_.size(); ++i) {
+    EntityRef patron = awake_patrons_[i];
+    UpdatePatron(patron, raft_rail_denizen, delta_time);
+    if (!ShouldSleep(patron, raft_rail_denizen->lap_progress)) {
+      awake_patrons_[num_awake++] = patron;
     }
+  }
+  awake_patrons_.resize(num_awake);
 
-    if (ShouldAppear(patron_data, transform_data, raft_rail_denizen)) {
-      SetState(kPatronStateGettingUp, patron_data);
-      Animate(patron_data, PatronAction_GetUp);
-      patron_data->last_lap_upright = raft_rail_denizen->total_lap_progress;
-
-    } else if (ShouldDisappear(patron_data, transform_data,
-                               raft_rail_denizen)) {
-      SetState(kPatronStateFalling, patron_data);
-      Animate(patron_data, PatronAction_Fall);
-
-      entity_manager_->GetComponent<PhysicsComponent>()->DisablePhysics(patron);
-      auto rail_denizen_data = Data<RailDenizenData>(patron);
-      if (rail_denizen_data != nullptr) {
-        rail_denizen_data->enabled = false;
-        rail_denizen_data->SetSplinePlaybackRate(0.0f);
-      }
+  if (event_time_ >= 0) {
+    event_time_ += delta_time;
+  }
+}
+
+void PatronComponent::UpdateEventPatron(EntityRef& patron,
+                                        corgi::WorldTime delta_time) {
+  PatronData* patron_data = Data<PatronData>(patron);
+  const int num_events = static_cast<int>(patron_data->events.size());
+  const bool anim_ending = AnimationEnding(patron_data, delta_time);
+  if (patron_data->event_index < num_events) {
+    const PatronEvent& event = patron_data->events[patron_data->event_index];
+    if ((event.time >= 0 && event.time <= event_time_) ||
+        (event.time < 0 && anim_ending)) {
+      // Start new animation.
+      Animate(patron_data, event.action);
+      patron_data->event_index++;
+      ChangeState(patron, kPatronStateInEvent, patron_data);
     }
+  } else if (anim_ending) {
+    // Disable event patron since we've played the last event.
+    ChangeState(patron, kPatronStateLayingDown, patron_data);
+  }
+}
 
-    // Transition to the next state if we're at the end of the current
-    // animation.
-    const bool anim_ending = AnimationEnding(patron_data, delta_time);
-    if (anim_ending) {
-      switch (patron_data->state) {
-        case kPatronStateEating:
-          SetState(kPatronStateSatisfied, patron_data);
-          Animate(patron_data, PatronAction_Satisfied);
-          break;
-
-        case kPatronStateSatisfied:
-          SetState(kPatronStateFalling, patron_data);
-          Animate(patron_data, PatronAction_Fall);
-          break;
-
-        case kPatronStateFalling:
-          // After the patron has finished their falling animation, turn off
-          // the physics, as they are no longer in the world.
-          physics_component->DisablePhysics(patron);
-          SetState(kPatronStateLayingDown, patron_data);
-          break;
-
-        case kPatronStateGettingUp: {
-          SetState(kPatronStateUpright, patron_data);
-          physics_component->EnablePhysics(patron);
-          auto rail_denizen_data = Data<RailDenizenData>(patron);
-          if (rail_denizen_data != nullptr) {
-            rail_denizen_data->enabled = true;
-            rail_denizen_data->SetPlaybackRate(
-                rail_denizen_data->initial_playback_rate,
-                corgi::kMillisecondsPerSecond *
-                    patron_data->rail_accelerate_time);
-          }
-        } FPL_FALLTHROUGH_INTENDED
-
-        case kPatronStateUpright:
-          Animate(patron_data, PatronAction_Idle);
-          break;
-
-        default:
-          break;
-      }
+void PatronComponent::UpdatePatron(EntityRef& patron,
+                                   const RailDenizenData* raft_rail_denizen,
+                                   corgi::WorldTime delta_time) {
+  TransformData* transform_data = Data<TransformData>(patron);
+  PatronData* patron_data = Data<PatronData>(patron);
+  PhysicsComponent* physics_component =
+      entity_manager_->GetComponent<PhysicsComponent>();
+  const PatronState state = patron_data->state;
+
+  // Remember the last idle position so we can return to later.
+  if (patron_data->move_state == kPatronMoveStateIdle) {
+    patron_data->return_position = transform_data->position;
+  }
+
+  // Move patron towards the target.
+  UpdateMovement(patron);
+
+  // Set the patron's movement target.
+  if (state == kPatronStateUpright &&
+      (patron_data->move_state != kPatronMoveStateMoveToTarget ||
+       patron_data->time_in_move_state >
+           patron_data->time_between_catch_searches)) {
+    FindProjectileAndCatch(patron);
+  }
+  if ((state == kPatronStateUpright || state == kPatronStateGettingUp) &&
+      patron_data->move_state == kPatronMoveStateIdle) {
+    FaceRaft(patron);
+  }
+
+  if (ShouldAppear(patron_data, transform_data, raft_rail_denizen)) {
+    ChangeState(patron, kPatronStateGettingUp, patron_data);
+    Animate(patron_data, PatronAction_GetUp);
+    patron_data->last_lap_upright = raft_rail_denizen->total_lap_progress;
+
+  } else if (ShouldDisappear(patron_data, transform_data, raft_rail_denizen)) {
+    ChangeState(patron, kPatronStateFalling, patron_data);
+    Animate(patron_data, PatronAction_Fall);
+
+    physics_component->DisablePhysics(patron);
+    auto rail_denizen_data = Data<RailDenizenData>(patron);
+    if (rail_denizen_data != nullptr) {
+      rail_denizen_data->enabled = false;
+      rail_denizen_data->SetSplinePlaybackRate(0.0f);
     }
+  }
+
+  // Transition to the next state if we're at the end of the current
+  // animation.
+  const bool anim_ending = AnimationEnding(patron_data, delta_time);
+  if (anim_ending) {
+    switch (patron_data->state) {
+      case kPatronStateEating:
+        ChangeState(patron, kPatronStateSatisfied, patron_data);
+        Animate(patron_data, PatronAction_Satisfied);
+        break;
+
+      case kPatronStateSatisfied:
+        ChangeState(patron, kPatronStateFalling, patron_data);
+        Animate(patron_data, PatronAction_Fall);
+        break;
+
+      case kPatronStateFalling:
+        // After the patron has finished their falling animation, turn off
+        // the physics, as they are no longer in the world.
+        physics_component->DisablePhysics(patron);
+        ChangeState(patron, kPatronStateLayingDown, patron_data);
+        break;
+
+      case kPatronStateGettingUp: {
+        ChangeState(patron, kPatronStateUpright, patron_data);
+        physics_component->EnablePhysics(patron);
+        auto rail_denizen_data = Data<RailDenizenData>(patron);
+        if (rail_denizen_data != nullptr) {
+          rail_denizen_data->enabled = true;
+          rail_denizen_data->SetPlaybackRate(
+              rail_denizen_data->initial_playback_rate,
+              corgi::kMillisecondsPerSecond *
+                  patron_data->rail_accelerate_time);
+        }
+      } FPL_FALLTHROUGH_INTENDED
+
+      case kPatronStateUpright:
+        Animate(patron_data, PatronAction_Idle);
+        break;
 
-    // Update timers.
-    const float delta_seconds =
-        static_cast<float>(delta_time) / corgi::kMillisecondsPerSecond;
-    patron_data->time_in_move_state += delta_seconds;
-    patron_data->time_in_state += delta_seconds;
-    if (IgnoredMoveState(patron_data->move_state)) {
-      patron_data->time_being_ignored += delta_seconds;
+      default:
+        break;
     }
   }
-  if (event_time_ >= 0) {
-    event_time_ += delta_time;
+
+  // Update timers.
+  const float delta_seconds =
+      static_cast<float>(delta_time) / corgi::kMillisecondsPerSecond;
+  patron_data->time_in_move_state += delta_seconds;
+  patron_data->time_in_state += delta_seconds;
+  if (IgnoredMoveState(patron_data->move_state)) {
+    patron_data->time_being_ignored += delta_seconds;
   }
 }
 
@@ -624,57 +877,88 @@ void PatronComponent::Animate(PatronData* patron_data, PatronAction action) {
 // Note:  This function is static (because it's a collision handler) so we
 // have to explicitly get a pointer to a component if want to use component
 // methods.
+// Called from inside the physics step, so just note the collision for
+// UpdateAllEntities() to handle.
 void PatronComponent::CollisionHandler(CollisionData* collision_data,
                                        void* user_data) {
   PatronComponent* patron_component = static_cast<PatronComponent*>(user_data);
-  if (patron_component->IsRegisteredWithComponent<PatronComponent>(
-          collision_data->this_entity)) {
-    patron_component->HandleCollision(collision_data->this_entity,
-                                      collision_data->other_entity,
-                                      collision_data->this_tag);
-  } else if (patron_component->IsRegisteredWithComponent<PatronComponent>(
-                 collision_data->other_entity)) {
-    patron_component->HandleCollision(collision_data->other_entity,
-                                      collision_data->this_entity,
-                                      collision_data->other_tag);
-  }
-}
-
-void PatronComponent::HandleCollision(const corgi::EntityRef& patron_entity,
-                                      const corgi::EntityRef& proj_entity,
-                                      const std::string& part_tag) {
-  // We only care about collisions with projectiles that haven't been deleted.
+  const PatronData* this_data =
+      patron_component->GetComponentData(collision_data->this_entity);
+  if (this_data != nullptr) {
+    patron_component->QueueCollision(collision_data->this_entity, this_data,
+                                     collision_data->other_entity,
+                                     collision_data->this_tag);
+    return;
+  }
+  const PatronData* other_data =
+      patron_component->GetComponentData(collision_data->other_entity);
+  if (other_data != nullptr) {
+    patron_component->QueueCollision(collision_data->other_entity, other_data,
+                                     collision_data->this_entity,
+                                     collision_data->other_tag);
+  }
+}
+
+// Only collisions with the target body can feed the patron.
+void PatronComponent::QueueCollision(const corgi::EntityRef& patron_entity,
+                                     const PatronData* patron_data,
+                                     const corgi::EntityRef& proj_entity,
+                                     const std::string& part_tag) {
+  if (!patron_data->target_tag.empty() && patron_data->target_tag != part_tag) {
+    return;
+  }
+  pending_collisions_.push_back(PendingCollision(patron_entity, proj_entity));
+}
+
+void PatronComponent::DispatchCollisions(
+    const RailDenizenData* raft_rail_denizen) {
+  std::sort(pending_collisions_.begin(), pending_collisions_.end());
+  const auto end =
+      std::unique(pending_collisions_.begin(), pending_collisions_.end());
+  for (auto it = pending_collisions_.begin(); it != end; ++it) {
+    // Either entity may have been deleted since the physics step.
+    if (!it->patron || !it->other) continue;
+    HandleCollision(it->patron, it->other, raft_rail_denizen);
+  }
+  pending_collisions_.clear();
+}
+
+void PatronComponent::HandleCollision(
+    const corgi::EntityRef& patron_entity, const corgi::EntityRef& proj_entity,
+    const RailDenizenData* raft_rail_denizen) {
+  // We only care about collisions with projectiles that haven't been deleted
+  // or released.
   PlayerProjectileData* projectile_data =
       Data<PlayerProjectileData>(proj_entity);
-  if (projectile_data == nullptr || proj_entity->marked_for_deletion()) {
+  if (projectile_data == nullptr || !projectile_data->active ||
+      proj_entity->marked_for_deletion()) {
     return;
   }
-  corgi::EntityRef raft =
-      entity_manager_->GetComponent<ServicesComponent>()->raft_entity();
-  RailDenizenData* raft_rail_denizen = Data<RailDenizenData>(raft);
   PatronData* patron_data = Data<PatronData>(patron_entity);
-  if (patron_data->state == kPatronStateUpright) {
-    // If the target tag was hit, consider it being fed
-    if (patron_data->target_tag == "" || patron_data->target_tag == part_tag) {
-      SetState(patron_data->play_eating_animation ? kPatronStateEating
-                                                  : kPatronStateSatisfied,
-               patron_data);
-      Animate(patron_data,
-              patron_data->play_eating_animation ? PatronAction_Eat
-                                                 : PatronAction_Satisfied);
-      patron_data->last_lap_fed = raft_rail_denizen->total_lap_progress;
-
-      // Disable rail movement after they have been fed
-      auto rail_denizen_data = Data<RailDenizenData>(patron_entity);
-      if (rail_denizen_data != nullptr) {
-        rail_denizen_data->enabled = false;
-        rail_denizen_data->SetSplinePlaybackRate(0.0f);
-      }
-      SpawnPointDisplay(patron_entity);
-      // Delete the projectile, as it has been consumed.
-      entity_manager_->DeleteEntity(proj_entity);
-    }
+  if (patron_data == nullptr || patron_data->state != kPatronStateUpright) {
+    return;
   }
+
+  // The target was hit, so consider the patron fed.
+  SetState(patron_data->play_eating_animation ? kPatronStateEating
+                                              : kPatronStateSatisfied,
+           patron_data);
+  Animate(patron_data, patron_data->play_eating_animation
+                           ? PatronAction_Eat
+                           : PatronAction_Satisfied);
+  patron_data->last_lap_fed = raft_rail_denizen->total_lap_progress;
+
+  // Disable rail movement after they have been fed
+  auto rail_denizen_data = Data<RailDenizenData>(patron_entity);
+  if (rail_denizen_data != nullptr) {
+    rail_denizen_data->enabled = false;
+    rail_denizen_data->SetSplinePlaybackRate(0.0f);
+  }
+  SpawnPointDisplay(patron_entity);
+  // Return the projectile to its pool, as it has been consumed.
+  corgi::EntityRef projectile = proj_entity;
+  entity_manager_->GetComponent<PlayerProjectileComponent>()
+      ->ReleaseProjectile(projectile);
 }
 
 void PatronComponent::SpawnPointDisplay(const corgi::EntityRef& patron) {
@@ -768,13 +1052,47 @@ vec3 PatronComponent::RaftPosition() const {
   return raft_transform->position;
 }
 
-const EntityRef* PatronComponent::ClosestProjectile(
-    const EntityRef& patron, vec3* closest_position,
-    motive::Angle* closest_face_angle, float* closest_time) const {
+void PatronComponent::UpdateProjectileGrid() {
+  // The grid has to cover every patron's search, so use the longest search
+  // window and distance of any of them. Only awake patrons search.
+  float start_time = 0.0f;
+  float end_time = 0.0f;
+  float search_distance = kMinProjectileGridCellSize;
+  for (auto it = awake_patrons_.begin(); it != awake_patrons_.end(); ++it) {
+    const PatronData* patron_data = GetComponentData(*it);
+    start_time =
+        std::min(start_time, patron_data->catch_time_for_search.start());
+    end_time = std::max(end_time, patron_data->catch_time_for_search.end());
+    search_distance =
+        std::max(search_distance, patron_data->max_catch_distance_for_search);
+  }
+
   // TODO: change projectile_component to const when Component gets a
   //       const_iterator.
   PlayerProjectileComponent* projectile_component =
       entity_manager_->GetComponent<PlayerProjectileComponent>();
+  PhysicsComponent* physics_component =
+      entity_manager_->GetComponent<PhysicsComponent>();
+  projectile_grid_.Clear();
+  for (auto it = projectile_component->begin();
+       it != projectile_component->end(); ++it) {
+    if (!it->data.active) continue;
+    const TransformData* projectile_transform =
+        entity_manager_->GetComponentData<TransformData>(it->entity);
+    const PhysicsData* projectile_physics =
+        entity_manager_->GetComponentData<PhysicsData>(it->entity);
+    projectile_grid_.AddProjectile(
+        it->entity, projectile_transform->position,
+        projectile_physics->Velocity(),  // In m/s.
+        physics_component->GravityForEntity(it->entity));
+  }
+  projectile_grid_.Build(start_time, end_time, search_distance);
+  projectile_grid_dirty_ = false;
+}
+
+const EntityRef* PatronComponent::ClosestProjectile(
+    const EntityRef& patron, vec3* closest_position,
+    motive::Angle* closest_face_angle, float* closest_time) const {
   const TransformData* patron_transform = Data<TransformData>(patron);
   const PatronData* patron_data = GetComponentData(patron);
 
@@ -786,22 +1104,27 @@ const EntityRef* PatronComponent::ClosestProjectile(
   // Gather data about the raft, which is needed in the calculations.
   const vec3 raft_position_xy = ZeroHeight(RaftPosition());
 
-  // Loop through every projectile. Keep a reference to the closest one.
+  // Loop through the projectiles that might come within reach, after the
+  // cheap rejections have been done in bulk. Keep a reference to the closest
+  // one.
   const EntityRef* closest_ref = nullptr;
   float max_dist_sq = patron_data->max_catch_distance_for_search *
                       patron_data->max_catch_distance_for_search;
   float closest_dist_sq = max_dist_sq;
   vec3 closest_position_xy = mathfu::kZeros3f;
-  auto physics_component = entity_manager_->GetComponent<PhysicsComponent>();
-  for (auto it = projectile_component->begin();
-       it != projectile_component->end(); ++it) {
+  InterceptTarget target;
+  target.x = patron_position_xy.x;
+  target.y = patron_position_xy.y;
+  target.max_distance_sq = max_dist_sq;
+  target.limit_return = patron_data->move_state == kPatronMoveStateReturn;
+  target.return_x = return_position_xy.x;
+  target.return_y = return_position_xy.y;
+  const std::vector<int>& candidates =
+      projectile_grid_.QueryIntercepts(target);
+  for (auto it = candidates.begin(); it != candidates.end(); ++it) {
     // Get movement state of projectile.
-    const TransformData* projectile_transform =
-        entity_manager_->GetComponentData<TransformData>(it->entity);
-    const PhysicsData* projectile_physics =
-        entity_manager_->GetComponentData<PhysicsData>(it->entity);
-    const vec3 projectile_position = projectile_transform->position;
-    const vec3 projectile_velocity = projectile_physics->Velocity();  // In m/s.
+    const vec3 projectile_position = projectile_grid_.position(*it);
+    const vec3 projectile_velocity = projectile_grid_.velocity(*it);
     const vec3 projectile_position_xy = ZeroHeight(projectile_position);
     const vec3 projectile_velocity_xy = ZeroHeight(projectile_velocity);
 
@@ -839,7 +1162,7 @@ const EntityRef* PatronComponent::ClosestProjectile(
     const float closest_t = CalculateClosestTimeInHeightRange(
         closest_t_ignore_height, patron_data->catch_time_for_search,
         target_height_range, projectile_position.z, projectile_velocity.z,
-        physics_component->GravityForEntity(it->entity));
+        projectile_grid_.gravity(*it));
     if (!patron_data->catch_time_for_search.Contains(closest_t)) continue;
 
     // Calculate the projectile position at `closest_t`.
@@ -863,7 +1186,7 @@ const EntityRef* PatronComponent::ClosestProjectile(
     *closest_time = closest_t;
     *closest_face_angle = motive::Angle::FromYXVector(projectile_position_xy -
                                                       intercept_position_xy);
-    closest_ref = &it->entity;
+    closest_ref = &projectile_grid_.entity(*it);
     closest_dist_sq = dist_sq;
   }
 
@@ -886,6 +1209,8 @@ const EntityRef* PatronComponent::ClosestProjectile(
 }
 
 void PatronComponent::FindProjectileAndCatch(const EntityRef& patron) {
+  if (projectile_grid_dirty_) UpdateProjectileGrid();
+
   // Find the projectile that's the closest.
   vec3 closest_position;
   motive::Angle closest_face_angle;
@@ -18,6 +18,7 @@
 #include "breadboard/event.h"
 #include "breadboard/graph.h"
 #include "breadboard/graph_state.h"
+#include "compiled_def_cache.h"
 #include "components/rail_denizen.h"
 #include "components_generated.h"
 #include "config_generated.h"
@@ -31,6 +32,7 @@
 #include "motive/math/angle.h"
 #include "motive/math/range.h"
 #include "motive/motivator.h"
+#include "projectile_grid.h"
 
 namespace fpl {
 namespace zooshi {
@@ -126,7 +128,9 @@ struct PatronData {
         rail_accelerate_time(0.0f),
         time_to_face_raft(0.0f),
         time_exasperated_before_disappearing(1.0f),
-        exasperated_playback_rate(2.0f) {}
+        exasperated_playback_rate(2.0f),
+        activation_position(mathfu::kZeros3f),
+        awake(false) {}
 
   // Whether the patron is standing up or falling down.
   PatronState state;
@@ -267,17 +271,33 @@ struct PatronData {
   // If true: when fed play eat, satisfied, disappear animations.
   // If false: when fed play satisfied, disappear animations.
   bool play_eating_animation;
+
+  // Spans of the raft's lap progress during which the raft may be within the
+  // pop in radius of `activation_position`. Spans are within [0, 1], and
+  // those that cross the end of the lap are split in two.
+  std::vector<motive::Range> activation_windows;
+  mathfu::vec3 activation_position;
+
+  // Whether the patron is in PatronComponent's list of patrons to update.
+  bool awake;
 };
 
 class PatronComponent : public corgi::Component<PatronData> {
  public:
-  PatronComponent() : config_(nullptr), event_time_(-1) {}
+  PatronComponent()
+      : config_(nullptr),
+        event_time_(-1),
+        projectile_grid_dirty_(true),
+        active_lists_dirty_(true),
+        timeline_progress_(0.0f),
+        raft_rail_(nullptr) {}
   virtual ~PatronComponent() {}
 
   virtual void Init();
   virtual void AddFromRawData(corgi::EntityRef& parent, const void* raw_data);
   virtual RawDataUniquePtr ExportRawData(const corgi::EntityRef& entity) const;
   virtual void InitEntity(corgi::EntityRef& entity);
+  virtual void CleanupEntity(corgi::EntityRef& entity);
   virtual void UpdateAllEntities(corgi::WorldTime delta_time);
 
   void UpdateAndEnablePhysics();
@@ -285,6 +305,10 @@ class PatronComponent : public corgi::Component<PatronData> {
   // This needs to be called after the entities have been loaded from data.
   void PostLoadFixup();
 
+  // Forget the decoded PatronDefs. Call when the definitions that patrons
+  // were loaded from may be freed.
+  void ClearCompiledDefs() { compiled_defs_.Clear(); }
+
   // Each patron (optionally) holds a sequence of animations in
   // `PatronData::events`. These events are followed after StartEvent() is
   // called.
@@ -301,9 +325,121 @@ class PatronComponent : public corgi::Component<PatronData> {
       corgi::component_library::CollisionData* collision_data, void* user_data);
 
  private:
+  // The point in the raft's lap at which one of a patron's activation
+  // windows opens.
+  struct ActivationEvent {
+    ActivationEvent(float lap_progress, const corgi::EntityRef& patron)
+        : lap_progress(lap_progress), patron(patron) {}
+
+    bool operator<(const ActivationEvent& rhs) const {
+      return lap_progress < rhs.lap_progress;
+    }
+
+    float lap_progress;
+    corgi::EntityRef patron;
+  };
+
+  // A patron's target body touching another entity during the physics step.
+  struct PendingCollision {
+    PendingCollision(const corgi::EntityRef& patron,
+                     const corgi::EntityRef& other)
+        : patron(patron), other(other) {}
+
+    // Groups the collisions by patron, so repeats are adjacent.
+    bool operator<(const PendingCollision& rhs) const {
+      return patron.index() != rhs.patron.index()
+                 ? patron.index() < rhs.patron.index()
+                 : other.index() < rhs.other.index();
+    }
+    bool operator==(const PendingCollision& rhs) const {
+      return patron == rhs.patron && other == rhs.other;
+    }
+
+    corgi::EntityRef patron;
+    corgi::EntityRef other;
+  };
+
+  // The settings in a PatronDef, decoded into the form PatronData holds them
+  // in. AddFromRawData() copies these into each patron loaded from the def.
+  struct CompiledDef {
+    CompiledDef()
+        : anim_object(AnimObject_HungryHippo),
+          pop_out_radius(0.0f),
+          min_lap(0.0f),
+          max_lap(0.0f),
+          has_events(false),
+          has_target_tag(false),
+          max_catch_distance(0.0f),
+          max_catch_distance_for_search(0.0f),
+          max_catch_angle(0.0f),
+          point_display_height(0.0f),
+          time_to_face_raft(0.0f),
+          play_eating_animation(false),
+          time_between_catch_searches(0.0f),
+          return_time(0.0f),
+          rail_accelerate_time(0.0f),
+          time_exasperated_before_disappearing(0.0f),
+          exasperated_playback_rate(0.0f) {}
+
+    AnimObject anim_object;
+    Interpolants pop_in_radius;
+    float pop_out_radius;
+    float min_lap;
+    float max_lap;
+    Interpolants patience;
+
+    // The def only replaces a patron's events and target tag when it has
+    // them, so that a level can tweak a prototype's patron without losing
+    // them.
+    bool has_events;
+    std::vector<PatronEvent> events;
+    bool has_target_tag;
+    std::string target_tag;
+
+    float max_catch_distance;
+    float max_catch_distance_for_search;
+    float max_catch_angle;
+    float point_display_height;
+    motive::Angle max_face_angle_away_from_raft;
+    float time_to_face_raft;
+    bool play_eating_animation;
+    motive::Range catch_time_for_search;
+    motive::Range catch_time;
+    motive::Range catch_speed;
+    float time_between_catch_searches;
+    float return_time;
+    float rail_accelerate_time;
+    float time_exasperated_before_disappearing;
+    float exasperated_playback_rate;
+  };
+
+  static void CompileDef(const PatronDef* def, CompiledDef* compiled);
+
+  void RebuildActiveLists(const RailDenizenData* raft_rail_denizen);
+  void RebuildTimeline(const RailDenizenData* raft_rail_denizen);
+  void ComputeActivationWindows(const mathfu::vec3& position,
+                                PatronData* patron_data) const;
+  void MoveActivationWindows(const corgi::EntityRef& patron,
+                             PatronData* patron_data);
+  void WakePatrons(float begin_progress, float end_progress);
+  void AdvanceTimeline(const RailDenizenData* raft_rail_denizen);
+  bool CanSleep(const PatronData* patron_data) const;
+  bool ShouldSleep(const corgi::EntityRef& patron, float lap_progress);
+  void ChangeState(corgi::EntityRef& patron, PatronState state,
+                   PatronData* patron_data);
+  void UpdateEventPatron(corgi::EntityRef& patron,
+                         corgi::WorldTime delta_time);
+  void UpdatePatron(corgi::EntityRef& patron,
+                    const RailDenizenData* raft_rail_denizen,
+                    corgi::WorldTime delta_time);
+  void QueueCollision(const corgi::EntityRef& patron_entity,
+                      const PatronData* patron_data,
+                      const corgi::EntityRef& proj_entity,
+                      const std::string& part_tag);
+  void DispatchCollisions(const RailDenizenData* raft_rail_denizen);
   void HandleCollision(const corgi::EntityRef& patron_entity,
                        const corgi::EntityRef& proj_entity,
-                       const std::string& part_tag);
+                       const RailDenizenData* raft_rail_denizen);
   void UpdateMovement(const corgi::EntityRef& patron);
   void SpawnPointDisplay(const corgi::EntityRef& patron);
   bool ShouldAppear(
@@ -327,6 +463,7 @@ class PatronComponent : public corgi::Component<PatronData> {
                                             mathfu::vec3* closest_position,
                                             motive::Angle* closest_face_angle,
                                             float* closest_time) const;
+  void UpdateProjectileGrid();
   void FindProjectileAndCatch(const corgi::EntityRef& patron);
   void MoveToTarget(const corgi::EntityRef& patron,
                     const mathfu::vec3& target_position,
@@ -339,6 +476,38 @@ class PatronComponent : public corgi::Component<PatronData> {
 
   // Current time into the "event". i.e. the set-up sequence of animations.
   corgi::WorldTime event_time_;
+
+  // Projectiles in flight, indexed by where they're heading. Rebuilt on the
+  // first projectile search of each frame.
+  ProjectileGrid projectile_grid_;
+  bool projectile_grid_dirty_;
+
+  // Collisions reported by the physics step since the last update. The same
+  // pair is usually reported several times, once per contact point and
+  // physics sub-step, so they're sorted and handled once each afterwards.
+  std::vector<PendingCollision> pending_collisions_;
+
+  // Patrons are only updated while there's something for them to do. Those
+  // with events only act while an event is playing. The rest are awake until
+  // they've settled laying down, outside of all of their activation windows,
+  // then sleep until the raft's lap progress enters one of them again. The
+  // lists are rebuilt from scratch when patrons are added or removed.
+  std::vector<corgi::EntityRef> event_patrons_;
+  std::vector<corgi::EntityRef> awake_patrons_;
+  bool active_lists_dirty_;
+
+  // Where every activation window opens, sorted by lap progress, and the
+  // raft's lap progress when the timeline was last advanced. Each frame, only
+  // the patrons whose windows the raft has entered since are woken.
+  std::vector<ActivationEvent> timeline_;
+  float timeline_progress_;
+
+  // The rail the activation windows were found along.
+  const Rail* raft_rail_;
+
+  // PatronDefs already decoded, mostly those of the prototypes in the entity
+  // library, which many patrons share.
+  CompiledDefCache<PatronDef, CompiledDef> compiled_defs_;
 };
 
 }  // zooshi
@@ -36,7 +36,6 @@ namespace zooshi {
 BREADBOARD_DEFINE_EVENT(kOnFireEventId)
 
 using corgi::component_library::CommonServicesComponent;
-using corgi::component_library::GraphComponent;
 using corgi::component_library::GraphData;
 using corgi::component_library::PhysicsComponent;
 using corgi::component_library::PhysicsData;
@@ -46,19 +45,30 @@ using corgi::component_library::TransformData;
 void PlayerComponent::Init() {
   config_ = entity_manager_->GetComponent<ServicesComponent>()->config();
 }
+void PlayerComponent::HandleInput() {
+  if (state_ == kPlayerState_Disabled) return;
+  for (auto iter = component_data_.begin(); iter != component_data_.end();
+       ++iter) {
+    PlayerData* player_data = Data<PlayerData>(iter->entity);
+    BasePlayerController* controller = player_data->input_controller();
+    controller->Update();
+    if (controller->Button(kFireProjectile).Value() &&
+        controller->Button(kFireProjectile).HasChanged()) {
+      player_data->set_fire_requested(true);
+    }
+  }
+}
+
 void PlayerComponent::UpdateAllEntities(corgi::WorldTime /*delta_time*/) {
   for (auto iter = component_data_.begin(); iter != component_data_.end();
        ++iter) {
     PlayerData* player_data = Data<PlayerData>(iter->entity);
     TransformData* transform_data = Data<TransformData>(iter->entity);
-    if (state_ != kPlayerState_Disabled) {
-      player_data->input_controller()->Update();
-    }
     transform_data->orientation =
         mathfu::quat::RotateFromTo(player_data->GetFacing(), mathfu::kAxisY3f);
-    if (state_ == kPlayerState_Active &&
-        player_data->input_controller()->Button(kFireProjectile).Value() &&
-        player_data->input_controller()->Button(kFireProjectile).HasChanged()) {
+    const bool fire = player_data->fire_requested();
+    player_data->set_fire_requested(false);
+    if (state_ == kPlayerState_Active && fire) {
       SpawnProjectile(iter->entity);
 
       GraphData* graph_data = Data<GraphData>(iter->entity);
@@ -102,13 +112,8 @@ corgi::EntityRef PlayerComponent::SpawnProjectile(corgi::EntityRef source) {
           ->SelectedSushi()
           ->data());
   corgi::EntityRef projectile =
-      entity_manager_->GetComponent<ServicesComponent>()
-          ->entity_factory()
-          ->CreateEntityFromPrototype(current_sushi->prototype()->c_str(),
-                                      entity_manager_);
-  GraphComponent* graph_component =
-      entity_manager_->GetComponent<GraphComponent>();
-  graph_component->EntityPostLoadFixup(projectile);
+      entity_manager_->GetComponent<PlayerProjectileComponent>()
+          ->AcquireProjectile(current_sushi->prototype()->c_str());
 
   TransformData* transform_data = Data<TransformData>(projectile);
   PhysicsData* physics_data = Data<PhysicsData>(projectile);
@@ -138,9 +143,6 @@ corgi::EntityRef PlayerComponent::SpawnProjectile(corgi::EntityRef source) {
 
   projectile_data->owner = source;
 
-  // TODO: Preferably, this should be a step in the entity creation.
-  transform_component->UpdateChildLinks(projectile);
-
   Data<AttributesData>(source)->attributes[AttributeDef_ProjectilesFired]++;
 
   return corgi::EntityRef();
@@ -41,7 +41,7 @@ enum PlayerState {
 
 class PlayerData {
  public:
-  PlayerData() : input_controller_(nullptr) {}
+  PlayerData() : input_controller_(nullptr), fire_requested_(false) {}
 
   mathfu::vec3 GetFacing() const { return input_controller_->facing().Value(); }
   mathfu::vec3 GetUp() const { return input_controller_->up().Value(); }
@@ -55,9 +55,16 @@ class PlayerData {
     return patrons_feed_status_;
   }
 
+  // Whether the fire button was pressed since the last update.
+  bool fire_requested() const { return fire_requested_; }
+  void set_fire_requested(bool fire_requested) {
+    fire_requested_ = fire_requested;
+  }
+
  private:
   BasePlayerController* input_controller_;
   std::set<std::string> patrons_feed_status_;
+  bool fire_requested_;
 };
 
 class PlayerComponent : public corgi::Component<PlayerData> {
@@ -72,6 +79,10 @@ class PlayerComponent : public corgi::Component<PlayerData> {
   virtual void UpdateAllEntities(corgi::WorldTime delta_time);
   virtual void InitEntity(corgi::EntityRef& entity);
 
+  // Update the players' controllers from the input polled for this frame,
+  // and remember any press of the fire button for the next update.
+  void HandleInput();
+
   corgi::EntityRef SpawnProjectile(corgi::EntityRef source);
   mathfu::vec3 CalculateProjectileDirection(corgi::EntityRef source) const;
 
@@ -14,12 +14,20 @@
 
 #include "components/player_projectile.h"
 
+#include <string.h>
+#include <algorithm>
+
 #include "components/services.h"
+#include "components/sound.h"
+#include "components/time_limit.h"
 #include "corgi_component_library/common_services.h"
+#include "corgi_component_library/physics.h"
+#include "corgi_component_library/rendermesh.h"
 #include "corgi_component_library/transform.h"
 #include "flatbuffers/flatbuffers.h"
 #include "flatbuffers/reflection.h"
 #include "pindrop/pindrop.h"
+#include "world.h"
 
 CORGI_DEFINE_COMPONENT(fpl::zooshi::PlayerProjectileComponent,
                        fpl::zooshi::PlayerProjectileData)
@@ -28,14 +36,139 @@ namespace fpl {
 namespace zooshi {
 
 using corgi::component_library::CommonServicesComponent;
+using corgi::component_library::GraphComponent;
+using corgi::component_library::PhysicsComponent;
+using corgi::component_library::RenderMeshComponent;
 using corgi::component_library::TransformComponent;
 using corgi::component_library::TransformData;
 
+static void RemoveEntityRef(const corgi::EntityRef& entity,
+                            std::vector<corgi::EntityRef>* entities) {
+  auto it = std::find(entities->begin(), entities->end(), entity);
+  if (it != entities->end()) entities->erase(it);
+}
+
 void PlayerProjectileComponent::AddFromRawData(corgi::EntityRef& entity,
                                                const void* /*raw_data*/) {
   AddEntity(entity);
   entity_manager_->AddEntityToComponent<TransformComponent>(entity);
 }
 
+void PlayerProjectileComponent::CleanupEntity(corgi::EntityRef& entity) {
+  const PlayerProjectileData* projectile_data = GetComponentData(entity);
+  if (projectile_data->active) return;
+
+  // A pooled projectile is being deleted, with the rest of the world.
+  RemoveEntityRef(entity, &released_);
+  Pool* pool = FindPool(projectile_data->prototype.c_str());
+  if (pool != nullptr) RemoveEntityRef(entity, &pool->projectiles);
+}
+
+void PlayerProjectileComponent::UpdateAllEntities(
+    corgi::WorldTime /*delta_time*/) {
+  for (auto it = released_.begin(); it != released_.end(); ++it) {
+    Deactivate(*it);
+    const PlayerProjectileData* projectile_data = GetComponentData(*it);
+    FindPool(projectile_data->prototype.c_str())->projectiles.push_back(*it);
+  }
+  released_.clear();
+}
+
+PlayerProjectileComponent::Pool* PlayerProjectileComponent::FindPool(
+    const char* prototype) {
+  for (auto it = pools_.begin(); it != pools_.end(); ++it) {
+    if (strcmp(it->prototype.c_str(), prototype) == 0) return &*it;
+  }
+  return nullptr;
+}
+
+corgi::EntityRef PlayerProjectileComponent::CreateProjectile(
+    const char* prototype) {
+  corgi::EntityRef projectile =
+      entity_manager_->GetComponent<ServicesComponent>()
+          ->entity_factory()
+          ->CreateEntityFromPrototype(prototype, entity_manager_);
+  entity_manager_->GetComponent<GraphComponent>()->EntityPostLoadFixup(
+      projectile);
+  entity_manager_->GetComponent<TransformComponent>()->UpdateChildLinks(
+      projectile);
+  GetComponentData(projectile)->prototype = prototype;
+
+  if (FindPool(prototype) == nullptr) {
+    pools_.push_back(Pool());
+    pools_.back().prototype = prototype;
+  }
+  return projectile;
+}
+
+void PlayerProjectileComponent::Preallocate(const char* prototype,
+                                            int count) {
+  const Pool* pool = FindPool(prototype);
+  int pooled = pool == nullptr ? 0 : static_cast<int>(pool->projectiles.size());
+  for (; pooled < count; ++pooled) {
+    corgi::EntityRef projectile = CreateProjectile(prototype);
+    GetComponentData(projectile)->active = false;
+    Deactivate(projectile);
+    FindPool(prototype)->projectiles.push_back(projectile);
+  }
+}
+
+corgi::EntityRef PlayerProjectileComponent::AcquireProjectile(
+    const char* prototype) {
+  Pool* pool = FindPool(prototype);
+  if (pool == nullptr || pool->projectiles.empty()) {
+    return CreateProjectile(prototype);
+  }
+
+  corgi::EntityRef projectile = pool->projectiles.back();
+  pool->projectiles.pop_back();
+  GetComponentData(projectile)->active = true;
+
+  TimeLimitData* time_limit_data = Data<TimeLimitData>(projectile);
+  TransformData* transform_data = Data<TransformData>(projectile);
+  transform_data->orientation = mathfu::kQuatIdentityf;
+  if (time_limit_data != nullptr) {
+    time_limit_data->enabled = true;
+    time_limit_data->time_elapsed = 0;
+    transform_data->scale = time_limit_data->original_scale;
+  }
+  entity_manager_->GetComponent<RenderMeshComponent>()
+      ->SetVisibilityRecursively(projectile, true);
+  entity_manager_->GetComponent<PhysicsComponent>()->EnablePhysics(
+      projectile);
+  if (Data<SoundData>(projectile) != nullptr) {
+    entity_manager_->GetComponent<SoundComponent>()->Play(projectile);
+  }
+  // The projectile is about to be launched from somewhere else entirely, so
+  // don't draw it moving there from wherever it was last used.
+  World* world = entity_manager_->GetComponent<ServicesComponent>()->world();
+  world->world_renderer->SnapInterpolation(projectile, world);
+  return projectile;
+}
+
+void PlayerProjectileComponent::ReleaseProjectile(
+    corgi::EntityRef& projectile) {
+  PlayerProjectileData* projectile_data = GetComponentData(projectile);
+  if (projectile_data == nullptr || projectile_data->prototype.empty()) {
+    entity_manager_->DeleteEntity(projectile);
+    return;
+  }
+  if (!projectile_data->active) return;
+  projectile_data->active = false;
+  released_.push_back(projectile);
+}
+
+void PlayerProjectileComponent::Deactivate(corgi::EntityRef& projectile) {
+  entity_manager_->GetComponent<PhysicsComponent>()->DisablePhysics(
+      projectile);
+  entity_manager_->GetComponent<RenderMeshComponent>()
+      ->SetVisibilityRecursively(projectile, false);
+  if (Data<SoundData>(projectile) != nullptr) {
+    entity_manager_->GetComponent<SoundComponent>()->Stop(projectile);
+  }
+  TimeLimitData* time_limit_data = Data<TimeLimitData>(projectile);
+  if (time_limit_data != nullptr) time_limit_data->enabled = false;
+}
+
 }  // zooshi
 }  // fpl
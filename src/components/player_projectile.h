@@ -16,6 +16,7 @@
 #define FPL_ZOOSHI_COMPONENTS_PLAYER_PROJECTILE_H_
 
 #include <string>
+#include <vector>
 
 #include "components_generated.h"
 #include "corgi/component.h"
@@ -31,22 +32,67 @@ static const corgi::WorldTime kMaxProjectileDuration = 3000;
 
 // Data for scene object components.
 struct PlayerProjectileData {
+  PlayerProjectileData() : active(true) {}
+
   corgi::EntityRef owner;  // The player that "owns" this projectile.
 
   // The graph that may trigger when colliding with another entity.
   std::map<std::string, SerializableGraphState> on_collision;
+
+  // The prototype this projectile was created from, if it was created by
+  // AcquireProjectile(). Such projectiles are recycled rather than deleted.
+  std::string prototype;
+
+  // False from when the projectile is released until it's thrown again.
+  bool active;
 };
 
+// Keeps a pool of projectiles for each prototype, so that throwing sushi
+// doesn't have to create an entity, with its physics bodies and graphs, and
+// the projectile doesn't have to be deleted when it's done. A projectile
+// waiting in a pool is hidden, and has its physics, sound and time limit
+// switched off.
 class PlayerProjectileComponent
     : public corgi::Component<PlayerProjectileData> {
  public:
   virtual ~PlayerProjectileComponent() {}
 
   virtual void InitEntity(corgi::EntityRef& /*entity*/) {}
-  virtual void CleanupEntity(corgi::EntityRef& /*entity*/) {}
+  virtual void CleanupEntity(corgi::EntityRef& entity);
 
   virtual void AddFromRawData(corgi::EntityRef& entity, const void* data);
-  virtual void UpdateAllEntities(corgi::WorldTime /*delta_time*/) {}
+  virtual void UpdateAllEntities(corgi::WorldTime delta_time);
+
+  // Create projectiles of `prototype` until at least `count` are waiting in
+  // its pool.
+  void Preallocate(const char* prototype, int count);
+
+  // Return a projectile of `prototype`, taken from its pool if possible. It is
+  // visible, with physics enabled, and its time limit and sound restarted.
+  // The caller should place it and set its velocity.
+  corgi::EntityRef AcquireProjectile(const char* prototype);
+
+  // Finish with a projectile. Pooled projectiles are deactivated at the start
+  // of the next update, since this may be called while physics is reporting
+  // collisions. Others are deleted.
+  void ReleaseProjectile(corgi::EntityRef& projectile);
+
+ private:
+  struct Pool {
+    std::string prototype;
+    std::vector<corgi::EntityRef> projectiles;
+  };
+
+  Pool* FindPool(const char* prototype);
+  corgi::EntityRef CreateProjectile(const char* prototype);
+  void Deactivate(corgi::EntityRef& projectile);
+
+  // Pools are looked up by linear search, since there are only a few sushi
+  // types, and it avoids building a string on every throw.
+  std::vector<Pool> pools_;
+
+  // Projectiles released since the last update, to be deactivated.
+  std::vector<corgi::EntityRef> released_;
 };
 
 }  // zooshi
@@ -34,8 +34,10 @@
 #include "mathfu/constants.h"
 #include "motive/init.h"
 #include "rail_def_generated.h"
+#include "rail_denizen_kernel.h"
 #include "scene_lab/scene_lab.h"
 #include "scene_lab/corgi/corgi_adapter.h"
+#include "world.h"
 
 using mathfu::vec3;
 using corgi::component_library::GraphData;
@@ -94,6 +96,20 @@ void RailDenizenData::Initialize(const Rail& r,
   rail = &r;
 }
 
+void RailDenizenData::Reseat() {
+  // The motivators only look at a spline's nodes as they reach them, so set
+  // the splines again, from where the motivators are now.
+  const float rate = PlaybackRate();
+  motivator.SetSplines(
+      rail->Splines(),
+      motive::SplinePlayback(static_cast<float>(motivator.SplineTime()), true,
+                             rate));
+  orientation_motivator.SetSplines(
+      rail->Splines(),
+      motive::SplinePlayback(
+          static_cast<float>(orientation_motivator.SplineTime()), true, rate));
+}
+
 void RailDenizenData::SetPlaybackRate(float rate, float transition_time) {
   const auto time = static_cast<motive::MotiveTime>(transition_time);
   playback_rate.SetTarget(motive::Target1f(rate, 0.0f, time));
@@ -118,47 +134,133 @@ void RailDenizenComponent::Init() {
           UpdateRailNodeData(entity);
         });
     scene_lab->AddOnEnterEditorCallback([this]() { OnEnterEditor(); });
-    scene_lab->AddOnExitEditorCallback([this]() { PostLoadFixup(); });
+    scene_lab->AddOnExitEditorCallback([this]() {
+      compiled_defs_.set_enabled(true);
+      PostLoadFixup();
+    });
   }
 }
 
+// The arrays in RailDenizenComponent::batch_, in order.
+enum RailDenizenBatchArray {
+  kBatchX,
+  kBatchY,
+  kBatchZ,
+  kBatchDirectionX,
+  kBatchDirectionY,
+  kBatchDirectionZ,
+  kBatchOrientationS,
+  kBatchOrientationX,
+  kBatchOrientationY,
+  kBatchOrientationZ,
+  kBatchScaleX,
+  kBatchScaleY,
+  kBatchScaleZ,
+  kBatchOffsetX,
+  kBatchOffsetY,
+  kBatchOffsetZ,
+  kBatchWorldX,
+  kBatchWorldY,
+  kBatchWorldZ,
+  kBatchTargetS,
+  kBatchTargetX,
+  kBatchTargetY,
+  kBatchTargetZ,
+  kBatchArrayCount
+};
+
 void RailDenizenComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
+  batch_entities_.clear();
+  new_lap_entities_.clear();
+  jumped_entities_.clear();
   for (auto iter = component_data_.begin(); iter != component_data_.end();
        ++iter) {
-    RailDenizenData* rail_denizen_data = GetComponentData(iter->entity);
-    if (!rail_denizen_data->enabled) {
-      continue;
+    if (GetComponentData(iter->entity)->enabled) {
+      batch_entities_.push_back(iter->entity);
     }
+  }
+  const int count = static_cast<int>(batch_entities_.size());
+  batch_.resize(kBatchArrayCount * count);
+  float* arrays[kBatchArrayCount];
+  for (int i = 0; i < kBatchArrayCount; ++i) {
+    arrays[i] = batch_.data() + i * count;
+  }
+
+  // The motive engine has already advanced every denizen along its spline, so
+  // gather where they are and which way they're heading, and compute all
+  // their world transforms at once.
+  for (int i = 0; i < count; ++i) {
+    RailDenizenData* rail_denizen_data = GetComponentData(batch_entities_[i]);
     rail_denizen_data->SetSplinePlaybackRate(rail_denizen_data->PlaybackRate());
-    TransformData* transform_data = Data<TransformData>(iter->entity);
-    vec3 position = rail_denizen_data->rail_orientation.Inverse() *
-                    rail_denizen_data->Position();
-    position *= rail_denizen_data->rail_scale;
-    position += rail_denizen_data->rail_offset;
-    transform_data->position = position;
-    if (rail_denizen_data->update_orientation) {
-      float convergence_rate = rail_denizen_data->orientation_convergence_rate;
-      const motive::Motivator3f& motivator =
-          convergence_rate == 0.0f ? rail_denizen_data->motivator
-                                   : rail_denizen_data->orientation_motivator;
-
-      // Rotating towards the Z axis is a bit complicated, because we want that
-      // rotation to happen in local space (so the front of the raft goes up),
-      // but rotation on the XY plane should happen in world space. So we need
-      // to separate the two rotations from each other to accomplish this.
-      vec3 world_direction = motivator.Direction();
-      const float z_length = world_direction.z;
-      world_direction.z = 0.0f;
-      const float xy_length = world_direction.Length();
-      float z_angle(atan2f(z_length, xy_length));
-      if (z_angle < -M_PI) {
-        z_angle = M_PI;
-      }
+    const vec3 position = rail_denizen_data->Position();
+    // Denizens that don't turn skip the work of finding their direction.
+    // For the rest, the kernel pitches towards the Z axis in local space (so
+    // the front of the raft goes up), but turns on the XY plane in world
+    // space, so it keeps the two rotations separate.
+    const vec3 direction =
+        !rail_denizen_data->update_orientation
+            ? mathfu::kAxisY3f
+            : rail_denizen_data->orientation_convergence_rate == 0.0f
+                  ? rail_denizen_data->motivator.Direction()
+                  : rail_denizen_data->orientation_motivator.Direction();
+    const mathfu::quat& orientation = rail_denizen_data->rail_orientation;
+    arrays[kBatchX][i] = position.x;
+    arrays[kBatchY][i] = position.y;
+    arrays[kBatchZ][i] = position.z;
+    arrays[kBatchDirectionX][i] = direction.x;
+    arrays[kBatchDirectionY][i] = direction.y;
+    arrays[kBatchDirectionZ][i] = direction.z;
+    arrays[kBatchOrientationS][i] = orientation.scalar();
+    arrays[kBatchOrientationX][i] = orientation.vector().x;
+    arrays[kBatchOrientationY][i] = orientation.vector().y;
+    arrays[kBatchOrientationZ][i] = orientation.vector().z;
+    arrays[kBatchScaleX][i] = rail_denizen_data->rail_scale.x;
+    arrays[kBatchScaleY][i] = rail_denizen_data->rail_scale.y;
+    arrays[kBatchScaleZ][i] = rail_denizen_data->rail_scale.z;
+    arrays[kBatchOffsetX][i] = rail_denizen_data->rail_offset.x;
+    arrays[kBatchOffsetY][i] = rail_denizen_data->rail_offset.y;
+    arrays[kBatchOffsetZ][i] = rail_denizen_data->rail_offset.z;
+  }
 
-      mathfu::quat target_orientation =
-          rail_denizen_data->rail_orientation *
-          mathfu::quat::FromAngleAxis(z_angle, -mathfu::kAxisX3f) *
-          mathfu::quat::RotateFromTo(world_direction, mathfu::kAxisY3f);
+  RailDenizenInputs inputs;
+  inputs.x = arrays[kBatchX];
+  inputs.y = arrays[kBatchY];
+  inputs.z = arrays[kBatchZ];
+  inputs.direction_x = arrays[kBatchDirectionX];
+  inputs.direction_y = arrays[kBatchDirectionY];
+  inputs.direction_z = arrays[kBatchDirectionZ];
+  inputs.orientation_s = arrays[kBatchOrientationS];
+  inputs.orientation_x = arrays[kBatchOrientationX];
+  inputs.orientation_y = arrays[kBatchOrientationY];
+  inputs.orientation_z = arrays[kBatchOrientationZ];
+  inputs.scale_x = arrays[kBatchScaleX];
+  inputs.scale_y = arrays[kBatchScaleY];
+  inputs.scale_z = arrays[kBatchScaleZ];
+  inputs.offset_x = arrays[kBatchOffsetX];
+  inputs.offset_y = arrays[kBatchOffsetY];
+  inputs.offset_z = arrays[kBatchOffsetZ];
+  RailDenizenTransforms transforms;
+  transforms.x = arrays[kBatchWorldX];
+  transforms.y = arrays[kBatchWorldY];
+  transforms.z = arrays[kBatchWorldZ];
+  transforms.orientation_s = arrays[kBatchTargetS];
+  transforms.orientation_x = arrays[kBatchTargetX];
+  transforms.orientation_y = arrays[kBatchTargetY];
+  transforms.orientation_z = arrays[kBatchTargetZ];
+  ComputeRailDenizenTransforms(inputs, count, transforms);
+
+  for (int i = 0; i < count; ++i) {
+    const corgi::EntityRef& entity = batch_entities_[i];
+    RailDenizenData* rail_denizen_data = GetComponentData(entity);
+    TransformData* transform_data = Data<TransformData>(entity);
+    transform_data->position =
+        vec3(transforms.x[i], transforms.y[i], transforms.z[i]);
+    if (rail_denizen_data->update_orientation) {
+      const float convergence_rate =
+          rail_denizen_data->orientation_convergence_rate;
+      const mathfu::quat target_orientation(
+          transforms.orientation_s[i], transforms.orientation_x[i],
+          transforms.orientation_y[i], transforms.orientation_z[i]);
       // Convergence is disabled when the playback rate is zero as
       // it's possible for the slerp to yield an invalid quaternion
       // with angles approaching zero.
@@ -182,6 +284,14 @@ void RailDenizenComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
     rail_denizen_data->lap_progress =
         static_cast<float>(rail_denizen_data->motivator.SplineTime()) / total;
 
+    // Going back to the start of a rail that doesn't wrap jumps the denizen
+    // from one end of it to the other.
+    const Rail* rail = rail_denizen_data->rail;
+    if (rail_denizen_data->lap_progress < previous_progress &&
+        (rail == nullptr || !rail->wraps())) {
+      jumped_entities_.push_back(entity);
+    }
+
     bool use_lap_end =
         rail_denizen_data->lap_end > 0 && rail_denizen_data->lap_end < 1;
     // When the motivator has looped all the way back to the beginning of the
@@ -192,57 +302,92 @@ void RailDenizenComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
          rail_denizen_data->lap_progress >= rail_denizen_data->lap_end) ||
         (!use_lap_end && rail_denizen_data->lap_progress < previous_progress)) {
       rail_denizen_data->lap_number++;
-      GraphData* graph_data = Data<GraphData>(iter->entity);
-      if (graph_data) {
-        graph_data->broadcaster.BroadcastEvent(kNewLapEventId);
-      }
+      new_lap_entities_.push_back(entity);
     }
     rail_denizen_data->total_lap_progress =
         rail_denizen_data->lap_progress + rail_denizen_data->lap_number;
   }
 }
 
-void RailDenizenComponent::AddFromRawData(corgi::EntityRef& entity,
-                                          const void* raw_data) {
-  auto rail_denizen_def = static_cast<const RailDenizenDef*>(raw_data);
-  RailDenizenData* data = AddEntity(entity);
+void RailDenizenComponent::FinishUpdate() {
+  if (!jumped_entities_.empty()) {
+    World* world = entity_manager_->GetComponent<ServicesComponent>()->world();
+    for (auto it = jumped_entities_.begin(); it != jumped_entities_.end();
+         ++it) {
+      world->world_renderer->SnapInterpolation(*it, world);
+    }
+  }
+  for (auto it = new_lap_entities_.begin(); it != new_lap_entities_.end();
+       ++it) {
+    GraphData* graph_data = Data<GraphData>(*it);
+    if (graph_data) {
+      graph_data->broadcaster.BroadcastEvent(kNewLapEventId);
+    }
+  }
+  new_lap_entities_.clear();
+  jumped_entities_.clear();
+}
 
-  if (rail_denizen_def->rail_name() != nullptr)
-    data->rail_name = rail_denizen_def->rail_name()->c_str();
+void RailDenizenComponent::CompileDef(const RailDenizenDef* rail_denizen_def,
+                                      CompiledDef* compiled) {
+  compiled->has_rail_name = rail_denizen_def->rail_name() != nullptr;
+  if (compiled->has_rail_name)
+    compiled->rail_name = rail_denizen_def->rail_name()->c_str();
 
-  data->start_time = rail_denizen_def->start_time();
-  data->initial_playback_rate = rail_denizen_def->initial_playback_rate();
+  compiled->start_time = rail_denizen_def->start_time();
+  compiled->initial_playback_rate = rail_denizen_def->initial_playback_rate();
 
   auto offset = rail_denizen_def->rail_offset();
   auto orientation = rail_denizen_def->rail_orientation();
   auto scale = rail_denizen_def->rail_scale();
   if (offset != nullptr) {
-    data->rail_offset = LoadVec3(offset);
+    compiled->rail_offset = LoadVec3(offset);
   } else {
-    data->rail_offset = mathfu::kZeros3f;
+    compiled->rail_offset = mathfu::kZeros3f;
   }
-  data->internal_rail_offset = data->rail_offset;
   if (orientation != nullptr) {
-    data->rail_orientation =
+    compiled->rail_orientation =
         mathfu::quat::FromEulerAngles(LoadVec3(orientation));
   } else {
-    data->rail_orientation = mathfu::quat::identity;
+    compiled->rail_orientation = mathfu::quat::identity;
   }
-  data->internal_rail_orientation = data->rail_orientation;
   if (scale != nullptr) {
-    data->rail_scale = LoadVec3(scale);
+    compiled->rail_scale = LoadVec3(scale);
   } else {
-    data->rail_scale = mathfu::kOnes3f;
+    compiled->rail_scale = mathfu::kOnes3f;
   }
-  data->internal_rail_scale = data->rail_scale;
-  data->orientation_convergence_rate =
+  compiled->orientation_convergence_rate =
       rail_denizen_def->orientation_convergence_rate();
-  data->update_orientation =
+  compiled->update_orientation =
       rail_denizen_def->update_orientation() ? true : false;
-  data->inherit_transform_data =
+  compiled->inherit_transform_data =
       rail_denizen_def->inherit_transform_data() ? true : false;
-  data->enabled = rail_denizen_def->enabled() ? true : false;
-  data->lap_end = rail_denizen_def->lap_end();
+  compiled->enabled = rail_denizen_def->enabled() ? true : false;
+  compiled->lap_end = rail_denizen_def->lap_end();
+}
+
+void RailDenizenComponent::AddFromRawData(corgi::EntityRef& entity,
+                                          const void* raw_data) {
+  const CompiledDef& def =
+      compiled_defs_.Get(static_cast<const RailDenizenDef*>(raw_data),
+                         &RailDenizenComponent::CompileDef);
+  RailDenizenData* data = AddEntity(entity);
+
+  if (def.has_rail_name) data->rail_name = def.rail_name;
+
+  data->start_time = def.start_time;
+  data->initial_playback_rate = def.initial_playback_rate;
+  data->rail_offset = def.rail_offset;
+  data->internal_rail_offset = def.rail_offset;
+  data->rail_orientation = def.rail_orientation;
+  data->internal_rail_orientation = def.rail_orientation;
+  data->rail_scale = def.rail_scale;
+  data->internal_rail_scale = def.rail_scale;
+  data->orientation_convergence_rate = def.orientation_convergence_rate;
+  data->update_orientation = def.update_orientation;
+  data->inherit_transform_data = def.inherit_transform_data;
+  data->enabled = def.enabled;
+  data->lap_end = def.lap_end;
 
   entity_manager_->AddEntityToComponent<TransformComponent>(entity);
 
@@ -314,6 +459,22 @@ void RailDenizenComponent::UpdateRailNodeData(corgi::EntityRef entity) {
   const RailNodeData* node_data =
       entity_manager_->GetComponentData<RailNodeData>(entity);
   if (node_data != nullptr) {
+    // If only the node's position has changed, refit the rail near it, and
+    // leave everything on the rail where it is.
+    RailManager* rail_manager =
+        entity_manager_->GetComponent<ServicesComponent>()->rail_manager();
+    const Rail* rail = rail_manager->RefitRailNode(entity, entity_manager_);
+    if (rail != nullptr) {
+      for (auto iter = begin(); iter != end(); ++iter) {
+        RailDenizenData* rail_denizen_data = GetComponentData(iter->entity);
+        if (rail_denizen_data->rail == rail) rail_denizen_data->Reseat();
+      }
+      return;
+    }
+
+    // Otherwise the node may have moved, so its rail needs rebuilding.
+    entity_manager_->GetComponent<RailNodeComponent>()->MarkRailChanged(
+        entity);
     const std::string& rail_name = node_data->rail_name;
     for (auto iter = begin(); iter != end(); ++iter) {
       const RailDenizenData* rail_denizen_data = GetComponentData(iter->entity);
@@ -341,6 +502,10 @@ void RailDenizenComponent::PostLoadFixup() {
 }
 
 void RailDenizenComponent::OnEnterEditor() {
+  // Scene Lab hands over RailDenizenDefs that it builds and frees as entities
+  // are edited, so they mustn't be remembered by address.
+  compiled_defs_.set_enabled(false);
+
   for (auto iter = component_data_.begin(); iter != component_data_.end();
        ++iter) {
     // If an entity inherits its offsets from the transform data, the transform
@@ -18,6 +18,7 @@
 #include <string>
 #include <vector>
 #include "breadboard/event.h"
+#include "compiled_def_cache.h"
 #include "components_generated.h"
 #include "corgi/component.h"
 #include "mathfu/constants.h"
@@ -57,6 +58,10 @@ struct RailDenizenData {
 
   void Initialize(const Rail& rail, motive::MotiveEngine& engine);
 
+  // Pick up changes made to `rail` in place, such as by Rail::RefitNode(),
+  // keeping the denizen's place along it.
+  void Reseat();
+
   // Set speed at which the entity traverses the rail.
   // playback_rate 0 ==> paused
   // playback_rate 0.5 ==> half speed of authored rail (slow)
@@ -123,6 +128,12 @@ class RailDenizenComponent : public corgi::Component<RailDenizenData> {
   virtual void UpdateAllEntities(corgi::WorldTime delta_time);
   virtual void InitEntity(corgi::EntityRef& entity);
 
+  // Broadcast the new lap events, and snap the interpolation of the denizens
+  // that jumped, found by the last UpdateAllEntities(). These reach beyond
+  // the denizens' own data, so they are left for the update thread to do
+  // once UpdateAllEntities() and anything updated alongside it are done.
+  void FinishUpdate();
+
   void UpdateRailNodeData(corgi::EntityRef entity);
 
   // This needs to be called after the entities have been loaded from data.
@@ -131,9 +142,60 @@ class RailDenizenComponent : public corgi::Component<RailDenizenData> {
   // When a Rail is reloaded, we need to reinitialize any data that uses it.
   void ChangeRail(const Rail* old_rail, const Rail* new_rail);
 
+  // Forget the decoded RailDenizenDefs. Call when the definitions that
+  // denizens were loaded from may be freed.
+  void ClearCompiledDefs() { compiled_defs_.Clear(); }
+
  private:
+  // The settings in a RailDenizenDef, decoded into the form RailDenizenData
+  // holds them in, with the rail orientation already turned into a quat.
+  struct CompiledDef {
+    CompiledDef()
+        : has_rail_name(false),
+          start_time(0.0f),
+          initial_playback_rate(0.0f),
+          rail_offset(mathfu::kZeros3f),
+          rail_orientation(mathfu::kQuatIdentityf),
+          rail_scale(mathfu::kOnes3f),
+          orientation_convergence_rate(0.0f),
+          update_orientation(false),
+          inherit_transform_data(false),
+          enabled(true),
+          lap_end(0.0f) {}
+
+    // The def only replaces a denizen's rail when it names one.
+    bool has_rail_name;
+    std::string rail_name;
+    float start_time;
+    float initial_playback_rate;
+    mathfu::vec3 rail_offset;
+    mathfu::quat rail_orientation;
+    mathfu::vec3 rail_scale;
+    float orientation_convergence_rate;
+    bool update_orientation;
+    bool inherit_transform_data;
+    bool enabled;
+    float lap_end;
+  };
+
+  static void CompileDef(const RailDenizenDef* def, CompiledDef* compiled);
   void InitializeRail(corgi::EntityRef&);
   void OnEnterEditor();
+
+  // Scratch space for UpdateAllEntities(), which transforms the enabled
+  // denizens together. `batch_` holds one array per coordinate of the
+  // transform kernel's inputs and outputs, each `batch_entities_.size()` long.
+  std::vector<corgi::EntityRef> batch_entities_;
+  std::vector<float> batch_;
+
+  // Denizens that started a new lap, and that jumped from one end of their
+  // rail to the other, during the last UpdateAllEntities().
+  std::vector<corgi::EntityRef> new_lap_entities_;
+  std::vector<corgi::EntityRef> jumped_entities_;
+
+  // RailDenizenDefs already decoded, mostly those of the prototypes in the
+  // entity library, which many denizens share.
+  CompiledDefCache<RailDenizenDef, CompiledDef> compiled_defs_;
 };
 
 }  // zooshi
@@ -26,6 +26,10 @@ void RailNodeComponent::AddFromRawData(corgi::EntityRef& entity,
                                        const void* raw_data) {
   auto rail_node_def = static_cast<const RailNodeDef*>(raw_data);
 
+  // Both the rail the node was on and the one it's on now have changed.
+  const RailNodeData* old_data = GetComponentData(entity);
+  if (old_data != nullptr) BumpRailVersion(old_data->rail_name);
+
   RailNodeData* data = AddEntity(entity);
   data->rail_name = rail_node_def->rail_name()->c_str();
   data->ordering = rail_node_def->ordering();
@@ -34,6 +38,8 @@ void RailNodeComponent::AddFromRawData(corgi::EntityRef& entity,
   if (rail_node_def->reliable_distance())
     data->reliable_distance = rail_node_def->reliable_distance();
   data->wraps = rail_node_def->wraps();
+  BumpRailVersion(data->rail_name);
+  rail_nodes_dirty_ = true;
 }
 
 corgi::ComponentInterface::RawDataUniquePtr RailNodeComponent::ExportRawData(
@@ -60,5 +66,61 @@ corgi::ComponentInterface::RawDataUniquePtr RailNodeComponent::ExportRawData(
   return fbb.ReleaseBufferPointer();
 }
 
+void RailNodeComponent::InitEntity(corgi::EntityRef& /*entity*/) {
+  rail_nodes_dirty_ = true;
+}
+
+void RailNodeComponent::CleanupEntity(corgi::EntityRef& entity) {
+  const RailNodeData* data = GetComponentData(entity);
+  if (data != nullptr) BumpRailVersion(data->rail_name);
+  rail_nodes_dirty_ = true;
+}
+
+const std::vector<corgi::EntityRef>* RailNodeComponent::RailNodes(
+    const std::string& rail_name) {
+  if (rail_nodes_dirty_) IndexRailNodes();
+  auto nodes = rail_nodes_.find(rail_name);
+  return nodes != rail_nodes_.end() ? &nodes->second : nullptr;
+}
+
+int RailNodeComponent::RailVersion(const std::string& rail_name) {
+  if (rail_nodes_dirty_) IndexRailNodes();
+  auto version = rail_versions_.find(rail_name);
+  return version != rail_versions_.end() ? version->second : 0;
+}
+
+void RailNodeComponent::MarkRailChanged(const corgi::EntityRef& entity) {
+  const RailNodeData* data = GetComponentData(entity);
+  if (data != nullptr) BumpRailVersion(data->rail_name);
+}
+
+void RailNodeComponent::BumpRailVersion(const std::string& rail_name) {
+  rail_versions_[rail_name]++;
+}
+
+void RailNodeComponent::IndexRailNodes() {
+  std::unordered_map<std::string, std::vector<corgi::EntityRef>> rail_nodes;
+  for (auto iter = begin(); iter != end(); ++iter) {
+    rail_nodes[iter->data.rail_name].push_back(iter->entity);
+  }
+
+  // Nodes can be given a rail name after they're added, so any rail whose
+  // nodes differ from last time has changed too.
+  for (auto iter = rail_nodes.begin(); iter != rail_nodes.end(); ++iter) {
+    auto old_nodes = rail_nodes_.find(iter->first);
+    if (old_nodes == rail_nodes_.end() || old_nodes->second != iter->second) {
+      BumpRailVersion(iter->first);
+    }
+  }
+  for (auto iter = rail_nodes_.begin(); iter != rail_nodes_.end(); ++iter) {
+    if (rail_nodes.find(iter->first) == rail_nodes.end()) {
+      BumpRailVersion(iter->first);
+    }
+  }
+
+  rail_nodes_.swap(rail_nodes);
+  rail_nodes_dirty_ = false;
+}
+
 }  // zooshi
 }  // fpl
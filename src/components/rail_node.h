@@ -16,6 +16,8 @@
 #define FPL_ZOOSHI_COMPONENTS_RAIL_NODE_H_
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "components_generated.h"
 #include "corgi/component.h"
 #include "rail_def_generated.h"
@@ -34,13 +36,41 @@ struct RailNodeData {
   bool wraps;
 };
 
+// Keeps the RailNode entities indexed by rail name, and counts changes to
+// each rail's nodes, so that rails built from them are only rebuilt when
+// they change.
 class RailNodeComponent : public corgi::Component<RailNodeData> {
  public:
-  RailNodeComponent() {}
+  RailNodeComponent() : rail_nodes_dirty_(false) {}
   virtual ~RailNodeComponent() {}
 
   virtual void AddFromRawData(corgi::EntityRef& entity, const void* data);
   virtual RawDataUniquePtr ExportRawData(const corgi::EntityRef& entity) const;
+  virtual void InitEntity(corgi::EntityRef& entity);
+  virtual void CleanupEntity(corgi::EntityRef& entity);
+
+  // The RailNode entities on the rail named `rail_name`, in no particular
+  // order, or null if there are none.
+  const std::vector<corgi::EntityRef>* RailNodes(const std::string& rail_name);
+
+  // Changes whenever a node on the rail named `rail_name` is added, removed
+  // or marked as changed.
+  int RailVersion(const std::string& rail_name);
+
+  // Call after moving `entity`, or editing its RailNodeData in place, so that
+  // the rail it's on is rebuilt.
+  void MarkRailChanged(const corgi::EntityRef& entity);
+
+ private:
+  void BumpRailVersion(const std::string& rail_name);
+  void IndexRailNodes();
+
+  // RailNode entities by rail name. Rebuilt on the next query after nodes
+  // are added or removed.
+  std::unordered_map<std::string, std::vector<corgi::EntityRef>> rail_nodes_;
+  bool rail_nodes_dirty_;
+
+  std::unordered_map<std::string, int> rail_versions_;
 };
 
 }  // zooshi
@@ -67,8 +67,8 @@ const mat4 Render3dTextComponent::CalculateAnimationTransform(
   return mat4::Identity();
 }
 
-const mat4 Render3dTextComponent::CalculateModelViewProjection(
-    const EntityRef& entity, const corgi::CameraInterface& camera) const {
+const mat4 Render3dTextComponent::CalculateModelTransform(
+    const EntityRef& entity) const {
   const TransformData* transform_data = Data<TransformData>(entity);
   const Render3dTextData* render_3d_text_data = Data<Render3dTextData>(entity);
 
@@ -105,10 +105,15 @@ const mat4 Render3dTextComponent::CalculateModelViewProjection(
   // Scale the FlatUI down to the correct size for the entity.
   const mat4 scale = mat4::FromScaleVector(vec3(render_3d_text_data->scale));
 
-  // Calculate MVP -> Perspective * View * Model * Translation * Rotation *
-  //                  Scale * Center At Origin.
-  return camera.GetTransformMatrix() * world_transform * translation *
-         orientation * scale * center_at_origin;
+  // Calculate Model * Translation * Rotation * Scale * Center At Origin.
+  return world_transform * translation * orientation * scale *
+         center_at_origin;
+}
+
+const mat4 Render3dTextComponent::CalculateModelViewProjection(
+    const EntityRef& entity, const corgi::CameraInterface& camera) const {
+  // Calculate MVP -> Perspective * View * Model.
+  return camera.GetTransformMatrix() * CalculateModelTransform(entity);
 }
 
 void Render3dTextComponent::Init() {
@@ -121,40 +126,45 @@ void Render3dTextComponent::InitEntity(EntityRef& entity) {
 
 void Render3dTextComponent::Render(const EntityRef& entity,
                                    const corgi::CameraInterface& camera) {
-  SetModelViewProjectionMatrix(entity, camera);
-
   const RenderMeshData* rendermesh_data = Data<RenderMeshData>(entity);
   const Render3dTextData* render_3d_text_data = Data<Render3dTextData>(entity);
 
   if (rendermesh_data && rendermesh_data->visible) {
-    // Create FlatUI in 3D space.
-    flatui::Run(*services_->asset_manager(), *services_->font_manager(),
-                *services_->input_system(), [&]() {
-                  const vec2i window_size =
-                      services_->asset_manager()->renderer().window_size();
-                  const float aspect_ratio =
-                      static_cast<float>(window_size.x) /
-                      static_cast<float>(window_size.y);
-
-                  flatui::SetDepthTest(true);
-                  flatui::UseExistingProjection(
-                      vec2i(static_cast<int>(render_3d_text_data->canvas_size *
-                                             aspect_ratio),
-                            render_3d_text_data->canvas_size));
-                  flatui::StartGroup(flatui::kLayoutOverlay);
+    RenderText(CalculateModelViewProjection(entity, camera),
+               *render_3d_text_data);
+  }
+}
+
+void Render3dTextComponent::RenderText(
+    const mat4& mvp, const Render3dTextData& render_3d_text_data) {
+  services_->asset_manager()->renderer().set_model_view_projection(mvp);
+
+  // Create FlatUI in 3D space.
+  flatui::Run(*services_->asset_manager(), *services_->font_manager(),
+              *services_->input_system(), [&]() {
+                const vec2i window_size =
+                    services_->asset_manager()->renderer().window_size();
+                const float aspect_ratio = static_cast<float>(window_size.x) /
+                                           static_cast<float>(window_size.y);
+
+                flatui::SetDepthTest(true);
+                flatui::UseExistingProjection(
+                    vec2i(static_cast<int>(render_3d_text_data.canvas_size *
+                                           aspect_ratio),
+                          render_3d_text_data.canvas_size));
+                flatui::StartGroup(flatui::kLayoutOverlay);
+                {
+                  flatui::PositionGroup(flatui::kAlignCenter,
+                                        flatui::kAlignCenter,
+                                        mathfu::kZeros2f);
                   {
-                    flatui::PositionGroup(flatui::kAlignCenter,
-                                          flatui::kAlignCenter,
-                                          mathfu::kZeros2f);
-                    {
-                      flatui::SetTextFont(render_3d_text_data->font.c_str());
-                      flatui::Label(render_3d_text_data->text.c_str(),
-                                    render_3d_text_data->label_size);
-                    }
+                    flatui::SetTextFont(render_3d_text_data.font.c_str());
+                    flatui::Label(render_3d_text_data.text.c_str(),
+                                  render_3d_text_data.label_size);
                   }
-                  flatui::EndGroup();
-                });
-  }
+                }
+                flatui::EndGroup();
+              });
 }
 
 void Render3dTextComponent::RenderAllEntities(
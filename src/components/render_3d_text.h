@@ -95,6 +95,15 @@ class Render3dTextComponent : public corgi::Component<Render3dTextData> {
   const mathfu::mat4 CalculateAnimationTransform(
       const corgi::EntityRef& entity, const int animation_bone) const;
 
+  /// @brief Calculate the model transform that places the text's FlatUI
+  /// canvas in world space.
+  ///
+  /// @param[in] entity A `corgi::EntityRef` reference to the entity that
+  /// should have the text rendered on it.
+  /// @return Returns a `mathfu::mat4` containing the model transform.
+  const mathfu::mat4 CalculateModelTransform(
+      const corgi::EntityRef& entity) const;
+
   /// @brief Calculate the ModelViewProjection (MVP) for the renderer to
   /// correctly project the text into 3D space.
   ///
@@ -135,6 +144,16 @@ class Render3dTextComponent : public corgi::Component<Render3dTextData> {
   void Render(const corgi::EntityRef& entity,
               const corgi::CameraInterface& camera);
 
+  /// @brief Renders text with a precomputed ModelViewProjection.
+  ///
+  /// Unlike `Render()`, this does not read any entity data, so it can be used
+  /// to draw text captured in a render snapshot.
+  ///
+  /// @param[in] mvp The ModelViewProjection (MVP) matrix of the text.
+  /// @param[in] render_3d_text_data The text to render, and how to render it.
+  void RenderText(const mathfu::mat4& mvp,
+                  const Render3dTextData& render_3d_text_data);
+
   /// @brief Goes through and renders text on every entity that
   /// is registered with the Render3dTextComponent.
   ///
@@ -14,6 +14,8 @@
 
 #include "components/river.h"
 #include <math.h>
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include "common.h"
 #include "components/rail_denizen.h"
@@ -24,9 +26,9 @@
 #include "corgi_component_library/physics.h"
 #include "corgi_component_library/rendermesh.h"
 #include "corgi_component_library/transform.h"
-#include "fplbase/debug_markers.h"
 #include "fplbase/utilities.h"
 #include "scene_lab/scene_lab.h"
+#include "trace.h"
 #include "world.h"
 
 using mathfu::vec2;
@@ -52,6 +54,10 @@ using scene_lab::SceneLab;
 
 static const size_t kNumIndicesPerQuad = 6;
 
+// The river is split into chunks this many segments long, so that only the
+// chunks in view need to be drawn.
+static const size_t kSegmentsPerChunk = 16;
+
 // A vertex definition specific to normalmapping with colors.
 struct NormalMappedColorVertex {
   vec3_packed pos;
@@ -99,6 +105,19 @@ void RiverComponent::UpdateAllEntities(corgi::WorldTime /*delta_time*/) {
   river_offset_ -= floor(river_offset_);
 }
 
+// Forget the bounds of the river's chunks, so that whatever reuses their
+// entity indices isn't culled against them. This runs for every river when a
+// level is unloaded.
+void RiverComponent::CleanupEntity(corgi::EntityRef& entity) {
+  const RiverData* river_data = GetComponentData(entity);
+  if (river_data == nullptr) return;
+  for (auto chunk = river_data->chunks.begin();
+       chunk != river_data->chunks.end(); ++chunk) {
+    const size_t index = chunk->index();
+    if (index < chunk_bounds_.size()) chunk_bounds_[index] = RiverChunkBounds();
+  }
+}
+
 void RiverComponent::TriggerRiverUpdate() {
   // TODO - it would be nice if this only updated the river that we were editing
   // (instead of marking all rivers as needing an update) but due to how river
@@ -128,90 +147,82 @@ corgi::ComponentInterface::RawDataUniquePtr RiverComponent::ExportRawData(
   return fbb.ReleaseBufferPointer();
 }
 
-// Iterate through the river meshes and update any of them that need to be
-// regenerated.  Split out into a separate function so it can be called from
-// the render thread.  (Warning:  Crashes if you try to call it on the main
-// thread, because it doesn't have access to the opengl context!)
-void RiverComponent::UpdateRiverMeshes() {
-  PushDebugMarker("UpdateRiverMeshes");
-  for (auto iter = begin(); iter != end(); ++iter) {
-    RiverData* river_data = Data<RiverData>(iter->entity);
-    if (river_data->render_mesh_needs_update_) CreateRiverMesh(iter->entity);
-  }
-  PopDebugMarker();
-}
-
-// Generates the actual mesh for the river, and adds it to this entitiy's
-// rendermesh component.
-void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
-  static const fplbase::Attribute kMeshFormat[] = {
-      fplbase::kPosition3f, fplbase::kTexCoord2f, fplbase::kNormal3f,
-      fplbase::kTangent4f, fplbase::kEND};
-  static const fplbase::Attribute kBankMeshFormat[] = {
-      fplbase::kPosition3f, fplbase::kTexCoord2f, fplbase::kNormal3f,
-      fplbase::kTangent4f,  fplbase::kColor4ub,   fplbase::kEND};
-  std::vector<vec3_packed> track;
-  const RiverConfig* river = entity_manager_->GetComponent<ServicesComponent>()
-                                 ->world()
-                                 ->CurrentLevel()
-                                 ->river_config();
-
-  RiverData* river_data = Data<RiverData>(entity);
-  river_data->render_mesh_needs_update_ = false;
-
-  // Initialize the static mesh that will be made around the river banks.
-  auto* physics_component = entity_manager_->GetComponent<PhysicsComponent>();
-  physics_component->InitStaticMesh(entity);
+// One stretch of the river and its banks, with its own vertices so that it can
+// be drawn, and culled, on its own.
+struct RiverMeshChunk {
+  std::vector<NormalMappedVertex> river_verts;
+  std::vector<unsigned short> river_indices;
+  std::vector<NormalMappedColorVertex> bank_verts;
+  // Use one set of bank vertices for the chunk, but separate out the zones
+  // via indices, so we can use different materials (and possibly shaders) per
+  // zone. Empty for zones the chunk doesn't pass through.
+  std::vector<std::vector<unsigned short>> bank_indices_by_zone;
+  // Bounds of the chunk's vertices.
+  vec3_packed min_position;
+  vec3_packed max_position;
+};
 
-  Rail* rail = entity_manager_->GetComponent<ServicesComponent>()
-                   ->rail_manager()
-                   ->GetRailFromComponents(river_data->rail_name.c_str(),
-                                           entity_manager_);
+// Everything needed to build a river's meshes, and everything the build
+// produces. The inputs are gathered on the render thread, then the vertices,
+// indices and collision triangles are generated by a worker, so rebuilding a
+// river never stalls a frame. Only the upload to GL and Bullet is left for
+// the render thread.
+struct RiverMeshBuild {
+  RiverMeshBuild() : river(nullptr), wraps(false), done(false) {}
 
-  // Generate the spline data and store it in our track vector:
-  rail->Positions(river->spline_stepsize(), &track);
+  // Inputs.
+  const RiverConfig* river;
+  std::vector<vec3_packed> track;
+  bool wraps;
+  // Where each bank vertex sits within its contour's (x, z) range, as
+  // fractions from the min to the max. One per contour for each segment.
+  std::vector<vec2_packed> bank_fractions;
+  // Whether each zone's bank material has only one texture.
+  std::vector<bool> zone_single_texture;
+
+  // Outputs.
+  std::vector<RiverMeshChunk> chunks;
+  // Corners of the bank triangles for the static physics mesh, three per
+  // triangle.
+  std::vector<vec3_packed> collision_corners;
+
+  // Set by the worker once the outputs are ready.
+  std::atomic<bool> done;
+};
 
-  fplbase::AssetManager* asset_manager =
-      entity_manager_->GetComponent<ServicesComponent>()->asset_manager();
+// Generates the vertices and indices for the river and its banks. Runs on a
+// worker thread, so it must not touch the entity manager, GL or Bullet.
+static void BuildRiverMesh(RiverMeshBuild* build) {
+  const RiverConfig* river = build->river;
+  const std::vector<vec3_packed>& track = build->track;
 
   const size_t num_bank_contours = river->default_banks()->Length();
   const size_t num_bank_quads = num_bank_contours - 2;
   const size_t river_idx = river->river_index();
   const size_t segment_count = track.size();
   const size_t river_vert_max = segment_count * 2;
-  const size_t river_index_max = (segment_count - 1) * kNumIndicesPerQuad;
   const size_t bank_vert_max = segment_count * num_bank_contours;
   const size_t bank_index_max =
       (segment_count - 1) * kNumIndicesPerQuad * num_bank_quads;
   assert(num_bank_contours >= 2 && river_idx < num_bank_contours - 1);
   const unsigned int num_zones = river->zones()->Length();
 
-  // Need to allocate some space to plan out our mesh in:
+  // Need to allocate some space to plan out our mesh in. The whole river is
+  // generated at once, so that normals are continuous between chunks.
   std::vector<NormalMappedVertex> river_verts(river_vert_max);
   river_verts.clear();
-  std::vector<unsigned short> river_indices(river_index_max);
-  river_indices.clear();
-
   std::vector<NormalMappedColorVertex> bank_verts(bank_vert_max);
   bank_verts.clear();
+  // Bank indices for the entire river, in one set, for the normal calculation
+  // and the static physics mesh.
   std::vector<unsigned short> bank_indices(bank_index_max);
   bank_indices.clear();
-  // Use one set of bank vertices for the entire riverbank, but separate out
-  // the zones via indices, so we can use different materials (and possibly
-  // shaders) per zone. We still keep bank_indices for the normal calculation,
-  // though.
-  std::vector<std::vector<unsigned short>> bank_indices_by_zone;
-  bank_indices_by_zone.resize(num_zones);
+  build->collision_corners.reserve(bank_index_max);
 
   std::vector<unsigned int> bank_zones;  // indexed by segment
   bank_zones.resize(segment_count, 0);   // default of 0
   unsigned int zone_id = 0;
 
-  // TODO: Use a local random number generator. Resetting the global random
-  //       number generator is not a nice. Also, there's no guarantee that
-  //       mathfu::Random will continue to use rand().
-  srand(river_data->random_seed);
-
   std::vector<float> actual_zone_end;
   actual_zone_end.resize(segment_count, 1);
   // Precalculate the actual zone end locations.
@@ -228,8 +239,6 @@ void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
   zone_id = 0;
 
   const RiverZone* current_zone = river->zones()->Get(zone_id);
-  Material* current_bank_material =
-      asset_manager->LoadMaterial(current_zone->material()->c_str());
   float river_width = current_zone->width() != 0 ? current_zone->width()
                                                  : river->default_width();
 
@@ -240,7 +249,7 @@ void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
     vec3 track_delta;
     if (i > 0) {
       track_delta = vec3(track[i]) - vec3(track[i - 1]);
-    } else if (rail->wraps()) {
+    } else if (build->wraps) {
       // River track is circular.
       track_delta = vec3(track[i]) - vec3(track[segment_count - 1]);
     } else {
@@ -265,20 +274,15 @@ void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
     if (fraction >= actual_zone_end[zone_id]) {
       zone_id = zone_id + 1;
       current_zone = river->zones()->Get(zone_id);
-      // Each zone has its own texture.
-      current_bank_material =
-          asset_manager->LoadMaterial(current_zone->material()->c_str());
       // Each zone has its own river width.
       river_width = current_zone->width() != 0 ? current_zone->width()
                                                : river->default_width();
-      current_bank_material = asset_manager->LoadMaterial(
-          river->zones()->Get(zone_id)->material()->c_str());
     }
     bank_zones[i] = zone_id;
     float zone_start = zone_id == 0 ? 0 : actual_zone_end[zone_id - 1];
     float zone_end = actual_zone_end[zone_id];
     float within_fraction = (fraction - zone_start) / (zone_end - zone_start);
-    if (current_bank_material->textures().size() == 1) {
+    if (build->zone_single_texture[zone_id]) {
       // Ensure we stay continuous with transitional zones.
       within_fraction = within_fraction < 0.5f ? 1.0f : 0.0f;
     }
@@ -297,9 +301,9 @@ void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
       const RiverBankContour* b = (current_zone->banks() != nullptr)
                                       ? current_zone->banks()->Get(index)
                                       : river->default_banks()->Get(index);
-      offsets[j] =
-          vec2(mathfu::Lerp(b->x_min(), b->x_max(), mathfu::Random<float>()),
-               mathfu::Lerp(b->z_min(), b->z_max(), mathfu::Random<float>()));
+      const vec2 fraction(build->bank_fractions[i * num_bank_contours + j]);
+      offsets[j] = vec2(mathfu::Lerp(b->x_min(), b->x_max(), fraction.x),
+                        mathfu::Lerp(b->z_min(), b->z_max(), fraction.y));
     }
 
     // Create the bank vertices for this segment.
@@ -347,7 +351,7 @@ void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
     }
 
     // Force the beginning and end to line up in their geometry:
-    if (i == segment_count - 1 && rail->wraps()) {
+    if (i == segment_count - 1 && build->wraps) {
       for (size_t j = 0; j < num_bank_contours; j++)
         bank_verts[bank_verts.size() - (8 - j)].pos = bank_verts[j].pos;
     }
@@ -369,137 +373,333 @@ void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
     river_verts.back().tangent = bank_verts[river_vert + 1].tangent;
   }
 
+  auto make_quad = [](std::vector<unsigned short>& indices, int base_index,
+                      int off1, int off2) {
+    indices.push_back(static_cast<unsigned short>(base_index + off1));
+    indices.push_back(static_cast<unsigned short>(base_index + off1 + 1));
+    indices.push_back(static_cast<unsigned short>(base_index + off2));
+
+    indices.push_back(static_cast<unsigned short>(base_index + off2));
+    indices.push_back(static_cast<unsigned short>(base_index + off1 + 1));
+    indices.push_back(static_cast<unsigned short>(base_index + off2 + 1));
+  };
+
   // Not counting the first segment, create triangles in our index
   // list to represent this segment.
   //
+  // Case when kNumBankCountours = 8, and river_idx = 3;
+  //
+  //  0___1___2___3   4___5___6___7
+  //  | _/| _/| _/|   | _/| _/| _/|
+  //  |/__|/__|/__|   |/__|/__|/__|
+  //  8   9  10  11  12  13  14  15
   for (size_t i = 0; i < segment_count - 1; i++) {
-    auto make_quad = [&](std::vector<unsigned short>& indices, int base_index,
-                         int off1, int off2) {
-      indices.push_back(static_cast<unsigned short>(base_index + off1));
-      indices.push_back(static_cast<unsigned short>(base_index + off1 + 1));
-      indices.push_back(static_cast<unsigned short>(base_index + off2));
-
-      indices.push_back(static_cast<unsigned short>(base_index + off2));
-      indices.push_back(static_cast<unsigned short>(base_index + off1 + 1));
-      indices.push_back(static_cast<unsigned short>(base_index + off2 + 1));
-    };
-
-    // River only has one quad per segment.
-    make_quad(river_indices, 2 * static_cast<int>(i), 0, 2);
-
-    // Case when kNumBankCountours = 8, and river_idx = 3;
-    //
-    //  0___1___2___3   4___5___6___7
-    //  | _/| _/| _/|   | _/| _/| _/|
-    //  |/__|/__|/__|   |/__|/__|/__|
-    //  8   9  10  11  12  13  14  15
     for (size_t j = 0; j <= num_bank_quads; ++j) {
       // Do not create bank geo for the river.
       if (j == river_idx) continue;
-      unsigned int zone = bank_zones[i];
       int base_index = static_cast<int>(i * num_bank_contours);
       int offset1 = static_cast<int>(j);
       int offset2 = static_cast<int>(num_bank_contours + j);
       make_quad(bank_indices, base_index, offset1, offset2);
-      make_quad(bank_indices_by_zone[zone], base_index, offset1, offset2);
-
-      // Add the same triangles to the static mesh associated with the entity.
-      physics_component->AddStaticMeshTriangle(
-          entity, vec3(bank_verts[base_index + offset1].pos),
-          vec3(bank_verts[base_index + offset1 + 1].pos),
-          vec3(bank_verts[base_index + offset2].pos));
-
-      physics_component->AddStaticMeshTriangle(
-          entity, vec3(bank_verts[base_index + offset2].pos),
-          vec3(bank_verts[base_index + offset1 + 1].pos),
-          vec3(bank_verts[base_index + offset2 + 1].pos));
     }
   }
 
   // Make sure we used as much data as expected, and no more.
-  assert(river_indices.size() == river_index_max);
   assert(river_verts.size() == river_vert_max);
   assert(bank_indices.size() == bank_index_max);
   assert(bank_verts.size() == bank_vert_max);
 
+  // The same triangles make up the static mesh around the banks.
+  for (auto index = bank_indices.begin(); index != bank_indices.end();
+       ++index) {
+    build->collision_corners.push_back(bank_verts[*index].pos);
+  }
+
   Mesh::ComputeNormalsTangents(bank_verts.data(), bank_indices.data(),
                                static_cast<int>(bank_verts.size()),
                                static_cast<int>(bank_indices.size()));
 
-  // Load the material from files.
-  Material* river_material =
-      asset_manager->LoadMaterial(river->material()->c_str());
-  // Create the actual mesh objects, and stuff all the data we just
-  // generated into it.
-  Mesh* river_mesh =
-      new Mesh(river_verts.data(), river_verts.size(),
-               static_cast<int>(sizeof(NormalMappedVertex)), kMeshFormat);
-
-  river_mesh->AddIndices(river_indices.data(),
-                         static_cast<int>(river_indices.size()),
-                         river_material);
-
-  // Add the river mesh to the river entity.
-  RenderMeshData* mesh_data = Data<RenderMeshData>(entity);
-  mesh_data->shaders.push_back(
-      asset_manager->LoadShader(river->shader()->c_str()));
-  mesh_data->shaders.push_back(
-      asset_manager->LoadShader("shaders/render_depth"));
-  if (mesh_data->mesh != nullptr) {
-    // Mesh's destructor handles cleaning up its GL buffers
-    delete mesh_data->mesh;
-    mesh_data->mesh = nullptr;
+  // Split the river into chunks. Each chunk has the vertices of the segments
+  // on both of its ends, so neighboring chunks meet without a gap.
+  const size_t quad_count = segment_count - 1;
+  const size_t num_chunks =
+      (quad_count + kSegmentsPerChunk - 1) / kSegmentsPerChunk;
+  build->chunks.resize(num_chunks);
+  for (size_t c = 0; c < num_chunks; ++c) {
+    RiverMeshChunk& chunk = build->chunks[c];
+    const size_t first = c * kSegmentsPerChunk;
+    const size_t end = std::min(first + kSegmentsPerChunk, quad_count);
+    chunk.river_verts.assign(river_verts.begin() + 2 * first,
+                             river_verts.begin() + 2 * (end + 1));
+    chunk.bank_verts.assign(
+        bank_verts.begin() + first * num_bank_contours,
+        bank_verts.begin() + (end + 1) * num_bank_contours);
+    chunk.river_indices.reserve((end - first) * kNumIndicesPerQuad);
+    chunk.bank_indices_by_zone.resize(num_zones);
+
+    for (size_t i = first; i < end; i++) {
+      // River only has one quad per segment.
+      make_quad(chunk.river_indices, 2 * static_cast<int>(i - first), 0, 2);
+
+      for (size_t j = 0; j <= num_bank_quads; ++j) {
+        if (j == river_idx) continue;
+        int base_index = static_cast<int>((i - first) * num_bank_contours);
+        int offset1 = static_cast<int>(j);
+        int offset2 = static_cast<int>(num_bank_contours + j);
+        make_quad(chunk.bank_indices_by_zone[bank_zones[i]], base_index,
+                  offset1, offset2);
+      }
+    }
+
+    // The river's vertices are copies of the banks' innermost ones, so the
+    // bank vertices bound the whole chunk.
+    vec3 min_position(vec3(chunk.bank_verts[0].pos));
+    vec3 max_position(min_position);
+    for (auto vert = chunk.bank_verts.begin(); vert != chunk.bank_verts.end();
+         ++vert) {
+      min_position = vec3::Min(min_position, vec3(vert->pos));
+      max_position = vec3::Max(max_position, vec3(vert->pos));
+    }
+    chunk.min_position = vec3_packed(min_position);
+    chunk.max_position = vec3_packed(max_position);
   }
-  mesh_data->mesh = river_mesh;
-  mesh_data->culling_mask = 0;  // Never cull the river.
-  mesh_data->pass_mask = 1 << corgi::RenderPass_Opaque;
-  mesh_data->debug_name = "river";
 
-  river_data->banks.resize(num_zones, corgi::EntityRef());
+  build->done.store(true, std::memory_order_release);
+}
+
+// Uploads finished river meshes, and starts building the ones that need to be
+// regenerated. Split out into a separate function so it can be called from
+// the render thread.  (Warning:  Crashes if you try to call it on the main
+// thread, because it doesn't have access to the opengl context!)
+bool RiverComponent::UpdateRiverMeshes() {
+  TracePushMarker("UpdateRiverMeshes");
+  bool updated = false;
+  for (auto iter = begin(); iter != end(); ++iter) {
+    RiverData* river_data = Data<RiverData>(iter->entity);
+    if (river_data->mesh_build &&
+        river_data->mesh_build->done.load(std::memory_order_acquire)) {
+      FinishRiverMeshBuild(iter->entity);
+      updated = true;
+    }
+    // Only one build per river at a time. Changes made while one is running
+    // are picked up once it has been uploaded.
+    if (river_data->render_mesh_needs_update_ && !river_data->mesh_build) {
+      StartRiverMeshBuild(iter->entity);
+    }
+  }
+  TracePopMarker();
+  return updated;
+}
+
+// Gathers what the river's mesh is generated from, and starts generating it
+// on a worker.
+void RiverComponent::StartRiverMeshBuild(corgi::EntityRef& entity) {
+  const RiverConfig* river = entity_manager_->GetComponent<ServicesComponent>()
+                                 ->world()
+                                 ->CurrentLevel()
+                                 ->river_config();
+
+  RiverData* river_data = Data<RiverData>(entity);
+  river_data->render_mesh_needs_update_ = false;
+
+  Rail* rail = entity_manager_->GetComponent<ServicesComponent>()
+                   ->rail_manager()
+                   ->GetRailFromComponents(river_data->rail_name.c_str(),
+                                           entity_manager_);
+
+  std::shared_ptr<RiverMeshBuild> build(new RiverMeshBuild());
+  build->river = river;
+  build->wraps = rail->wraps();
+
+  // Generate the spline data and store it in our track vector:
+  rail->Positions(river->spline_stepsize(), &build->track);
+
+  // The banks' shape comes from the global random number generator, so it's
+  // drawn here, in the order the vertices are generated, rather than on the
+  // worker. That way each river's seed still gives it the same banks.
+  // TODO: Use a local random number generator. Resetting the global random
+  //       number generator is not a nice. Also, there's no guarantee that
+  //       mathfu::Random will continue to use rand().
+  srand(river_data->random_seed);
+  const size_t num_bank_contours = river->default_banks()->Length();
+  build->bank_fractions.reserve(build->track.size() * num_bank_contours);
+  for (size_t i = 0; i < build->track.size(); ++i) {
+    for (size_t j = 0; j < num_bank_contours; ++j) {
+      // Drawn as two arguments to one call, as they always were, so the
+      // compiler picks the same order for the x and z fractions.
+      build->bank_fractions.push_back(vec2_packed(
+          vec2(mathfu::Random<float>(), mathfu::Random<float>())));
+    }
+  }
+  // We don't want to keep the random number generator set to the same
+  // value every time we generate the river, so reset the seed back to time.
+  srand(static_cast<unsigned int>(time(nullptr)));
+
+  // Materials can only be loaded here, but the build needs to know how many
+  // textures each zone's bank has.
+  fplbase::AssetManager* asset_manager =
+      entity_manager_->GetComponent<ServicesComponent>()->asset_manager();
+  const unsigned int num_zones = river->zones()->Length();
   for (unsigned int zone = 0; zone < num_zones; zone++) {
     Material* bank_material = asset_manager->LoadMaterial(
         river->zones()->Get(zone)->material()->c_str());
+    build->zone_single_texture.push_back(bank_material->textures().size() ==
+                                         1);
+  }
+
+  // The job holds its own reference, so the build outlives the river if the
+  // river goes away first.
+  river_data->mesh_build = build;
+  WorkerPool* worker_pool = entity_manager_->GetComponent<ServicesComponent>()
+                                ->world()
+                                ->component_scheduler.worker_pool();
+  if (worker_pool) {
+    worker_pool->Post([build]() { BuildRiverMesh(build.get()); });
+  } else {
+    BuildRiverMesh(build.get());
+  }
+}
 
-    Mesh* bank_mesh =
-        new Mesh(bank_verts.data(), static_cast<int>(bank_verts.size()),
-                 sizeof(NormalMappedColorVertex), kBankMeshFormat);
+// Turns the river's finished build into meshes on the entities that draw its
+// chunks, and into the static physics mesh around the banks.
+void RiverComponent::FinishRiverMeshBuild(corgi::EntityRef& entity) {
+  static const fplbase::Attribute kMeshFormat[] = {
+      fplbase::kPosition3f, fplbase::kTexCoord2f, fplbase::kNormal3f,
+      fplbase::kTangent4f, fplbase::kEND};
+  static const fplbase::Attribute kBankMeshFormat[] = {
+      fplbase::kPosition3f, fplbase::kTexCoord2f, fplbase::kNormal3f,
+      fplbase::kTangent4f,  fplbase::kColor4ub,   fplbase::kEND};
+
+  RiverData* river_data = Data<RiverData>(entity);
+  std::shared_ptr<RiverMeshBuild> build;
+  build.swap(river_data->mesh_build);
+  const RiverConfig* river = build->river;
+
+  // Create the static mesh that will be made around the river banks.
+  auto* physics_component = entity_manager_->GetComponent<PhysicsComponent>();
+  physics_component->InitStaticMesh(entity);
+  const std::vector<vec3_packed>& corners = build->collision_corners;
+  for (size_t i = 0; i + 2 < corners.size(); i += 3) {
+    physics_component->AddStaticMeshTriangle(
+        entity, vec3(corners[i]), vec3(corners[i + 1]), vec3(corners[i + 2]));
+  }
+
+  fplbase::AssetManager* asset_manager =
+      entity_manager_->GetComponent<ServicesComponent>()->asset_manager();
+  const unsigned int num_zones = river->zones()->Length();
+
+  // Load the materials and shaders from files.
+  Material* river_material =
+      asset_manager->LoadMaterial(river->material()->c_str());
+  fplbase::Shader* river_shader =
+      asset_manager->LoadShader(river->shader()->c_str());
+  fplbase::Shader* depth_shader =
+      asset_manager->LoadShader("shaders/render_depth");
+  std::vector<Material*> bank_materials(num_zones);
+  std::vector<fplbase::Shader*> bank_shaders(num_zones);
+  for (unsigned int zone = 0; zone < num_zones; zone++) {
+    bank_materials[zone] = asset_manager->LoadMaterial(
+        river->zones()->Get(zone)->material()->c_str());
+    bank_shaders[zone] =
+        asset_manager->LoadShader(bank_materials[zone]->textures().size() == 1
+                                      ? "shaders/textured_lit"
+                                      : "shaders/bank");
+  }
 
-    bank_mesh->AddIndices(bank_indices_by_zone[zone].data(),
-                          static_cast<int>(bank_indices_by_zone[zone].size()),
-                          bank_material);
-    if (!river_data->banks[zone]) {
-      // Now we make a new entity to hold the bank mesh.
-      river_data->banks[zone] = entity_manager_->AllocateNewEntity();
+  // Each chunk is drawn by its own entities: one for the river, and one for
+  // each zone of bank the chunk passes through. The entities from the last
+  // build are reused, in order.
+  auto transform_component =
+      GetComponent<corgi::component_library::TransformComponent>();
+  size_t num_chunk_entities = 0;
+  auto add_chunk_mesh = [&](Mesh* mesh, const RiverMeshChunk& chunk,
+                            const std::string& debug_name) {
+    if (num_chunk_entities == river_data->chunks.size()) {
+      // Now we make a new entity to hold the chunk's mesh.
+      corgi::EntityRef chunk_entity = entity_manager_->AllocateNewEntity();
       entity_manager_->AddEntityToComponent<RenderMeshComponent>(
-          river_data->banks[zone]);
+          chunk_entity);
 
       // Then we stick it as a child of the river entity, so it always moves
       // with it and stays aligned:
-      auto transform_component =
-          GetComponent<corgi::component_library::TransformComponent>();
-      transform_component->AddChild(river_data->banks[zone], entity);
+      transform_component->AddChild(chunk_entity, entity);
+      river_data->chunks.push_back(chunk_entity);
     }
+    const corgi::EntityRef& chunk_entity =
+        river_data->chunks[num_chunk_entities++];
 
-    RenderMeshData* child_render_data =
-        Data<RenderMeshData>(river_data->banks[zone]);
-    if (bank_material->textures().size() == 1) {
-      child_render_data->shaders.push_back(
-          asset_manager->LoadShader("shaders/textured_lit"));
-    } else {
-      child_render_data->shaders.push_back(
-          asset_manager->LoadShader("shaders/bank"));
-    }
-    if (child_render_data->mesh != nullptr) {
+    RenderMeshData* render_data = Data<RenderMeshData>(chunk_entity);
+    if (render_data->mesh != nullptr) {
       // Mesh's destructor handles cleaning up its GL buffers
-      delete child_render_data->mesh;
-      child_render_data->mesh = nullptr;
+      delete render_data->mesh;
+    }
+    render_data->mesh = mesh;
+    render_data->shaders.clear();
+    // Chunks are culled against their bounds by the WorldRenderer instead.
+    render_data->culling_mask = 0;
+    render_data->pass_mask = 1 << corgi::RenderPass_Opaque;
+    render_data->debug_name = debug_name;
+
+    const size_t index = chunk_entity.index();
+    if (index >= chunk_bounds_.size()) chunk_bounds_.resize(index + 1);
+    chunk_bounds_[index].mesh = mesh;
+    chunk_bounds_[index].min_position = chunk.min_position;
+    chunk_bounds_[index].max_position = chunk.max_position;
+    return render_data;
+  };
+
+  for (size_t c = 0; c < build->chunks.size(); ++c) {
+    const RiverMeshChunk& chunk = build->chunks[c];
+
+    // Create the actual mesh objects, and stuff all the data we just
+    // generated into it.
+    Mesh* river_mesh = new Mesh(chunk.river_verts.data(),
+                                chunk.river_verts.size(),
+                                static_cast<int>(sizeof(NormalMappedVertex)),
+                                kMeshFormat);
+    river_mesh->AddIndices(chunk.river_indices.data(),
+                           static_cast<int>(chunk.river_indices.size()),
+                           river_material);
+
+    std::ostringstream river_name;
+    river_name << "river chunk" << c + 1;
+    RenderMeshData* mesh_data =
+        add_chunk_mesh(river_mesh, chunk, river_name.str());
+    mesh_data->shaders.push_back(river_shader);
+    mesh_data->shaders.push_back(depth_shader);
+
+    for (unsigned int zone = 0; zone < num_zones; zone++) {
+      const std::vector<unsigned short>& bank_indices =
+          chunk.bank_indices_by_zone[zone];
+      if (bank_indices.empty()) continue;
+
+      Mesh* bank_mesh = new Mesh(chunk.bank_verts.data(),
+                                 static_cast<int>(chunk.bank_verts.size()),
+                                 sizeof(NormalMappedColorVertex),
+                                 kBankMeshFormat);
+      bank_mesh->AddIndices(bank_indices.data(),
+                            static_cast<int>(bank_indices.size()),
+                            bank_materials[zone]);
+
+      std::ostringstream bank_name;
+      bank_name << "river bank" << zone + 1 << " chunk" << c + 1;
+      RenderMeshData* child_render_data =
+          add_chunk_mesh(bank_mesh, chunk, bank_name.str());
+      child_render_data->shaders.push_back(bank_shaders[zone]);
     }
-    child_render_data->mesh = bank_mesh;
-    child_render_data->culling_mask = 0;  // Don't cull the banks for now.
-    child_render_data->pass_mask = 1 << corgi::RenderPass_Opaque;
-    std::ostringstream debug_name;
-    debug_name << "river bank" << zone + 1;
-    child_render_data->debug_name = debug_name.str();
+  }
+
+  // Drop the entities of chunks the river no longer has.
+  while (river_data->chunks.size() > num_chunk_entities) {
+    corgi::EntityRef& chunk_entity = river_data->chunks.back();
+    RenderMeshData* render_data = Data<RenderMeshData>(chunk_entity);
+    if (render_data->mesh != nullptr) {
+      delete render_data->mesh;
+      render_data->mesh = nullptr;
+    }
+    chunk_bounds_[chunk_entity.index()].mesh = nullptr;
+    entity_manager_->DeleteEntity(chunk_entity);
+    river_data->chunks.pop_back();
   }
 
   // Finalize the static physics mesh created on the river bank.
@@ -515,10 +715,16 @@ void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
   physics_component->FinalizeStaticMesh(entity, collision_type, collides_with,
                                         river->mass(), river->restitution(),
                                         user_tag);
+}
 
-  // We don't want to keep the random number generator set to the same
-  // value every time we generate the river, so reset the seed back to time.
-  srand(static_cast<unsigned int>(time(nullptr)));
+const RiverChunkBounds* RiverComponent::ChunkBounds(
+    const corgi::EntityRef& entity, const fplbase::Mesh* mesh) const {
+  const size_t index = entity.index();
+  if (mesh == nullptr || index >= chunk_bounds_.size() ||
+      chunk_bounds_[index].mesh != mesh) {
+    return nullptr;
+  }
+  return &chunk_bounds_[index];
 }
 
 void RiverComponent::UpdateRiverMeshes(corgi::EntityRef entity) {
@@ -527,9 +733,7 @@ void RiverComponent::UpdateRiverMeshes(corgi::EntityRef entity) {
   if (node_data != nullptr) {
     // For now, update all rivers. In the future only update rivers that
     // have the same rail_name that just changed.
-    for (auto iter = begin(); iter != end(); ++iter) {
-      CreateRiverMesh(iter->entity);
-    }
+    TriggerRiverUpdate();
   }
 }
 
@@ -15,6 +15,7 @@
 #ifndef FPL_ZOOSHI_COMPONENTS_RIVER_H
 #define FPL_ZOOSHI_COMPONENTS_RIVER_H
 
+#include <memory>
 #include <string>
 #include <vector>
 #include "components_generated.h"
@@ -28,6 +29,18 @@
 namespace fpl {
 namespace zooshi {
 
+struct RiverMeshBuild;
+
+// Where a chunk of a river is, so that it can be culled.
+struct RiverChunkBounds {
+  RiverChunkBounds() : mesh(nullptr) {}
+  // The chunk's mesh. The bounds are stale if the entity has any other mesh.
+  const fplbase::Mesh* mesh;
+  // Bounds of the mesh's vertices, in the space of the entity drawing it.
+  mathfu::vec3_packed min_position;
+  mathfu::vec3_packed max_position;
+};
+
 // All the relevent data for rivers ends up tossed into other components.
 // (Mostly rendermesh at the moment.)  This will probably be less empty
 // once the river gets more animated.
@@ -35,13 +48,16 @@ struct RiverData {
   RiverData()
       : render_mesh_needs_update_(false),
         random_seed(static_cast<unsigned int>(rand())) {}
-  std::vector<corgi::EntityRef> banks;
+  // Entities that draw the river and its banks, a chunk at a time.
+  std::vector<corgi::EntityRef> chunks;
   std::string rail_name;
   // Flag for whether this river needs its meshes updated.
   bool render_mesh_needs_update_;
   // River generation has random elements, so we seed the random number
   // generator the same way every time we reload the river.
   unsigned int random_seed;
+  // The mesh being generated for this river on another thread, if any.
+  std::shared_ptr<RiverMeshBuild> mesh_build;
 };
 
 class RiverComponent : public corgi::Component<RiverData> {
@@ -53,21 +69,33 @@ class RiverComponent : public corgi::Component<RiverData> {
 
   virtual void Init();
   virtual void UpdateAllEntities(corgi::WorldTime /*delta_time*/);
+  virtual void CleanupEntity(corgi::EntityRef& entity);
 
   void UpdateRiverMeshes(corgi::EntityRef entity);
 
-  // Updates the meshes for the river.
+  // Updates the meshes for the river. Meshes are generated on a thread of
+  // their own, and swapped in by a later call once they are ready.
   // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
   // IMPORTANT:  This will break if called from any thread other than
   // the main render thread.  Do not call from the update thread!
-  void UpdateRiverMeshes();
+  // Returns true if any meshes were swapped in. The old meshes are deleted, so
+  // any render snapshot that refers to them must be replaced.
+  bool UpdateRiverMeshes();
 
   float river_offset() const { return river_offset_; }
 
+  // Bounds of the river chunk drawn by `entity`, if it's drawing `mesh`.
+  // Returns nullptr for entities that aren't river chunks.
+  const RiverChunkBounds* ChunkBounds(const corgi::EntityRef& entity,
+                                      const fplbase::Mesh* mesh) const;
+
  private:
   void TriggerRiverUpdate();
-  void CreateRiverMesh(corgi::EntityRef& entity);
+  void StartRiverMeshBuild(corgi::EntityRef& entity);
+  void FinishRiverMeshBuild(corgi::EntityRef& entity);
   float river_offset_;
+  // Indexed by the index of the entity drawing each chunk.
+  std::vector<RiverChunkBounds> chunk_bounds_;
 };
 
 }  // zooshi
@@ -127,8 +127,15 @@ float SceneryComponent::DistSq(const corgi::EntityRef& scenery,
   const SceneryData* scenery_data = Data<SceneryData>(scenery);
   const TransformData* transform_data = Data<TransformData>(scenery);
   const float disappear_time = AnimLength(scenery_data, kSceneryDisappear);
+  // Where the raft will be once the scenery has disappeared. Following the
+  // raft's rail keeps the prediction on the river around bends, where heading
+  // straight on would leave it.
   const vec3 pop_out_position =
-      raft.Position() + raft.Velocity() * static_cast<float>(disappear_time);
+      raft.rail != nullptr
+          ? raft.rail->PositionAtTime(
+                static_cast<float>(raft.motivator.SplineTime()) +
+                raft.PlaybackRate() * disappear_time)
+          : raft.Position() + raft.Velocity() * disappear_time;
   return (transform_data->position - pop_out_position).LengthSquared();
 }
 
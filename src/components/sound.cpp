@@ -48,7 +48,17 @@ void SoundComponent::UpdateAllEntities(corgi::WorldTime /*delta_time*/) {
   }
 }
 
-void SoundComponent::CleanupEntity(corgi::EntityRef& entity) {
+void SoundComponent::CleanupEntity(corgi::EntityRef& entity) { Stop(entity); }
+
+void SoundComponent::Play(const corgi::EntityRef& entity) {
+  Stop(entity);
+  SoundData* sound_data = Data<SoundData>(entity);
+  TransformData* transform_data = Data<TransformData>(entity);
+  sound_data->channel =
+      audio_engine_->PlaySound(sound_data->sound, transform_data->position);
+}
+
+void SoundComponent::Stop(const corgi::EntityRef& entity) {
   SoundData* sound_data = Data<SoundData>(entity);
   if (sound_data->channel.Valid()) {
     sound_data->channel.Stop();
@@ -62,9 +72,10 @@ void SoundComponent::AddFromRawData(corgi::EntityRef& entity,
   SoundData* sound_data = AddEntity(entity);
   entity_manager_->AddEntityToComponent<TransformComponent>(entity);
 
-  TransformData* transform_data = Data<TransformData>(entity);
-  sound_data->channel = audio_engine_->PlaySound(sound_def->sound()->c_str(),
-                                                 transform_data->position);
+  // Look the sound up once, so it can be replayed without a string lookup.
+  sound_data->sound =
+      audio_engine_->GetSoundHandle(sound_def->sound()->c_str());
+  Play(entity);
 }
 
 }  // zooshi
@@ -25,6 +25,9 @@ namespace zooshi {
 
 // Data for scene object components.
 struct SoundData {
+  SoundData() : sound(nullptr) {}
+
+  pindrop::SoundHandle sound;
   pindrop::Channel channel;
 };
 
@@ -38,6 +41,13 @@ class SoundComponent : public corgi::Component<SoundData> {
   virtual void CleanupEntity(corgi::EntityRef& entity);
   virtual void UpdateAllEntities(corgi::WorldTime delta_time);
 
+  // Play the entity's sound again from the start, e.g. when a pooled
+  // projectile is thrown again.
+  void Play(const corgi::EntityRef& entity);
+
+  // Stop the entity's sound, if it's playing.
+  void Stop(const corgi::EntityRef& entity);
+
  private:
   pindrop::AudioEngine* audio_engine_;
 };
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "components/time_limit.h"
+#include "components/player_projectile.h"
 #include "corgi_component_library/transform.h"
 #include "fplbase/utilities.h"
 
@@ -39,6 +40,7 @@ void TimeLimitComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
   for (auto iter = component_data_.begin(); iter != component_data_.end();
        ++iter) {
     TimeLimitData* time_limit_data = Data<TimeLimitData>(iter->entity);
+    if (!time_limit_data->enabled) continue;
     time_limit_data->time_elapsed += delta_time;
     if (time_limit_data->time_elapsed >=
         time_limit_data->time_limit - kShrinkTime) {
@@ -52,7 +54,13 @@ void TimeLimitComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
       }
     }
     if (time_limit_data->time_elapsed >= time_limit_data->time_limit) {
-      entity_manager_->DeleteEntity(iter->entity);
+      // Projectiles go back to their pool instead.
+      if (IsRegisteredWithComponent<PlayerProjectileComponent>(iter->entity)) {
+        entity_manager_->GetComponent<PlayerProjectileComponent>()
+            ->ReleaseProjectile(iter->entity);
+      } else {
+        entity_manager_->DeleteEntity(iter->entity);
+      }
     }
   }
 }
@@ -25,10 +25,14 @@ namespace fpl {
 namespace zooshi {
 
 struct TimeLimitData {
-  TimeLimitData() : time_elapsed(0), time_limit(0) {}
+  TimeLimitData() : time_elapsed(0), time_limit(0), enabled(true) {}
   corgi::WorldTime time_elapsed;
   corgi::WorldTime time_limit;
   mathfu::vec3 original_scale;
+
+  // The clock stops while this is false, e.g. for a projectile waiting in
+  // its pool.
+  bool enabled;
 };
 
 // Component for limiting how long things stay in the world.  If they have
@@ -0,0 +1,170 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "trace.h"
+
+namespace fpl {
+namespace zooshi {
+
+static const int64_t kNanosecondsPerSecond = 1000000000;
+static const float kNanosecondsPerMillisecond = 1000000.0f;
+static const int kDefaultRefreshRate = 60;
+
+// Limits on the refresh period estimate, so a run of odd presents can't
+// drive it somewhere absurd.
+static const int64_t kMinPeriod = kNanosecondsPerSecond / 240;
+static const int64_t kMaxPeriod = kNanosecondsPerSecond / 24;
+
+// A present this close to the vsync it was due at, as a fraction of the
+// period, landed on that vsync.
+static const float kPeriodTolerance = 0.25f;
+
+// A swap that took at least this fraction of the period blocked on vsync.
+static const float kBlockedPresentFraction = 1.0f / 16.0f;
+
+// When the display reports its rate, the estimate stays within this fraction
+// of it. That allows for rates the display rounds, like 59.94Hz, while
+// presents that aren't paced by the display can't drag it anywhere else.
+static const float kReportedPeriodTolerance = 0.02f;
+
+// Weight of each new present interval in the period estimate.
+static const float kPeriodSmoothing = 1.0f / 16.0f;
+
+FramePacer::FramePacer()
+    : period_(kNanosecondsPerSecond / kDefaultRefreshRate),
+      min_period_(kMinPeriod),
+      max_period_(kMaxPeriod),
+      last_vsync_present_(0),
+      target_vsync_(0),
+      last_signaled_vsync_(0),
+      stopped_(false),
+      total_error_(0.0),
+      frame_target_(0),
+      present_started_(0),
+      last_present_on_vsync_(false) {}
+
+int64_t FramePacer::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+void FramePacer::Initialize(int refresh_rate) {
+  const bool reported = refresh_rate > 0;
+  if (!reported) refresh_rate = kDefaultRefreshRate;
+  const int64_t period = std::min(
+      std::max(kNanosecondsPerSecond / refresh_rate, kMinPeriod), kMaxPeriod);
+  period_ = period;
+  const int64_t slack =
+      reported ? static_cast<int64_t>(period * kReportedPeriodTolerance)
+               : kMaxPeriod;
+  min_period_ = std::max(period - slack, kMinPeriod);
+  max_period_ = std::min(period + slack, kMaxPeriod);
+  last_vsync_present_ = Now();
+  target_vsync_ = 0;
+  last_signaled_vsync_ = 0;
+  stats_ = FramePacingStats();
+  total_error_ = 0.0;
+  frame_target_ = 0;
+  present_started_ = 0;
+  last_present_on_vsync_ = false;
+}
+
+void FramePacer::WaitForVsync() {
+  const int64_t period = period_;
+  const int64_t last_vsync = last_vsync_present_;
+  const int64_t now = Now();
+
+  // The first predicted vsync after now, counting from the last one a frame
+  // was presented at.
+  const int64_t periods_since_vsync =
+      now > last_vsync ? (now - last_vsync) / period + 1 : 1;
+  int64_t vsync = last_vsync + periods_since_vsync * period;
+
+  // Never signal the same vsync twice, even if a late present moved the
+  // prediction back.
+  if (vsync < last_signaled_vsync_ + period / 2) {
+    vsync = last_signaled_vsync_ + period;
+  }
+
+  std::this_thread::sleep_until(Clock::time_point(
+      std::chrono::duration_cast<Clock::duration>(
+          std::chrono::nanoseconds(vsync))));
+  last_signaled_vsync_ = vsync;
+
+  // A frame started on this vsync is due at the next one.
+  target_vsync_ = vsync + period;
+}
+
+void FramePacer::FrameStarted() { frame_target_ = target_vsync_.exchange(0); }
+
+void FramePacer::PresentStarted() { present_started_ = Now(); }
+
+bool FramePacer::FramePresented() {
+  const int64_t now = Now();
+  const int64_t period = period_;
+  const int64_t target = frame_target_;
+  frame_target_ = 0;
+  stats_.refresh_period = period / kNanosecondsPerMillisecond;
+
+  // Only a swap that blocked tells us where the display's vsyncs are.
+  const bool blocked =
+      present_started_ != 0 &&
+      now - present_started_ >= period * kBlockedPresentFraction;
+  present_started_ = 0;
+  if (!blocked) {
+    last_present_on_vsync_ = false;
+  } else {
+    const int64_t interval = now - last_vsync_present_.exchange(now);
+
+    // Refine the period only from back to back presents that both landed on
+    // the vsyncs they were due at. A present that didn't was late, or the
+    // prediction hasn't locked on to the display yet.
+    const bool on_vsync =
+        target != 0 &&
+        std::abs(static_cast<float>(now - target)) < period * kPeriodTolerance;
+    if (on_vsync && last_present_on_vsync_) {
+      const int64_t refreshes = std::max(
+          static_cast<int64_t>(std::llround(static_cast<double>(interval) /
+                                            period)),
+          static_cast<int64_t>(1));
+      const int64_t refined =
+          period +
+          static_cast<int64_t>((interval / refreshes - period) *
+                               kPeriodSmoothing);
+      period_ = std::min(std::max(refined, min_period_), max_period_);
+      stats_.refresh_period = period_ / kNanosecondsPerMillisecond;
+    }
+    last_present_on_vsync_ = on_vsync;
+  }
+  if (target == 0) return false;
+
+  const float error = (now - target) / kNanosecondsPerMillisecond;
+  const float abs_error = std::fabs(error);
+  stats_.frame_count++;
+  total_error_ += abs_error;
+  stats_.mean_error = static_cast<float>(total_error_ / stats_.frame_count);
+  stats_.max_error = std::max(stats_.max_error, abs_error);
+  TraceCounter("PacingErrorUs", static_cast<int32_t>(error * 1000.0f));
+  return error > stats_.refresh_period / 2.0f;
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,119 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_FRAME_PACER_H_
+#define ZOOSHI_FRAME_PACER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace fpl {
+namespace zooshi {
+
+// How closely frames have been presented to the vsyncs the pacer predicted
+// for them, in milliseconds.
+struct FramePacingStats {
+  FramePacingStats()
+      : refresh_period(0.0f),
+        mean_error(0.0f),
+        max_error(0.0f),
+        frame_count(0) {}
+
+  // Current estimate of the display's refresh period.
+  float refresh_period;
+
+  // Mean and max of |present time - predicted vsync|.
+  float mean_error;
+  float max_error;
+
+  int frame_count;
+};
+
+// Predicts display vsyncs on platforms that don't report them, so the render
+// thread can be woken once per refresh instead of polling.
+//
+// A swap that blocks on vsync returns just after one, so predicted vsyncs are
+// aligned to the most recent present whose swap blocked. The refresh period
+// starts from the rate the display reports, and is refined from the interval
+// between presents that blocked and also landed on the vsyncs predicted for
+// them. Presents whose swap didn't block, as with a compositor that doesn't
+// wait for vsync, say nothing about the display and are ignored, so the
+// pacer keeps to its own estimate.
+class FramePacer {
+ public:
+  FramePacer();
+
+  // Start pacing a display that refreshes `refresh_rate` times per second.
+  // Pass 0 if the rate is unknown, to assume 60Hz.
+  void Initialize(int refresh_rate);
+
+  // Sleep until the next predicted vsync. Call from the pacing thread, which
+  // then signals the render thread.
+  void WaitForVsync();
+
+  // Call from the render thread when it starts each frame, once woken for
+  // it, and right before presenting it.
+  void FrameStarted();
+  void PresentStarted();
+
+  // Call from the render thread right after each frame has been presented.
+  // Returns true if the frame missed the vsync it was due at.
+  bool FramePresented();
+
+  // Make the pacing thread exit its loop.
+  void Stop() { stopped_ = true; }
+  bool stopped() const { return stopped_; }
+
+  // Pacing since Initialize. Read on the render thread.
+  const FramePacingStats& stats() const { return stats_; }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  static int64_t Now();
+
+  // Estimated refresh period, in nanoseconds, and the range it's kept in.
+  std::atomic<int64_t> period_;
+  int64_t min_period_;
+  int64_t max_period_;
+
+  // Time of the last present whose swap blocked, which was at a vsync.
+  std::atomic<int64_t> last_vsync_present_;
+
+  // The vsync a frame started on the last signaled vsync should be presented
+  // at, or 0 if no vsync has been signaled since a frame last started.
+  std::atomic<int64_t> target_vsync_;
+
+  // The last vsync the pacing thread signaled. Pacing thread only.
+  int64_t last_signaled_vsync_;
+
+  std::atomic<bool> stopped_;
+
+  // Render thread only.
+  FramePacingStats stats_;
+  double total_error_;
+
+  // The vsync the frame being rendered should be presented at, or 0 if it
+  // didn't start on one, when it started presenting, and whether the last
+  // one was presented at the vsync it was due at. Render thread only.
+  int64_t frame_target_;
+  int64_t present_started_;
+  bool last_present_on_vsync_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_FRAME_PACER_H_
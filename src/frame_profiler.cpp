@@ -0,0 +1,160 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frame_profiler.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <chrono>
+
+#include "fplbase/utilities.h"
+
+using fplbase::LogInfo;
+
+namespace fpl {
+namespace zooshi {
+
+static const float kNanosecondsPerMillisecond = 1000000.0f;
+
+// Nearest-rank percentile of sorted samples.
+static float Percentile(const std::vector<float>& sorted, float percentile) {
+  const int count = static_cast<int>(sorted.size());
+  const int index =
+      std::min(count - 1, static_cast<int>(percentile * count + 0.5f));
+  return sorted[index];
+}
+
+FrameProfiler::FrameProfiler(int history_size)
+    : history_size_(history_size),
+      next_sample_(0),
+      sample_count_(0),
+      total_dropped_frames_(0),
+      queue_stuffing_time_(0.0),
+      total_overlap_time_(0.0),
+      update_start_(0),
+      update_end_(0),
+      render_start_(0),
+      last_frame_end_(0),
+      last_frame_time_(0.0f),
+      log_interval_(0.0f),
+      time_since_log_(0.0f) {
+  assert(history_size_ > 0);
+  samples_.resize(history_size_);
+}
+
+int64_t FrameProfiler::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void FrameProfiler::UpdateStarted() { update_start_ = Now(); }
+
+void FrameProfiler::UpdateFinished() { update_end_ = Now(); }
+
+void FrameProfiler::RenderStarted() { render_start_ = Now(); }
+
+void FrameProfiler::FrameFinished(bool dropped, bool queue_stuffing) {
+  const int64_t now = Now();
+  if (last_frame_end_ == 0) {
+    // The first frame has nothing to be measured from.
+    last_frame_end_ = now;
+    return;
+  }
+  const float frame_time = (now - last_frame_end_) / kNanosecondsPerMillisecond;
+  last_frame_end_ = now;
+  last_frame_time_ = frame_time;
+
+  // Overlap of [render_start_, now] with the latest update, which may still
+  // be running.
+  const int64_t update_start = update_start_;
+  int64_t update_end = update_end_;
+  if (update_end < update_start) update_end = now;
+  const int64_t overlap_start = std::max(render_start_, update_start);
+  const int64_t overlap_end = std::min(now, update_end);
+  const float overlap =
+      overlap_end > overlap_start
+          ? (overlap_end - overlap_start) / kNanosecondsPerMillisecond
+          : 0.0f;
+
+  Sample& sample = samples_[next_sample_];
+  sample.frame_time = frame_time;
+  sample.overlap = overlap;
+  sample.dropped = dropped;
+  next_sample_ = (next_sample_ + 1) % history_size_;
+  sample_count_ = std::min(sample_count_ + 1, history_size_);
+
+  if (dropped) total_dropped_frames_++;
+  if (queue_stuffing) queue_stuffing_time_ += frame_time;
+  total_overlap_time_ += overlap;
+
+  if (log_interval_ > 0.0f) {
+    time_since_log_ += frame_time;
+    if (time_since_log_ >= log_interval_) {
+      time_since_log_ = 0.0f;
+      LogStats();
+    }
+  }
+}
+
+bool FrameProfiler::GetStats(FrameTimingStats* stats) const {
+  if (sample_count_ == 0) return false;
+
+  // Samples are only valid from the start of the buffer until it first wraps,
+  // after which every slot has been written.
+  sorted_.clear();
+  float total_overlap = 0.0f;
+  int dropped_frames = 0;
+  for (int i = 0; i < sample_count_; ++i) {
+    sorted_.push_back(samples_[i].frame_time);
+    total_overlap += samples_[i].overlap;
+    if (samples_[i].dropped) dropped_frames++;
+  }
+  std::sort(sorted_.begin(), sorted_.end());
+
+  stats->p50 = Percentile(sorted_, 0.50f);
+  stats->p95 = Percentile(sorted_, 0.95f);
+  stats->p99 = Percentile(sorted_, 0.99f);
+  stats->max = sorted_.back();
+  stats->dropped_frames = dropped_frames;
+  stats->total_dropped_frames = total_dropped_frames_;
+  stats->queue_stuffing_time = static_cast<float>(queue_stuffing_time_);
+  stats->mean_overlap = total_overlap / sample_count_;
+  stats->total_overlap_time = static_cast<float>(total_overlap_time_);
+  stats->sample_count = sample_count_;
+  return true;
+}
+
+void FrameProfiler::LogStats() const {
+  FrameTimingStats s;
+  if (!GetStats(&s)) return;
+  LogInfo("Frames (ms): p50 %.2f p95 %.2f p99 %.2f max %.2f | dropped %d/%d "
+          "(%d total) | queue stuffing %.0f | overlap %.2f/frame",
+          s.p50, s.p95, s.p99, s.max, s.dropped_frames, s.sample_count,
+          s.total_dropped_frames, s.queue_stuffing_time, s.mean_overlap);
+}
+
+void FrameProfiler::Reset() {
+  next_sample_ = 0;
+  sample_count_ = 0;
+  total_dropped_frames_ = 0;
+  queue_stuffing_time_ = 0.0;
+  total_overlap_time_ = 0.0;
+  last_frame_end_ = 0;
+  last_frame_time_ = 0.0f;
+  time_since_log_ = 0.0f;
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,146 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_FRAME_PROFILER_H_
+#define ZOOSHI_FRAME_PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace fpl {
+namespace zooshi {
+
+// Summary of how frames have been delivered. Times are in milliseconds.
+struct FrameTimingStats {
+  FrameTimingStats()
+      : p50(0.0f),
+        p95(0.0f),
+        p99(0.0f),
+        max(0.0f),
+        dropped_frames(0),
+        total_dropped_frames(0),
+        queue_stuffing_time(0.0f),
+        mean_overlap(0.0f),
+        total_overlap_time(0.0f),
+        sample_count(0) {}
+
+  // Percentiles of the time between consecutive frames.
+  float p50;
+  float p95;
+  float p99;
+  float max;
+
+  // Frames that missed their vsync, in the history and in total.
+  int dropped_frames;
+  int total_dropped_frames;
+
+  // Total time spent in queue-stuffing mode, where the render thread stops
+  // waiting for vsync because it has been dropping frames.
+  float queue_stuffing_time;
+
+  // Time the render thread spent rendering while the game was updating, per
+  // frame in the history and in total.
+  float mean_overlap;
+  float total_overlap_time;
+
+  // Number of frames the history stats were computed over.
+  int sample_count;
+};
+
+// Records how long each frame took to deliver, whether it dropped, and how
+// much of its rendering overlapped the game update, so that frame pacing can
+// be monitored without a profiler attached. The last `history_size` frames
+// are kept for percentiles; counts and times are also totalled since the last
+// Reset().
+//
+// UpdateStarted() and UpdateFinished() may be called from the update thread.
+// Everything else must be called from the render thread.
+class FrameProfiler {
+ public:
+  // Five seconds of history at 60 frames per second.
+  static const int kDefaultHistorySize = 300;
+
+  explicit FrameProfiler(int history_size = kDefaultHistorySize);
+
+  // Bracket each game update.
+  void UpdateStarted();
+  void UpdateFinished();
+
+  // Call when the render thread starts drawing a frame.
+  void RenderStarted();
+
+  // Call once a frame has been presented. `dropped` is whether it missed its
+  // vsync, and `queue_stuffing` whether the render thread skipped waiting for
+  // vsync before drawing it.
+  void FrameFinished(bool dropped, bool queue_stuffing);
+
+  // Duration of the most recent frame, in milliseconds.
+  float last_frame_time() const { return last_frame_time_; }
+
+  // Summarize the recorded frames. Returns false if nothing has been recorded
+  // yet.
+  bool GetStats(FrameTimingStats* stats) const;
+
+  // Write the stats to the log, as a single line.
+  void LogStats() const;
+
+  // Call LogStats() every `log_interval` milliseconds. Zero, the default,
+  // never logs.
+  void set_log_interval(float log_interval) { log_interval_ = log_interval; }
+  float log_interval() const { return log_interval_; }
+
+  // Clear all recorded frames.
+  void Reset();
+
+ private:
+  static int64_t Now();
+
+  struct Sample {
+    float frame_time;
+    float overlap;
+    bool dropped;
+  };
+
+  // Ring buffer of recent frames.
+  std::vector<Sample> samples_;
+  int history_size_;
+  int next_sample_;
+  int sample_count_;
+
+  // Totals since the last Reset().
+  int total_dropped_frames_;
+  double queue_stuffing_time_;
+  double total_overlap_time_;
+
+  // Start and end of the latest game update, in nanoseconds. The end is
+  // before the start while an update is running.
+  std::atomic<int64_t> update_start_;
+  std::atomic<int64_t> update_end_;
+
+  int64_t render_start_;
+  int64_t last_frame_end_;
+  float last_frame_time_;
+
+  float log_interval_;
+  float time_since_log_;
+
+  // Scratch space for computing percentiles, to avoid allocating per query.
+  mutable std::vector<float> sorted_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_FRAME_PROFILER_H_
@@ -67,17 +67,31 @@ bool FullScreenFader::AdvanceFrame(int delta_time) {
 
 // Renders the fade overlay.
 void FullScreenFader::Render(fplbase::Renderer* renderer) {
-  float t = std::min(static_cast<float>(std::min(current_fade_time_,
-                                                 end_fade_time_)) /
-                         static_cast<float>(total_fade_time_), 1.0f);
-  float alpha = sin(t * static_cast<float>(M_PI));
+  Render(renderer, GetState());
+}
+
+void FullScreenFader::Render(fplbase::Renderer* renderer,
+                             const FullScreenFaderState& state) const {
   // Render the overlay in front on the screen.
-  renderer->set_color(mathfu::vec4(color_, alpha));
+  renderer->set_color(mathfu::vec4(state.color, state.alpha));
   material_->Set(*renderer);
   shader_->Set(*renderer);
   // Clear depth buffer to prevent z-fight issues.
   renderer->ClearDepthBuffer();
-  fplbase::Mesh::RenderAAQuadAlongX(bottom_left_, top_right_);
+  fplbase::Mesh::RenderAAQuadAlongX(state.bottom_left, state.top_right);
+}
+
+FullScreenFaderState FullScreenFader::GetState() const {
+  FullScreenFaderState state;
+  state.visible = !Finished();
+  float t = std::min(static_cast<float>(std::min(current_fade_time_,
+                                                 end_fade_time_)) /
+                         static_cast<float>(total_fade_time_), 1.0f);
+  state.alpha = sin(t * static_cast<float>(M_PI));
+  state.color = color_;
+  state.bottom_left = bottom_left_;
+  state.top_right = top_right_;
+  return state;
 }
 
 // Returns true when the fade is complete (overlay is transparent).
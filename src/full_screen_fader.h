@@ -31,6 +31,24 @@ enum FadeType {
   kFadeOut,
 };
 
+// How the fading overlay looks at one moment, so that it can be drawn from a
+// render snapshot while the fade carries on.
+struct FullScreenFaderState {
+  FullScreenFaderState()
+      : visible(false),
+        alpha(0.0f),
+        color(mathfu::kZeros3f),
+        bottom_left(mathfu::kZeros3f),
+        top_right(mathfu::kZeros3f) {}
+
+  // False once the fade is complete, and there's nothing to draw.
+  bool visible;
+  float alpha;
+  mathfu::vec3 color;
+  mathfu::vec3 bottom_left;
+  mathfu::vec3 top_right;
+};
+
 // Renders a fullscreen overlay fading effect that transitions to
 // opaque then back to transparent.
 class FullScreenFader {
@@ -52,6 +70,11 @@ class FullScreenFader {
   bool AdvanceFrame(int delta_time);
   // Renders the fullscreen fading overlay.
   void Render(fplbase::Renderer* renderer);
+  // Renders the overlay as it looked when `state` was taken with GetState().
+  void Render(fplbase::Renderer* renderer,
+              const FullScreenFaderState& state) const;
+  // Get how the overlay looks now.
+  FullScreenFaderState GetState() const;
   // Returns true when the fullscreen fading effect is complete.
   bool Finished() const;
   // Get the fraction (0..1) elapsed through the fader's fade time.
@@ -15,9 +15,13 @@
 #include "game.h"
 
 #include <stdarg.h>
+#include <stdio.h>
+#include <chrono>
+#include <limits>
 
 #include "SDL.h"
 #include "SDL_events.h"
+#include "allocation_tracker.h"
 #include "anim_generated.h"
 #include "assets_generated.h"
 #include "audio_config_generated.h"
@@ -27,17 +31,18 @@
 #include "common.h"
 #include "components/render_3d_text.h"
 #include "corgi/entity.h"
+#include "flatui/flatui.h"
 
 #include "mathfu/internal/disable_warnings_begin.h"
 
 #include "mathfu/internal/disable_warnings_end.h"
 
-#include "fplbase/debug_markers.h"
 #include "fplbase/input.h"
 #include "fplbase/systrace.h"
 #include "fplbase/utilities.h"
 #include "graph_generated.h"
 #include "input_config_generated.h"
+#include "inputcontrollers/headless_controller.h"
 #include "mathfu/glsl_mappings.h"
 #include "mathfu/vector.h"
 #include "module_library/animation.h"
@@ -61,6 +66,8 @@
 #include "motive/math/angle.h"
 #include "motive/util/benchmark.h"
 #include "pindrop/pindrop.h"
+#include "stress_scene.h"
+#include "trace.h"
 #include "world.h"
 
 #ifdef __ANDROID__
@@ -95,6 +102,7 @@ static const char kAssetsDir[] = "assets";
 static const char kConfigFileName[] = "config.zooconfig";
 
 std::string Game::overlay_name_;
+std::string Game::trace_file_name_;
 
 #ifdef __ANDROID__
 static const int kAndroidMaxScreenWidth = 1280;
@@ -112,6 +120,21 @@ static const int kMaxUpdateTime = 1000 / 30;
 static const int kUpdateGameStateCode = 555;
 static const int kUpdateRenderPrepCode = 556;
 
+// How often to dump per-component update times to the log, in milliseconds.
+static const corgi::WorldTime kComponentTimingLogInterval = 5000;
+
+// How often to log frame delivery stats, in milliseconds.
+static const float kFrameStatsLogInterval = 5000.0f;
+
+// How often to log heap allocation stats, in game updates, when the build
+// tracks allocations.
+static const int kAllocationLogInterval = 300;
+
+// Size and placement of the frame stats overlay, in virtual resolution.
+static const float kFrameStatsTextSize = 28.0f;
+static const float kFrameStatsMargin = 20.0f;
+static const vec4 kFrameStatsTextColor = vec4(1.0f, 1.0f, 0.0f, 1.0f);
+
 /// kVersion is used by Google developers to identify which
 /// applications uploaded to Google Play are derived from this application.
 /// This allows the development team at Google to determine the popularity of
@@ -127,10 +150,12 @@ GameSynchronization::GameSynchronization()
       updatethread_mutex_(SDL_CreateMutex()),
       gameupdate_mutex_(SDL_CreateMutex()),
       start_render_cv_(SDL_CreateCond()),
-      start_update_cv_(SDL_CreateCond()) {}
+      start_update_cv_(SDL_CreateCond()),
+      vsync_count_(0) {}
 
 Game::Game()
-    : asset_manager_(renderer_),
+    : show_frame_stats_(DISPLAY_FRAME_STATS != 0),
+      asset_manager_(renderer_),
       graph_factory_(&module_registry_, &LoadFile),
       shader_textured_(nullptr),
       game_exiting_(false),
@@ -273,13 +298,15 @@ bool Game::InitializeAssets() {
 
   shader_textured_ = asset_manager_.LoadShader("shaders/textured");
 
-  // Load the animation table and all animations it references.
-  motive::AnimTable &anim_table = world_.animation_component.anim_table();
-  const bool anim_ok =
-      anim_table.InitFromFlatBuffers(*asset_manifest.anims(), LoadAnimFn);
-  if (!anim_ok) return false;
+  return InitializeAnimations();
+}
 
-  return true;
+// Load the animation table and all animations it references. Unlike the rest
+// of the assets, animations don't touch the renderer.
+bool Game::InitializeAnimations() {
+  motive::AnimTable &anim_table = world_.animation_component.anim_table();
+  return anim_table.InitFromFlatBuffers(*GetAssetManifest().anims(),
+                                        LoadAnimFn);
 }
 
 const Config &Game::GetConfig() const {
@@ -325,6 +352,7 @@ void Game::InitializeBreadboardModules() {
   InitializeGpgModule(&module_registry_, &GetConfig(), &gpg_manager_);
   InitializePatronModule(&module_registry_, &world_.patron_component);
   InitializePlayerModule(&module_registry_, &world_.player_component,
+                         &world_.player_projectile_component,
                          &world_.graph_component);
   InitializeRailDenizenModule(&module_registry_, &world_.rail_denizen_component,
                               &world_.graph_component);
@@ -372,6 +400,7 @@ bool Game::Initialize(const char *const binary_directory) {
 #endif  // FPLBASE_ANDROID_VR
 
   SystraceInit();
+  if (!trace_file_name_.empty()) TraceStart();
 
   if (!fplbase::ChangeToUpstreamDir(binary_directory, kAssetsDir)) return false;
 
@@ -411,6 +440,13 @@ bool Game::Initialize(const char *const binary_directory) {
   world_.Initialize(GetConfig(), &input_, &asset_manager_, &world_renderer_,
                     &font_manager_, &audio_engine_, &graph_factory_, &renderer_,
                     scene_lab_.get(), &unlockable_manager_, &xp_system_);
+#if DISPLAY_COMPONENT_TIMINGS
+  world_.component_profiler.set_log_interval(kComponentTimingLogInterval);
+#endif  // DISPLAY_COMPONENT_TIMINGS
+#if DISPLAY_FRAME_STATS
+  frame_profiler_.set_log_interval(kFrameStatsLogInterval);
+#endif  // DISPLAY_FRAME_STATS
+  AllocationSetLogInterval(kAllocationLogInterval);
 
 #if FPLBASE_ANDROID_VR
   if (fplbase::SupportsHeadMountedDisplay()) {
@@ -522,6 +558,58 @@ bool Game::Initialize(const char *const binary_directory) {
   return true;
 }
 
+// Number of updates between projectiles thrown by the headless controller.
+static const int kHeadlessFireInterval = 20;
+
+// A trimmed down Initialize() for the headless runner. The renderer is never
+// initialized, so there is no window and no GL context, and only the assets
+// that the simulation reads are loaded. Meshes and shaders referenced by
+// entity data are still requested by the components, but without a current
+// context those requests produce no GPU work.
+bool Game::InitializeHeadless(const char *const binary_directory) {
+  LogInfo("Zooshi Initializing (headless)...");
+
+  if (!fplbase::ChangeToUpstreamDir(binary_directory, kAssetsDir)) return false;
+
+  if (!LoadFile(kConfigFileName, &config_source_)) return false;
+
+  if (!LoadFile(GetConfig().input_config()->c_str(), &input_config_source_))
+    return false;
+
+  if (!LoadFile(GetConfig().assets_filename()->c_str(),
+                &asset_manifest_source_)) {
+    return false;
+  }
+  const auto &asset_manifest = GetAssetManifest();
+
+  if (!InitializeAnimations()) return false;
+
+  // Sound components and graphs still play sounds, so the engine has to be
+  // up, but nothing should reach a real output device.
+  SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+  if (!audio_engine_.Initialize(GetConfig().audio_config()->c_str())) {
+    return false;
+  }
+  audio_engine_.LoadSoundBank(asset_manifest.sound_bank()->c_str());
+  audio_engine_.StartLoadingSoundFiles();
+
+  InitializeBreadboardModules();
+
+  world_.Initialize(GetConfig(), &input_, &asset_manager_, &world_renderer_,
+                    &font_manager_, &audio_engine_, &graph_factory_, &renderer_,
+                    nullptr, &unlockable_manager_, &xp_system_);
+  world_.component_profiler.set_log_interval(kComponentTimingLogInterval);
+  world_.AddController(new HeadlessController(kHeadlessFireInterval));
+
+  const Config *config = &GetConfig();
+  unlockable_manager_.InitializeType(UnlockableType_Sushi,
+                                     config->sushi_config());
+  xp_system_.Initialize(config);
+
+  LogInfo("Initialization complete\n");
+  return true;
+}
+
 void Game::SetRelativeMouseMode(bool relative_mouse_mode) {
   relative_mouse_mode_ = relative_mouse_mode;
   input_.SetRelativeMouseMode(relative_mouse_mode);
@@ -549,14 +637,18 @@ struct UpdateThreadData {
                    fplbase::Renderer *renderer_ptr,
                    fplbase::InputSystem *input_ptr,
                    pindrop::AudioEngine *audio_engine_ptr,
-                   GameSynchronization *sync_ptr)
+                   GameSynchronization *sync_ptr,
+                   FrameProfiler *frame_profiler_ptr)
       : game_exiting(exiting),
         world(world_ptr),
         state_machine(statemachine_ptr),
         renderer(renderer_ptr),
         input(input_ptr),
         audio_engine(audio_engine_ptr),
-        sync(sync_ptr) {}
+        sync(sync_ptr),
+        frame_profiler(frame_profiler_ptr),
+        frame_start(0),
+        unsimulated_time(0) {}
   bool *game_exiting;
   World *world;
   StateMachine<kGameStateCount> *state_machine;
@@ -564,9 +656,42 @@ struct UpdateThreadData {
   fplbase::InputSystem *input;
   pindrop::AudioEngine *audio_engine;
   GameSynchronization *sync;
+  FrameProfiler *frame_profiler;
   corgi::WorldTime frame_start;
+  // Time not yet simulated, when running fixed-length updates.
+  corgi::WorldTime unsimulated_time;
 };
 
+// Run as many fixed-length updates as fit into the time that has passed, and
+// tell the renderer how far past the last update real time has run.
+static void AdvanceFixedUpdates(UpdateThreadData *rt_data,
+                                corgi::WorldTime elapsed_time) {
+  const Config *config = rt_data->world->config;
+  const corgi::WorldTime update_time = config->fixed_update_time();
+  const int max_updates = config->max_fixed_updates_per_frame();
+
+  rt_data->unsimulated_time += elapsed_time;
+  int updates = rt_data->unsimulated_time / update_time;
+  if (updates > max_updates) {
+    // We can't catch up without making every frame slower than the last, so
+    // drop the time we can't simulate.
+    updates = max_updates;
+    rt_data->unsimulated_time = updates * update_time;
+  }
+
+  StateMachine<kGameStateCount> *state_machine = rt_data->state_machine;
+  for (int i = 0; i < updates && !state_machine->done(); ++i) {
+    if (i == updates - 1) {
+      state_machine->SaveInterpolationState();
+    }
+    state_machine->AdvanceFrame(update_time);
+    rt_data->unsimulated_time -= update_time;
+  }
+
+  rt_data->world->world_renderer->set_interpolation(
+      static_cast<float>(rt_data->unsimulated_time) / update_time);
+}
+
 // This is the thread that handles all of our actual game logic updates:
 static int UpdateThread(void *data) {
   UpdateThreadData *rt_data = static_cast<UpdateThreadData *>(data);
@@ -587,6 +712,7 @@ static int UpdateThread(void *data) {
       nullptr;  // you might want to assign the java thread to a ThreadGroup
   jvm->AttachCurrentThread(&update_env, &args);
 #endif  // __ANDROID__
+  TraceSetThreadName("Zooshi Update Thread");
 
   SDL_LockMutex(sync.updatethread_mutex_);
   while (!*(rt_data->game_exiting)) {
@@ -599,22 +725,36 @@ static int UpdateThread(void *data) {
     // through actually putting everything on the screen.
     // -------------------------------------------
     SDL_LockMutex(sync.gameupdate_mutex_);
+    rt_data->frame_profiler->UpdateStarted();
     const corgi::WorldTime world_time = CurrentWorldTime(*rt_data->input);
+    const bool fixed_updates = rt_data->world->config->fixed_update_time() > 0;
+    // Fixed-length updates bound the time themselves, by limiting how many
+    // updates run per frame.
     const corgi::WorldTime delta_time =
-        std::min(world_time - prev_update_time, kMaxUpdateTime);
+        fixed_updates ? world_time - prev_update_time
+                      : std::min(world_time - prev_update_time, kMaxUpdateTime);
     prev_update_time = world_time;
 
-    SystraceAsyncBegin("UpdateGameState", kUpdateGameStateCode);
-    rt_data->state_machine->AdvanceFrame(delta_time);
-    SystraceAsyncEnd("UpdateGameState", kUpdateGameStateCode);
+    TraceAsyncBegin("UpdateGameState", kUpdateGameStateCode);
+    rt_data->state_machine->HandleInput();
+    if (fixed_updates) {
+      AdvanceFixedUpdates(rt_data, delta_time);
+    } else {
+      rt_data->state_machine->AdvanceFrame(delta_time);
+    }
+    TraceAsyncEnd("UpdateGameState", kUpdateGameStateCode);
 
-    SystraceAsyncBegin("UpdateRenderPrep", kUpdateRenderPrepCode);
+    TraceAsyncBegin("UpdateRenderPrep", kUpdateRenderPrepCode);
     rt_data->state_machine->RenderPrep();
-    SystraceAsyncEnd("UpdateRenderPrep", kUpdateRenderPrepCode);
+    TraceAsyncEnd("UpdateRenderPrep", kUpdateRenderPrepCode);
 
+    TraceBegin("AudioEngine::AdvanceFrame()");
     rt_data->audio_engine->AdvanceFrame(delta_time / 1000.0f);
+    TraceEnd();
 
+    AllocationFrameEnd();
     *(rt_data->game_exiting) |= rt_data->state_machine->done();
+    rt_data->frame_profiler->UpdateFinished();
     SDL_UnlockMutex(sync.gameupdate_mutex_);
   }
 
@@ -629,14 +769,21 @@ static int UpdateThread(void *data) {
 // TODO: Modify vsync callback API to take a context parameter.
 static GameSynchronization *global_vsync_context = nullptr;
 void HandleVsync() {
+  TraceInstant("Vsync");
+  SDL_LockMutex(global_vsync_context->renderthread_mutex_);
+  global_vsync_context->vsync_count_++;
   SDL_CondBroadcast(global_vsync_context->start_render_cv_);
+  SDL_UnlockMutex(global_vsync_context->renderthread_mutex_);
 }
 
-// Hack, to simulate vsync events on non-android devices.
-static int VsyncSimulatorThread(void * /*data*/) {
-  while (true) {
+// Simulate vsync events on non-android devices, by sleeping until the vsync
+// the frame pacer predicts.
+static int VsyncSimulatorThread(void *data) {
+  FramePacer *pacer = static_cast<FramePacer *>(data);
+  TraceSetThreadName("Zooshi Simulated Vsync Thread");
+  while (!pacer->stopped()) {
+    pacer->WaitForVsync();
     HandleVsync();
-    SDL_Delay(2);
   }
   return 0;
 }
@@ -646,10 +793,15 @@ static int VsyncSimulatorThread(void * /*data*/) {
 // The general plan is:
 // 1. Vsync happens.  Everything begins.
 // 2. Renderthread activates.  (The update thread is currently blocked.)
+//    It polls input, and does any work that needs both the GL context and
+//    the world, such as rebuilding river meshes.
 // 3. Renderthread dumps everything into opengl, via RenderAllEntities.  (And
-//    any other similar calls, such as calls to IMGUI)  Updatethread is
-//    still blocked.  When this is complete, OpenGL now has its own copy of
-//    everything, and we can safely change world state data.
+//    any other similar calls, such as calls to IMGUI)  Most states draw the
+//    world from the snapshot published by the last update, which the
+//    renderthread owns, so the updatethread is woken up before this step
+//    instead of after it.  The UI still waits for that update to finish,
+//    since it changes game state.  Other states render with the
+//    updatethread blocked.
 // 4. Renderthread signals updatethread to wake up.
 // 5a.Renderthread calls gl_flush, (via Renderer.advanceframe) and waits for
 //    everything render.  Once complete, it goes to sleep and waits for the
@@ -658,9 +810,11 @@ static int VsyncSimulatorThread(void * /*data*/) {
 //    next frame.  Once complete, it also goes to sleep and waits for the next
 //    vsync event.
 void Game::Run() {
+  TraceSetThreadName("Zooshi Render Thread");
+
   // Start the update thread:
   UpdateThreadData rt_data(&game_exiting_, &world_, &state_machine_, &renderer_,
-                           &input_, &audio_engine_, &sync_);
+                           &input_, &audio_engine_, &sync_, &frame_profiler_);
 
   input_.AdvanceFrame(&renderer_.window_size());
   state_machine_.AdvanceFrame(16);
@@ -698,23 +852,31 @@ void Game::Run() {
   fplbase::RegisterVsyncCallback(HandleVsync);
 #else
   // We don't need this on android because we'll just get vsync events directly.
+  SDL_DisplayMode display_mode;
+  const int refresh_rate =
+      SDL_GetCurrentDisplayMode(0, &display_mode) == 0
+          ? display_mode.refresh_rate
+          : 0;
+  frame_pacer_.Initialize(refresh_rate);
   SDL_Thread *vsync_simulator_thread = SDL_CreateThread(
-      VsyncSimulatorThread, "Zooshi Simulated Vsync Thread", nullptr);
+      VsyncSimulatorThread, "Zooshi Simulated Vsync Thread", &frame_pacer_);
   if (!vsync_simulator_thread) {
     LogError("Error creating vsync simulator thread.");
     assert(false);
   }
 #endif  // __ANDROID__
   int last_frame_id = 0;
+  unsigned int last_vsync_count = 0;
 
-  // We basically own the lock all the time, except when we're waiting
-  // for a vsync event.
-  SDL_LockMutex(sync_.renderthread_mutex_);
   while (!game_exiting_) {
+    // The lock is only held while looking at the vsync count, so that
+    // HandleVsync() never has to wait for a frame to finish.
+    SDL_LockMutex(sync_.renderthread_mutex_);
 #ifdef __ANDROID__
     int current_frame_id = fplbase::GetVsyncFrameId();
 #else
-    int current_frame_id = 0;
+    // Count simulated vsyncs in place of the frame id.
+    int current_frame_id = static_cast<int>(sync_.vsync_count_);
 #endif  // __ANDROID__
     // Update our framerate history:
     // The oldest value falls off and is replaced with the most recent frame.
@@ -739,55 +901,93 @@ void Game::Run() {
     // Wait for start of frame.  (triggered at vsync start on android.)
     // For performance, we only wait if we're not dropping frames.  Otherwise,
     // we just keep rendering as fast as we can and stuff the render queue.
-    if (total_dropped_frames <= kMaxDroppedFrames) {
-      SDL_CondWait(sync_.start_render_cv_, sync_.renderthread_mutex_);
+    // A vsync that came while the last frame was still rendering counts
+    // too, so that it isn't missed and the frame skipped.
+    const bool queue_stuffing = total_dropped_frames > kMaxDroppedFrames;
+    if (!queue_stuffing) {
+      while (sync_.vsync_count_ == last_vsync_count) {
+        SDL_CondWait(sync_.start_render_cv_, sync_.renderthread_mutex_);
+      }
     }
+    last_vsync_count = sync_.vsync_count_;
+    SDL_UnlockMutex(sync_.renderthread_mutex_);
+#ifndef __ANDROID__
+    frame_pacer_.FrameStarted();
+#endif  // __ANDROID__
 
     // Grab the lock to make sure the game isn't still updating.
     SDL_LockMutex(sync_.gameupdate_mutex_);
 
-    SystraceBegin("RenderFrame");
+    TraceBegin("RenderFrame");
 
     // Input update must happen from the render thread.
     // From the SDL documentation on SDL_PollEvent(),
     // https://wiki.libsdl.org/SDL_PollEvent):
     // "As this function implicitly calls SDL_PumpEvents(), you can only call
     // this function in the thread that set the video mode."
-    SystraceBegin("Input::AdvanceFrame()");
+    TraceBegin("Input::AdvanceFrame()");
     input_.AdvanceFrame(&renderer_.window_size());
     game_exiting_ |= input_.exit_requested();
-    SystraceEnd();
+    TraceEnd();
 
     // Milliseconds elapsed since last update.
     rt_data.frame_start = CurrentWorldTimeSubFrame(input_);
 
+    // River meshes are generated on their own threads, but have to be
+    // uploaded here, since that needs the GL context and modifies entity data.
+    // Uploading deletes the old meshes, so prepare a new snapshot that doesn't
+    // refer to them.
+    if (world_.river_component.UpdateRiverMeshes()) {
+      state_machine_.RenderPrep();
+    }
+
+    state_machine_.LatchRenderState();
+    const bool render_concurrently =
+        state_machine_.RendersConcurrently() && !world_.draw_debug_physics;
+    if (render_concurrently) {
+      // Everything we draw comes from the snapshot, so the update thread can
+      // start on the next frame right away.
+      SDL_UnlockMutex(sync_.gameupdate_mutex_);
+      SDL_CondBroadcast(sync_.start_update_cv_);
+    }
+
     // -------------------------------------------
     // Step 3.
     // Render everything.
     // -------------------------------------------
-    SystraceBegin("StateMachine::Render()");
+    frame_profiler_.RenderStarted();
+    TraceBegin("StateMachine::Render()");
 
-    PushDebugMarker("Setup");
+    TracePushMarker("Setup");
     fplbase::RenderTarget::ScreenRenderTarget(renderer_).SetAsRenderTarget();
     renderer_.ClearDepthBuffer();
     renderer_.SetCulling(fplbase::kCullingModeBack);
-    PopDebugMarker();
+    TracePopMarker();
 
     state_machine_.Render(&renderer_);
-    SystraceEnd();
+    TraceEnd();
 
-    SDL_UnlockMutex(sync_.gameupdate_mutex_);
+    if (!render_concurrently) {
+      SDL_UnlockMutex(sync_.gameupdate_mutex_);
+    }
 
-    SystraceBegin("StateMachine::HandleUI()");
+    TraceBegin("StateMachine::HandleUI()");
+    // The UI feeds back into the game, through things like the onscreen
+    // controller and the pause menu, so it can't run alongside an update.
+    if (render_concurrently) SDL_LockMutex(sync_.gameupdate_mutex_);
     state_machine_.HandleUI(&renderer_);
-    SystraceEnd();
+    if (render_concurrently) SDL_UnlockMutex(sync_.gameupdate_mutex_);
+    if (show_frame_stats_) RenderFrameStats();
+    TraceEnd();
 
     // -------------------------------------------
     // Step 4.
     // Signal the update thread that it is safe to start messing with
     // data, now that we've already handed it all off to openGL.
     // -------------------------------------------
-    SDL_CondBroadcast(sync_.start_update_cv_);
+    if (!render_concurrently) {
+      SDL_CondBroadcast(sync_.start_update_cv_);
+    }
 
     // -------------------------------------------
     // Step 5a.
@@ -796,11 +996,24 @@ void Game::Run() {
     // but that's ok because the update thread is humming in the background
     // preparing the world state for next frame.
     // -------------------------------------------
-    SystraceBegin("AdvanceFrame");
+    TraceBegin("AdvanceFrame");
+#ifndef __ANDROID__
+    frame_pacer_.PresentStarted();
+#endif  // __ANDROID__
     renderer_.AdvanceFrame(input_.minimized(), input_.Time());
-    SystraceEnd();  // AdvanceFrame
+#ifdef __ANDROID__
+    // As above, the frame dropped if more than one vsync passed while we
+    // rendered it.
+    const int presented_frame_id = fplbase::GetVsyncFrameId();
+    const bool dropped_frame = presented_frame_id != current_frame_id + 1 &&
+                               presented_frame_id != current_frame_id;
+#else
+    const bool dropped_frame = frame_pacer_.FramePresented();
+#endif  // __ANDROID__
+    frame_profiler_.FrameFinished(dropped_frame, queue_stuffing);
+    TraceEnd();  // AdvanceFrame
 
-    SystraceEnd();  // RenderFrame
+    TraceEnd();  // RenderFrame
 
     gpg_manager_.Update();
 
@@ -809,6 +1022,9 @@ void Game::Run() {
     if (input_.GetButton(fplbase::FPLK_BACKQUOTE).went_down()) {
       ToggleRelativeMouseMode();
     }
+    if (input_.GetButton(fplbase::FPLK_F6).went_down()) {
+      show_frame_stats_ = !show_frame_stats_;
+    }
 
     int new_time = CurrentWorldTimeSubFrame(input_);
     int frame_time = new_time - rt_data.frame_start;
@@ -816,14 +1032,105 @@ void Game::Run() {
     UpdateProfiling(frame_time);
 #endif  // DISPLAY_FRAMERATE_HISTOGRAM
 
-    SystraceCounter("FrameTime", frame_time);
+    TraceCounter("FrameTime", frame_time);
   }
-  SDL_UnlockMutex(sync_.renderthread_mutex_);
 // Clean up asynchronous callbacks to prevent crashing on garbage data.
 #ifdef __ANDROID__
   fplbase::RegisterVsyncCallback(nullptr);
+#else
+  frame_pacer_.Stop();
+  SDL_WaitThread(vsync_simulator_thread, nullptr);
+  const FramePacingStats &pacing = frame_pacer_.stats();
+  LogInfo("Frame pacing: %.2f ms refresh, %.2f ms mean error, %.2f ms max "
+          "error over %d frames",
+          pacing.refresh_period, pacing.mean_error, pacing.max_error,
+          pacing.frame_count);
 #endif  // __ANDROID__
+  AllocationLogStats();
   input_.AddAppEventCallback(nullptr);
+
+  if (TraceEnabled()) {
+    TraceStop();
+    TraceWriteFile(trace_file_name_.c_str());
+  }
+}
+
+// Step the world at a fixed rate, as fast as possible, with nothing else
+// competing for the CPU. Only the entity update is timed; the audio engine is
+// advanced outside the timed region so that finished channels get recycled.
+void Game::RunHeadless(int frame_count, corgi::WorldTime step_time,
+                       StressScene* stress_scene) {
+  typedef std::chrono::high_resolution_clock Clock;
+
+  if (stress_scene != nullptr) {
+    stress_scene->Load(&world_, GetConfig().world_def());
+  } else {
+    LoadWorldDef(&world_, GetConfig().world_def());
+  }
+  world_.player_component.set_state(kPlayerState_Active);
+  AllocationTrackerReset();
+
+  double total_ms = 0.0;
+  double min_ms = std::numeric_limits<double>::max();
+  double max_ms = 0.0;
+  for (int frame = 0; frame < frame_count; ++frame) {
+    if (stress_scene) stress_scene->LaunchProjectiles(&world_);
+
+    const Clock::time_point start = Clock::now();
+    world_.player_component.HandleInput();
+    world_.UpdateComponents(step_time);
+    const Clock::time_point end = Clock::now();
+
+    audio_engine_.AdvanceFrame(step_time / 1000.0f);
+    AllocationFrameEnd();
+
+    const double frame_ms =
+        std::chrono::duration<double, std::milli>(end - start).count();
+    total_ms += frame_ms;
+    min_ms = std::min(min_ms, frame_ms);
+    max_ms = std::max(max_ms, frame_ms);
+    LogInfo("frame %d: %.3f ms", frame, frame_ms);
+  }
+
+  if (frame_count <= 0) return;
+  LogInfo("---------------------------------");
+  LogInfo("frames: %d at %d ms per step", frame_count, step_time);
+  LogInfo("min: %.3f ms  mean: %.3f ms  max: %.3f ms", min_ms,
+          total_ms / frame_count, max_ms);
+  LogInfo("simulated %.2f s in %.2f s", frame_count * step_time / 1000.0,
+          total_ms / 1000.0);
+  LogInfo("---------------------------------");
+  world_.component_profiler.LogStats();
+  AllocationLogStats();
+}
+
+void Game::RenderFrameStats() {
+  FrameTimingStats stats;
+  if (!frame_profiler_.GetStats(&stats)) return;
+
+  char frame_times[64];
+  char dropped[64];
+  char overlap[64];
+  snprintf(frame_times, sizeof(frame_times),
+           "frame p50 %.1f  p95 %.1f  p99 %.1f ms", stats.p50, stats.p95,
+           stats.p99);
+  snprintf(dropped, sizeof(dropped), "dropped %d/%d  stuffing %.1f s",
+           stats.dropped_frames, stats.sample_count,
+           stats.queue_stuffing_time / 1000.0f);
+  snprintf(overlap, sizeof(overlap), "render/update overlap %.1f ms",
+           stats.mean_overlap);
+
+  flatui::Run(asset_manager_, font_manager_, input_, [&]() {
+    flatui::StartGroup(flatui::kLayoutVerticalLeft, 0);
+    flatui::PositionGroup(flatui::kAlignLeft, flatui::kAlignTop,
+                          vec2(kFrameStatsMargin, kFrameStatsMargin));
+    flatui::SetTextColor(kFrameStatsTextColor);
+    flatui::SetTextFont(GetConfig().menu_font()->c_str());
+    flatui::Label(frame_times, kFrameStatsTextSize);
+    flatui::Label(dropped, kFrameStatsTextSize);
+    flatui::Label(overlap, kFrameStatsTextSize);
+    flatui::EndGroup();
+  });
 }
 
 #if DISPLAY_FRAMERATE_HISTOGRAM
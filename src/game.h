@@ -25,6 +25,8 @@
 #include "corgi/entity_manager.h"
 #include "flatbuffers/flatbuffers.h"
 #include "flatui/font_manager.h"
+#include "frame_pacer.h"
+#include "frame_profiler.h"
 #include "fplbase/asset_manager.h"
 #include "fplbase/input.h"
 #include "fplbase/renderer.h"
@@ -44,6 +46,8 @@
 #include "xp_system.h"
 
 #define DISPLAY_FRAMERATE_HISTOGRAM 0
+#define DISPLAY_COMPONENT_TIMINGS 0
+#define DISPLAY_FRAME_STATS 0
 
 #ifdef __ANDROID__
 #define FPLBASE_ENABLE_SYSTRACE 0
@@ -78,6 +82,7 @@ const auto kLowRamDeviceTextureScale = mathfu::vec2(0.5f, 0.5f);
 struct Config;
 struct InputConfig;
 struct AssetManifest;
+class StressScene;
 
 // Mutexes/CVs used in synchronizing the render and update threads
 struct GameSynchronization {
@@ -86,6 +91,10 @@ struct GameSynchronization {
   SDL_mutex* gameupdate_mutex_;
   SDL_cond* start_render_cv_;
   SDL_cond* start_update_cv_;
+  // Number of vsyncs signaled so far. Guarded by `renderthread_mutex_`, so
+  // the render thread can tell whether one happened before it started
+  // waiting. Wraps.
+  unsigned int vsync_count_;
   GameSynchronization();
 };
 
@@ -95,11 +104,34 @@ class Game {
   bool Initialize(const char* const binary_directory);
   void Run();
 
+  // Initialize only what is needed to simulate the world: no window, no GL
+  // context, and a dummy audio device. Used by the headless runner to
+  // benchmark gameplay code in isolation from rendering.
+  bool InitializeHeadless(const char* const binary_directory);
+
+  // Load the world and step it `frame_count` times at a fixed `step_time`,
+  // logging how long each step took. Call after InitializeHeadless(). If
+  // `stress_scene` isn't null, it is loaded instead of the current level.
+  void RunHeadless(int frame_count, corgi::WorldTime step_time,
+                   StressScene* stress_scene);
+
   // Set the overlay directory name to optionally load assets from.
   static void SetOverlayName(const char* overlay_name) {
     overlay_name_ = overlay_name;
   }
 
+  // Record trace markers while the game runs, and write them to this file as
+  // Chrome trace JSON on exit. Empty, the default, disables tracing.
+  static void SetTraceFileName(const char* trace_file_name) {
+    trace_file_name_ = trace_file_name;
+  }
+
+  // Summarize how frames have been delivered recently. Returns false if no
+  // frames have been rendered yet. Call from the render thread.
+  bool GetFrameStats(FrameTimingStats* stats) const {
+    return frame_profiler_.GetStats(stats);
+  }
+
 #if defined(__ANDROID__)
   // Parse launch mode and overlay directory name from Intent data.
   static void ParseViewIntentData(const std::string& intent_data,
@@ -110,6 +142,7 @@ class Game {
  private:
   bool InitializeRenderer();
   bool InitializeAssets();
+  bool InitializeAnimations();
   void InitializeBreadboardModules();
 
   void Update(corgi::WorldTime delta_time);
@@ -127,6 +160,9 @@ class Game {
 
   void UpdateProfiling(corgi::WorldTime frame_time);
 
+  // Draw the frame stats over the game.
+  void RenderFrameStats();
+
   // Overrides fplbase::LoadFile() in order to optionally load files from
   // overlay directories.
   static bool LoadFile(const char* filename, std::string* dest);
@@ -134,6 +170,17 @@ class Game {
   // Mutexes/CVs used in synchronizing the render and update threads:
   GameSynchronization sync_;
 
+#ifndef __ANDROID__
+  // Predicts vsyncs for the simulated vsync thread.
+  FramePacer frame_pacer_;
+#endif  // __ANDROID__
+
+  // Frame delivery telemetry.
+  FrameProfiler frame_profiler_;
+
+  // Whether to draw the frame stats overlay. Toggled with F6.
+  bool show_frame_stats_;
+
   // Hold configuration binary data.
   std::string config_source_;
 
@@ -206,6 +253,9 @@ class Game {
   // Name of the optional overlay to load assets from.
   static std::string overlay_name_;
 
+  // Name of the optional file to write a trace to.
+  static std::string trace_file_name_;
+
   // The progression system to track unlockables.
   UnlockableManager unlockable_manager_;
 
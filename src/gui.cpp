@@ -18,10 +18,10 @@
 
 #include "mathfu/internal/disable_warnings_end.h"
 
-#include "fplbase/debug_markers.h"
 #include "fplbase/utilities.h"
 #include "states/game_menu_state.h"
 #include "states/states_common.h"
+#include "trace.h"
 
 #include <iostream>
 
@@ -105,7 +105,7 @@ MenuState GameMenuState::StartMenu(fplbase::AssetManager& assetman,
                                    fplbase::InputSystem& input) {
   MenuState next_state = kMenuStateStart;
 
-  PushDebugMarker("StartMenu");
+  TracePushMarker("StartMenu");
 
   // Run() accepts a lambda function that is executed 2 times,
   // one for a layout pass and another one in a render pass.
@@ -205,7 +205,7 @@ MenuState GameMenuState::StartMenu(fplbase::AssetManager& assetman,
     flatui::EndGroup();
   });
 
-  PopDebugMarker(); // StartMenu
+  TracePopMarker(); // StartMenu
 
   return next_state;
 }
@@ -215,7 +215,7 @@ MenuState GameMenuState::OptionMenu(fplbase::AssetManager& assetman,
                                     fplbase::InputSystem& input) {
   MenuState next_state = kMenuStateOptions;
 
-  PushDebugMarker("OptionMenu");
+  TracePushMarker("OptionMenu");
 
   // FlatUI UI definitions.
   flatui::Run(assetman, fontman, input, [&]() {
@@ -296,7 +296,7 @@ MenuState GameMenuState::OptionMenu(fplbase::AssetManager& assetman,
     flatui::EndGroup();  // Overlay group.
   });
 
-  PopDebugMarker(); // OptionMenu
+  TracePopMarker(); // OptionMenu
 
   return next_state;
 }
@@ -710,7 +710,7 @@ MenuState GameMenuState::ScoreReviewMenu(fplbase::AssetManager& assetman,
                                          fplbase::InputSystem& input) {
   MenuState next_state = kMenuStateScoreReview;
 
-  PushDebugMarker("ScoreReviewMenu");
+  TracePushMarker("ScoreReviewMenu");
 
   EmptyMenuBackground(assetman, fontman, input, [&]() {
     // Display the game end values, along with the score.
@@ -775,7 +775,7 @@ MenuState GameMenuState::ScoreReviewMenu(fplbase::AssetManager& assetman,
     flatui::EndGroup();
   });
 
-  PopDebugMarker();  // ScoreReviewMenu
+  TracePopMarker();  // ScoreReviewMenu
 
   return next_state;
 }
@@ -0,0 +1,707 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Entry point for zooshi_headless, which steps the gameplay simulation at a
+// fixed timestep without a window or GL context and logs the cost of each
+// frame.
+//
+// Usage: zooshi_headless [frame_count] [step_ms] [overlay]
+//        zooshi_headless stress [scale] [frame_count] [step_ms] [kind=count]...
+//        zooshi_headless intercept_benchmark [iterations]
+//        zooshi_headless rail_benchmark [iterations]
+//        zooshi_headless rail_denizen_benchmark [iterations]
+//        zooshi_headless worker_pool_benchmark [iterations]
+//        zooshi_headless bake_rail source_file baked_file
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fplbase/utilities.h"
+#include "game.h"
+#include "intercept_kernel.h"
+#include "rail_denizen_kernel.h"
+#include "railmanager.h"
+#include "stress_scene.h"
+#include "worker_pool.h"
+
+static const int kDefaultFrameCount = 1000;
+static const int kDefaultStepTime = 1000 / 60;
+static const int kDefaultStressScale = 1;
+
+// The intercept benchmark filters this many projectiles for each of a set of
+// targets, in a world about the size of a level.
+static const int kDefaultBenchmarkIterations = 200;
+static const int kBenchmarkProjectiles = 1024;
+static const int kBenchmarkTargets = 64;
+static const float kBenchmarkWorldSize = 200.0f;
+static const float kBenchmarkMaxSpeed = 30.0f;
+static const float kBenchmarkMaxDistance = 10.0f;
+
+// The rail benchmark finds the closest point on a wobbly loop of rail, about
+// the size of the stress scene's, to this many points for each iteration.
+// Half are near the rail, as patrons and scenery are; the rest are anywhere
+// around it. The brute force search tests the segments between this many of
+// the rail's Positions(), and the results may differ by the tolerance.
+static const int kDefaultRailBenchmarkIterations = 20;
+static const int kRailBenchmarkPoints = 1024;
+static const int kRailBenchmarkNodes = 64;
+static const int kRailBenchmarkSamples = 1024;
+static const float kRailBenchmarkRadius = 80.0f;
+static const float kRailBenchmarkWobble = 0.15f;
+static const float kRailBenchmarkLobes = 3.0f;
+static const float kRailBenchmarkLapTime = 60000.0f;
+static const float kRailBenchmarkSplineGranularity = 10.0f;
+static const float kRailBenchmarkReliableDistance = 1.0f;
+static const float kRailBenchmarkNearDistance = 20.0f;
+static const float kRailBenchmarkFarDistance = 50.0f;
+static const float kRailBenchmarkReach = 10.0f;
+static const float kRailBenchmarkTolerance = 0.05f;
+static const float kRailBenchmarkTimeSlack = 1.0f;
+
+// The rail denizen benchmark transforms this many denizens, with random
+// positions, directions and rail transforms, for each iteration.
+static const int kDefaultRailDenizenBenchmarkIterations = 1000;
+static const int kRailDenizenBenchmarkDenizens = 1024;
+static const float kRailDenizenBenchmarkPositionTolerance = 1e-3f;
+static const float kRailDenizenBenchmarkOrientationTolerance = 1e-5f;
+
+// The worker pool benchmark runs batches of this many tasks, each summing its
+// own slice of values, about as much work as a component update. Every so
+// many batches it also posts a background job, as river mesh builds are.
+static const int kDefaultWorkerPoolBenchmarkIterations = 2000;
+static const int kWorkerPoolBenchmarkTasks = 8;
+static const int kWorkerPoolBenchmarkTaskSize = 4096;
+static const int kWorkerPoolBenchmarkJobInterval = 50;
+
+typedef std::chrono::steady_clock BenchmarkClock;
+
+// Time FilterIntercepts() against FilterInterceptsScalar() on random
+// projectiles, and check they keep the same ones.
+static int RunInterceptBenchmark(int iterations) {
+  using fpl::zooshi::InterceptProjectiles;
+  using fpl::zooshi::InterceptTarget;
+
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> position(-kBenchmarkWorldSize,
+                                                 kBenchmarkWorldSize);
+  std::uniform_real_distribution<float> speed(-kBenchmarkMaxSpeed,
+                                              kBenchmarkMaxSpeed);
+  std::vector<float> x(kBenchmarkProjectiles);
+  std::vector<float> y(kBenchmarkProjectiles);
+  std::vector<float> velocity_x(kBenchmarkProjectiles);
+  std::vector<float> velocity_y(kBenchmarkProjectiles);
+  std::vector<int> indices(kBenchmarkProjectiles);
+  for (int i = 0; i < kBenchmarkProjectiles; ++i) {
+    x[i] = position(random);
+    y[i] = position(random);
+    velocity_x[i] = speed(random);
+    velocity_y[i] = speed(random);
+    indices[i] = i;
+  }
+  InterceptProjectiles projectiles;
+  projectiles.x = x.data();
+  projectiles.y = y.data();
+  projectiles.velocity_x = velocity_x.data();
+  projectiles.velocity_y = velocity_y.data();
+
+  std::vector<InterceptTarget> targets(kBenchmarkTargets);
+  for (int i = 0; i < kBenchmarkTargets; ++i) {
+    InterceptTarget& target = targets[i];
+    target.x = position(random);
+    target.y = position(random);
+    target.max_distance_sq = kBenchmarkMaxDistance * kBenchmarkMaxDistance;
+    target.limit_return = i % 2 == 1;
+    target.return_x = target.x + speed(random) * 0.1f;
+    target.return_y = target.y + speed(random) * 0.1f;
+  }
+
+  std::vector<int> scalar_survivors(kBenchmarkProjectiles);
+  std::vector<int> survivors(kBenchmarkProjectiles);
+  BenchmarkClock::duration scalar_time(0);
+  BenchmarkClock::duration kernel_time(0);
+  long long survivor_count = 0;
+  int mismatches = 0;
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    for (int i = 0; i < kBenchmarkTargets; ++i) {
+      const BenchmarkClock::time_point start = BenchmarkClock::now();
+      const int scalar_count = fpl::zooshi::FilterInterceptsScalar(
+          projectiles, indices.data(), kBenchmarkProjectiles, targets[i],
+          scalar_survivors.data());
+      const BenchmarkClock::time_point middle = BenchmarkClock::now();
+      const int count = fpl::zooshi::FilterIntercepts(
+          projectiles, indices.data(), kBenchmarkProjectiles, targets[i],
+          survivors.data());
+      const BenchmarkClock::time_point end = BenchmarkClock::now();
+      scalar_time += middle - start;
+      kernel_time += end - middle;
+      survivor_count += count;
+
+      if (count != scalar_count ||
+          memcmp(survivors.data(), scalar_survivors.data(),
+                 count * sizeof(survivors[0])) != 0) {
+        mismatches++;
+      }
+    }
+  }
+
+  const double tests = static_cast<double>(iterations) * kBenchmarkTargets *
+                       kBenchmarkProjectiles;
+  const double scalar_ns =
+      std::chrono::duration<double, std::nano>(scalar_time).count();
+  const double kernel_ns =
+      std::chrono::duration<double, std::nano>(kernel_time).count();
+  fplbase::LogInfo(
+      "Intercept filter: %.2f ns/projectile scalar, %.2f ns/projectile "
+      "batched (%.1fx), %.1f%% kept, %d of %d filters differ",
+      scalar_ns / tests, kernel_ns / tests, scalar_ns / kernel_ns,
+      100.0 * survivor_count / tests, mismatches,
+      iterations * kBenchmarkTargets);
+  return mismatches == 0 ? 0 : 1;
+}
+
+// Distance from `point` to the closest of the segments joining `positions`,
+// squared.
+static float BruteForceClosestDistanceSq(
+    const std::vector<mathfu::vec3_packed>& positions,
+    const mathfu::vec3& point) {
+  using mathfu::vec3;
+  float best_distance_sq = std::numeric_limits<float>::infinity();
+  for (size_t i = 0; i + 1 < positions.size(); ++i) {
+    const vec3 a(positions[i]);
+    const vec3 ab = vec3(positions[i + 1]) - a;
+    const float length_sq = ab.LengthSquared();
+    const float fraction =
+        length_sq > 0.0f
+            ? mathfu::Clamp(vec3::DotProduct(point - a, ab) / length_sq, 0.0f,
+                            1.0f)
+            : 0.0f;
+    best_distance_sq =
+        std::min(best_distance_sq, (a + fraction * ab - point).LengthSquared());
+  }
+  return best_distance_sq;
+}
+
+// Set `times` to the spans between the first and last of each run of
+// `positions`, spaced `step` apart, that lie within `radius` of `point`.
+static void BruteForceTimesWithin(
+    const std::vector<mathfu::vec3_packed>& positions, float step,
+    const mathfu::vec3& point, float radius,
+    std::vector<motive::Range>* times) {
+  times->clear();
+  const float radius_sq = radius * radius;
+  int run_begin = -1;
+  for (int i = 0; i <= static_cast<int>(positions.size()); ++i) {
+    const bool within =
+        i < static_cast<int>(positions.size()) &&
+        (mathfu::vec3(positions[i]) - point).LengthSquared() <= radius_sq;
+    if (within && run_begin < 0) {
+      run_begin = i;
+    } else if (!within && run_begin >= 0) {
+      times->push_back(motive::Range(run_begin * step, (i - 1) * step));
+      run_begin = -1;
+    }
+  }
+}
+
+// Time Rail::ClosestTime() and Rail::TimesWithin() against searching every
+// one of the rail's Positions(). Check that they find points equally close,
+// and that the spans found cover every position in reach.
+static int RunRailBenchmark(int iterations) {
+  using mathfu::vec3;
+
+  std::vector<mathfu::vec3_packed> nodes(kRailBenchmarkNodes + 1);
+  for (int i = 0; i < kRailBenchmarkNodes; ++i) {
+    const float angle = 2.0f * static_cast<float>(M_PI) * i /
+                        static_cast<float>(kRailBenchmarkNodes);
+    const float radius =
+        kRailBenchmarkRadius *
+        (1.0f + kRailBenchmarkWobble * std::sin(kRailBenchmarkLobes * angle));
+    nodes[i] = vec3(radius * std::cos(angle), radius * std::sin(angle), 0.0f);
+  }
+  nodes[kRailBenchmarkNodes] = nodes[0];
+  fpl::zooshi::Rail rail;
+  rail.InitializeFromPositions(nodes, kRailBenchmarkSplineGranularity,
+                               kRailBenchmarkReliableDistance,
+                               kRailBenchmarkLapTime, true);
+
+  const float step = rail.EndTime() / kRailBenchmarkSamples;
+  std::vector<mathfu::vec3_packed> positions;
+  rail.Positions(step, &positions);
+
+  std::mt19937 random(1);
+  std::uniform_int_distribution<size_t> sample(0, positions.size() - 1);
+  std::uniform_real_distribution<float> near(-kRailBenchmarkNearDistance,
+                                             kRailBenchmarkNearDistance);
+  const float extent =
+      kRailBenchmarkRadius * (1.0f + kRailBenchmarkWobble) +
+      kRailBenchmarkFarDistance;
+  std::uniform_real_distribution<float> anywhere(-extent, extent);
+  std::vector<vec3> points(kRailBenchmarkPoints);
+  for (int i = 0; i < kRailBenchmarkPoints; ++i) {
+    points[i] = i % 2 == 0
+                    ? vec3(positions[sample(random)]) +
+                          vec3(near(random), near(random), near(random))
+                    : vec3(anywhere(random), anywhere(random), 0.0f);
+  }
+
+  BenchmarkClock::duration closest_brute_force_time(0);
+  BenchmarkClock::duration closest_query_time(0);
+  float max_difference = 0.0f;
+  int closest_mismatches = 0;
+  BenchmarkClock::duration within_brute_force_time(0);
+  BenchmarkClock::duration within_query_time(0);
+  std::vector<motive::Range> brute_force_times;
+  std::vector<motive::Range> query_times;
+  int spans = 0;
+  int within_mismatches = 0;
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    for (int i = 0; i < kRailBenchmarkPoints; ++i) {
+      BenchmarkClock::time_point start = BenchmarkClock::now();
+      const float brute_force_sq =
+          BruteForceClosestDistanceSq(positions, points[i]);
+      BenchmarkClock::time_point middle = BenchmarkClock::now();
+      float query_sq;
+      const float time = rail.ClosestTime(points[i], &query_sq);
+      BenchmarkClock::time_point end = BenchmarkClock::now();
+      closest_brute_force_time += middle - start;
+      closest_query_time += end - middle;
+
+      // The time returned must be consistent with the distance, too.
+      const float difference = std::max(
+          std::fabs(std::sqrt(query_sq) - std::sqrt(brute_force_sq)),
+          std::fabs((rail.PositionAtTime(time) - points[i]).Length() -
+                    std::sqrt(query_sq)));
+      max_difference = std::max(max_difference, difference);
+      if (difference > kRailBenchmarkTolerance) closest_mismatches++;
+
+      // Positions a hair inside the reach must be found, even though the
+      // query treats the rail as straight between its own samples.
+      start = BenchmarkClock::now();
+      BruteForceTimesWithin(positions, step, points[i],
+                            kRailBenchmarkReach - kRailBenchmarkTolerance,
+                            &brute_force_times);
+      middle = BenchmarkClock::now();
+      rail.TimesWithin(points[i], kRailBenchmarkReach, &query_times);
+      end = BenchmarkClock::now();
+      within_brute_force_time += middle - start;
+      within_query_time += end - middle;
+      spans += static_cast<int>(query_times.size());
+
+      bool covered = true;
+      for (auto expected = brute_force_times.begin();
+           expected != brute_force_times.end(); ++expected) {
+        bool found = false;
+        for (auto found_time = query_times.begin();
+             found_time != query_times.end(); ++found_time) {
+          found = found ||
+                  (found_time->start() - kRailBenchmarkTimeSlack <=
+                       expected->start() &&
+                   expected->end() <=
+                       found_time->end() + kRailBenchmarkTimeSlack);
+        }
+        covered = covered && found;
+      }
+      if (!covered) within_mismatches++;
+    }
+  }
+
+  const double queries =
+      static_cast<double>(iterations) * kRailBenchmarkPoints;
+  double brute_force_ns =
+      std::chrono::duration<double, std::nano>(closest_brute_force_time)
+          .count();
+  double query_ns =
+      std::chrono::duration<double, std::nano>(closest_query_time).count();
+  fplbase::LogInfo(
+      "Closest point on rail: %.1f ns/query brute force over %d positions, "
+      "%.1f ns/query with the segment tree (%.1fx), largest difference "
+      "%.3f, %d of %d queries differ",
+      brute_force_ns / queries, static_cast<int>(positions.size()),
+      query_ns / queries, brute_force_ns / query_ns, max_difference,
+      closest_mismatches, iterations * kRailBenchmarkPoints);
+
+  brute_force_ns =
+      std::chrono::duration<double, std::nano>(within_brute_force_time)
+          .count();
+  query_ns =
+      std::chrono::duration<double, std::nano>(within_query_time).count();
+  fplbase::LogInfo(
+      "Rail within reach: %.1f ns/query brute force over %d positions, "
+      "%.1f ns/query with the segment tree (%.1fx), %.2f spans/query, "
+      "%d of %d queries missed positions",
+      brute_force_ns / queries, static_cast<int>(positions.size()),
+      query_ns / queries, brute_force_ns / query_ns, spans / queries,
+      within_mismatches, iterations * kRailBenchmarkPoints);
+  return closest_mismatches == 0 && within_mismatches == 0 ? 0 : 1;
+}
+
+// Time ComputeRailDenizenTransforms() against transforming the denizens one
+// at a time with mathfu, as RailDenizenComponent used to, and check they give
+// the same positions and rotations.
+static int RunRailDenizenBenchmark(int iterations) {
+  using mathfu::quat;
+  using mathfu::vec3;
+  using fpl::zooshi::RailDenizenInputs;
+  using fpl::zooshi::RailDenizenTransforms;
+
+  // Positions, directions and rail transforms, followed by the results of
+  // the kernel, one array per coordinate.
+  static const int kInputArrays = 16;
+  static const int kOutputArrays = 7;
+  const int count = kRailDenizenBenchmarkDenizens;
+  std::vector<float> arrays((kInputArrays + kOutputArrays) * count);
+  float* array[kInputArrays + kOutputArrays];
+  for (int i = 0; i < kInputArrays + kOutputArrays; ++i) {
+    array[i] = arrays.data() + i * count;
+  }
+  std::vector<vec3> positions(count);
+  std::vector<vec3> directions(count);
+  std::vector<quat> orientations(count);
+  std::vector<vec3> scales(count);
+  std::vector<vec3> offsets(count);
+
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> position(-kBenchmarkWorldSize,
+                                                 kBenchmarkWorldSize);
+  for (int i = 0; i < count; ++i) {
+    positions[i] = vec3(position(random), position(random), position(random));
+    // Include the directions straight ahead and straight back that
+    // quat::RotateFromTo() treats specially.
+    directions[i] = i % 16 == 0 ? vec3(0.0f, 1.0f, unit(random))
+                                : i % 16 == 1
+                                      ? vec3(0.0f, -1.0f, unit(random))
+                                      : vec3(unit(random), unit(random),
+                                             unit(random));
+    orientations[i] = quat(unit(random), unit(random), unit(random),
+                           unit(random)).Normalized();
+    scales[i] = vec3(1.5f + unit(random), 1.5f + unit(random),
+                     1.5f + unit(random));
+    offsets[i] = vec3(position(random), position(random), position(random));
+    for (int axis = 0; axis < 3; ++axis) {
+      array[axis][i] = positions[i][axis];
+      array[3 + axis][i] = directions[i][axis];
+      array[7 + axis][i] = orientations[i].vector()[axis];
+      array[10 + axis][i] = scales[i][axis];
+      array[13 + axis][i] = offsets[i][axis];
+    }
+    array[6][i] = orientations[i].scalar();
+  }
+  RailDenizenInputs inputs;
+  inputs.x = array[0];
+  inputs.y = array[1];
+  inputs.z = array[2];
+  inputs.direction_x = array[3];
+  inputs.direction_y = array[4];
+  inputs.direction_z = array[5];
+  inputs.orientation_s = array[6];
+  inputs.orientation_x = array[7];
+  inputs.orientation_y = array[8];
+  inputs.orientation_z = array[9];
+  inputs.scale_x = array[10];
+  inputs.scale_y = array[11];
+  inputs.scale_z = array[12];
+  inputs.offset_x = array[13];
+  inputs.offset_y = array[14];
+  inputs.offset_z = array[15];
+  RailDenizenTransforms transforms;
+  transforms.x = array[16];
+  transforms.y = array[17];
+  transforms.z = array[18];
+  transforms.orientation_s = array[19];
+  transforms.orientation_x = array[20];
+  transforms.orientation_y = array[21];
+  transforms.orientation_z = array[22];
+
+  std::vector<vec3> mathfu_positions(count);
+  std::vector<quat> mathfu_orientations(count);
+  BenchmarkClock::duration mathfu_time(0);
+  BenchmarkClock::duration kernel_time(0);
+  int mismatches = 0;
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    const BenchmarkClock::time_point start = BenchmarkClock::now();
+    for (int i = 0; i < count; ++i) {
+      mathfu_positions[i] =
+          orientations[i].Inverse() * positions[i] * scales[i] + offsets[i];
+      vec3 direction_xy = directions[i];
+      direction_xy.z = 0.0f;
+      const float z_angle = atan2f(directions[i].z, direction_xy.Length());
+      mathfu_orientations[i] =
+          orientations[i] *
+          quat::FromAngleAxis(z_angle, -mathfu::kAxisX3f) *
+          quat::RotateFromTo(direction_xy, mathfu::kAxisY3f);
+    }
+    const BenchmarkClock::time_point middle = BenchmarkClock::now();
+    fpl::zooshi::ComputeRailDenizenTransforms(inputs, count, transforms);
+    const BenchmarkClock::time_point end = BenchmarkClock::now();
+    mathfu_time += middle - start;
+    kernel_time += end - middle;
+
+    for (int i = 0; i < count; ++i) {
+      const vec3 world_position(transforms.x[i], transforms.y[i],
+                                transforms.z[i]);
+      const quat& expected = mathfu_orientations[i];
+      // A quaternion and its negation are the same rotation.
+      const float dot = std::fabs(
+          transforms.orientation_s[i] * expected.scalar() +
+          transforms.orientation_x[i] * expected.vector().x +
+          transforms.orientation_y[i] * expected.vector().y +
+          transforms.orientation_z[i] * expected.vector().z);
+      const float position_error =
+          (world_position - mathfu_positions[i]).Length();
+      if (position_error > kRailDenizenBenchmarkPositionTolerance ||
+          !(dot >= 1.0f - kRailDenizenBenchmarkOrientationTolerance)) {
+        mismatches++;
+      }
+    }
+  }
+
+  const double transforms_done = static_cast<double>(iterations) * count;
+  const double mathfu_ns =
+      std::chrono::duration<double, std::nano>(mathfu_time).count();
+  const double kernel_ns =
+      std::chrono::duration<double, std::nano>(kernel_time).count();
+  fplbase::LogInfo(
+      "Rail denizen transforms: %.2f ns/denizen one at a time, %.2f "
+      "ns/denizen batched (%.1fx), %d of %d transforms differ",
+      mathfu_ns / transforms_done, kernel_ns / transforms_done,
+      mathfu_ns / kernel_ns, mismatches, iterations * count);
+  return mismatches == 0 ? 0 : 1;
+}
+
+// Time batches of tasks on a WorkerPool with no threads against one with the
+// device's default thread count, while posting background jobs to both, and
+// check every task and job ran exactly once.
+static int RunWorkerPoolBenchmark(int iterations) {
+  using fpl::zooshi::WorkerPool;
+
+  std::vector<int> values(kWorkerPoolBenchmarkTasks *
+                          kWorkerPoolBenchmarkTaskSize);
+  std::mt19937 random(1);
+  std::uniform_int_distribution<int> value(0, 1000);
+  int64_t expected_sum = 0;
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = value(random);
+    expected_sum += values[i];
+  }
+  const int expected_jobs =
+      (iterations + kWorkerPoolBenchmarkJobInterval - 1) /
+      kWorkerPoolBenchmarkJobInterval;
+
+  const int thread_counts[] = {0, std::max(WorkerPool::DefaultThreadCount(),
+                                           1)};
+  double batch_ns[2];
+  int mismatches = 0;
+  for (int pool_index = 0; pool_index < 2; ++pool_index) {
+    std::atomic<int> jobs_done(0);
+    BenchmarkClock::duration batch_time(0);
+    {
+      WorkerPool pool(thread_counts[pool_index]);
+      std::vector<int64_t> sums(kWorkerPoolBenchmarkTasks);
+      const std::function<void(int)> task = [&values, &sums](int i) {
+        int64_t sum = 0;
+        const int* slice = &values[i * kWorkerPoolBenchmarkTaskSize];
+        for (int j = 0; j < kWorkerPoolBenchmarkTaskSize; ++j) sum += slice[j];
+        sums[i] = sum;
+      };
+      for (int iteration = 0; iteration < iterations; ++iteration) {
+        if (iteration % kWorkerPoolBenchmarkJobInterval == 0) {
+          pool.Post([&jobs_done]() { jobs_done++; });
+        }
+        const BenchmarkClock::time_point start = BenchmarkClock::now();
+        pool.ParallelFor(kWorkerPoolBenchmarkTasks, task);
+        batch_time += BenchmarkClock::now() - start;
+
+        int64_t sum = 0;
+        for (int i = 0; i < kWorkerPoolBenchmarkTasks; ++i) sum += sums[i];
+        if (sum != expected_sum) mismatches++;
+        std::fill(sums.begin(), sums.end(), 0);
+      }
+    }
+    // Destroying the pool runs any jobs still waiting for a worker.
+    if (jobs_done != expected_jobs) mismatches++;
+    batch_ns[pool_index] =
+        std::chrono::duration<double, std::nano>(batch_time).count() /
+        iterations;
+  }
+
+  fplbase::LogInfo(
+      "Worker pool: %.0f ns/batch on the caller alone, %.0f ns/batch with %d "
+      "threads (%.1fx), %d of %d checks failed",
+      batch_ns[0], batch_ns[1], thread_counts[1], batch_ns[0] / batch_ns[1],
+      mismatches, 2 * (iterations + 1));
+  return mismatches == 0 ? 0 : 1;
+}
+
+// Bake the rail described by `source_name`, as written by
+// scripts/build_assets.py, into `baked_name`. The source's first line holds
+// the rail's total time, reliable distance and whether it wraps, and each
+// line after that the position of one of its nodes, in order.
+static int BakeRail(const char* source_name, const char* baked_name) {
+  FILE* source = fopen(source_name, "r");
+  if (source == nullptr) {
+    fplbase::LogError("zooshi_headless: can't read %s", source_name);
+    return 1;
+  }
+  float total_time = 0.0f;
+  float reliable_distance = 0.0f;
+  int wraps = 0;
+  std::vector<mathfu::vec3_packed> positions;
+  bool ok = fscanf(source, "%f %f %d", &total_time, &reliable_distance,
+                   &wraps) == 3;
+  mathfu::vec3 position;
+  while (ok && fscanf(source, "%f %f %f", &position.x, &position.y,
+                      &position.z) == 3) {
+    positions.push_back(position);
+  }
+  ok = ok && feof(source) && positions.size() >= 2;
+  fclose(source);
+  if (!ok) {
+    fplbase::LogError("zooshi_headless: %s isn't a rail source", source_name);
+    return 1;
+  }
+
+  // Repeat the first node at the end so we loop, as RailManager does.
+  if (wraps != 0) positions.push_back(positions.front());
+  return fpl::zooshi::RailManager::BakeRail(positions, reliable_distance,
+                                            total_time, wraps != 0,
+                                            baked_name)
+             ? 0
+             : 1;
+}
+
+extern "C" int FPL_main(int argc, char* argv[]) {
+  if (argc > 1 && strcmp(argv[1], "intercept_benchmark") == 0) {
+    const int iterations =
+        argc > 2 ? atoi(argv[2]) : kDefaultBenchmarkIterations;
+    if (iterations <= 0) {
+      fplbase::LogError("zooshi_headless: iterations must be positive.");
+      return 1;
+    }
+    return RunInterceptBenchmark(iterations);
+  }
+  if (argc > 1 && strcmp(argv[1], "rail_benchmark") == 0) {
+    const int iterations =
+        argc > 2 ? atoi(argv[2]) : kDefaultRailBenchmarkIterations;
+    if (iterations <= 0) {
+      fplbase::LogError("zooshi_headless: iterations must be positive.");
+      return 1;
+    }
+    return RunRailBenchmark(iterations);
+  }
+  if (argc > 1 && strcmp(argv[1], "rail_denizen_benchmark") == 0) {
+    const int iterations =
+        argc > 2 ? atoi(argv[2]) : kDefaultRailDenizenBenchmarkIterations;
+    if (iterations <= 0) {
+      fplbase::LogError("zooshi_headless: iterations must be positive.");
+      return 1;
+    }
+    return RunRailDenizenBenchmark(iterations);
+  }
+  if (argc > 1 && strcmp(argv[1], "worker_pool_benchmark") == 0) {
+    const int iterations =
+        argc > 2 ? atoi(argv[2]) : kDefaultWorkerPoolBenchmarkIterations;
+    if (iterations <= 0) {
+      fplbase::LogError("zooshi_headless: iterations must be positive.");
+      return 1;
+    }
+    return RunWorkerPoolBenchmark(iterations);
+  }
+  if (argc > 1 && strcmp(argv[1], "bake_rail") == 0) {
+    if (argc != 4) {
+      fplbase::LogError(
+          "zooshi_headless: bake_rail needs a source and a baked file.");
+      return 1;
+    }
+    return BakeRail(argv[2], argv[3]);
+  }
+
+  // In stress mode, the scale comes before the frame count and step time. It
+  // sets the length of the rail, and how many of each kind of entity there
+  // are, unless a `kind=count` argument gives that kind's count instead.
+  const bool stress = argc > 1 && strcmp(argv[1], "stress") == 0;
+  std::vector<const char*> args(argv, argv + argc);
+  std::unique_ptr<fpl::zooshi::StressScene> stress_scene;
+  if (stress) {
+    const int stress_scale =
+        argc > 2 && strchr(argv[2], '=') == nullptr ? atoi(argv[2])
+                                                    : kDefaultStressScale;
+    if (stress_scale <= 0) {
+      fplbase::LogError("zooshi_headless: scale must be positive.");
+      return 1;
+    }
+    fpl::zooshi::StressSceneCounts counts =
+        fpl::zooshi::StressSceneCounts::ForScale(stress_scale);
+    args.clear();
+    args.push_back(argv[0]);
+    for (int i = 2; i < argc; ++i) {
+      const char* equals = strchr(argv[i], '=');
+      if (equals == nullptr) {
+        if (i > 2) args.push_back(argv[i]);
+        continue;
+      }
+      const std::string kind(argv[i], equals);
+      const int count = atoi(equals + 1);
+      int* counts_of_kind = nullptr;
+      if (kind == "patrons") {
+        counts_of_kind = &counts.patrons;
+      } else if (kind == "scenery") {
+        counts_of_kind = &counts.scenery;
+      } else if (kind == "rail_denizens") {
+        counts_of_kind = &counts.rail_denizens;
+      } else if (kind == "lap_dependent") {
+        counts_of_kind = &counts.lap_dependent;
+      } else if (kind == "projectiles") {
+        counts_of_kind = &counts.projectiles;
+      }
+      if (counts_of_kind == nullptr || count < 0) {
+        fplbase::LogError("zooshi_headless: bad stress count %s.", argv[i]);
+        return 1;
+      }
+      *counts_of_kind = count;
+    }
+    stress_scene.reset(new fpl::zooshi::StressScene(stress_scale, counts));
+  }
+  const int num_args = static_cast<int>(args.size());
+
+  fpl::zooshi::Game game;
+  const char* binary_directory = argc > 0 ? argv[0] : "";
+  const int frame_count = num_args > 1 ? atoi(args[1]) : kDefaultFrameCount;
+  const int step_time = num_args > 2 ? atoi(args[2]) : kDefaultStepTime;
+  fpl::zooshi::Game::SetOverlayName(!stress && num_args > 3 ? args[3] : "");
+
+  if (step_time <= 0) {
+    fplbase::LogError("zooshi_headless: step time must be positive.");
+    return 1;
+  }
+
+  if (!game.InitializeHeadless(binary_directory)) {
+    fplbase::LogError("zooshi_headless: init failed, exiting!");
+    return 1;
+  }
+
+  game.RunHeadless(frame_count, step_time, stress_scene.get());
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "headless_controller.h"
+#include "camera.h"
+#include "mathfu/glsl_mappings.h"
+
+using mathfu::vec3;
+using mathfu::quat;
+
+namespace fpl {
+namespace zooshi {
+
+// Number of updates it takes to sweep from one side to the other and back.
+static const int kSweepPeriod = 240;
+
+// Maximum angle, in radians, that the facing is turned away from forward.
+static const float kSweepAngle = static_cast<float>(M_PI) / 3.0f;
+
+void HeadlessController::Update() {
+  facing_.Update();
+  up_.Update();
+  for (int i = 0; i < kLogicalButtonCount; i++) {
+    buttons_[i].Update();
+  }
+
+  const float phase = static_cast<float>(update_count_ % kSweepPeriod) /
+                      static_cast<float>(kSweepPeriod);
+  const float yaw = kSweepAngle * sinf(2.0f * static_cast<float>(M_PI) * phase);
+  facing_.SetValue(quat::FromAngleAxis(yaw, mathfu::kAxisZ3f) *
+                   kCameraForward);
+  up_.SetValue(kCameraUp);
+
+  // Hold the button for a single update so that each press is one throw.
+  const bool fire =
+      fire_interval_ > 0 && update_count_ % fire_interval_ == 0;
+  if (fire != buttons_[kFireProjectile].Value()) {
+    buttons_[kFireProjectile].SetValue(fire);
+  }
+
+  update_count_++;
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,47 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_HEADLESS_CONTROLLER_H
+#define ZOOSHI_HEADLESS_CONTROLLER_H
+
+#include "inputcontrollers/base_player_controller.h"
+
+namespace fpl {
+namespace zooshi {
+
+// Scripted controller used by the headless runner. There is no input device,
+// so instead it sweeps the player's facing back and forth and fires a
+// projectile every `fire_interval` updates, which keeps the patron catching
+// code busy in a way that is repeatable from run to run.
+class HeadlessController : public BasePlayerController {
+ public:
+  explicit HeadlessController(int fire_interval)
+      : fire_interval_(fire_interval), update_count_(0) {}
+  virtual ~HeadlessController() {}
+
+  virtual void Update();
+  MATHFU_DEFINE_CLASS_SIMD_AWARE_NEW_DELETE
+
+ private:
+  // Number of updates between each projectile. Zero never fires.
+  int fire_interval_;
+
+  // Number of times Update() has been called.
+  int update_count_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_HEADLESS_CONTROLLER_H
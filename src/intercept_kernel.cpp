@@ -0,0 +1,290 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "intercept_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZOOSHI_INTERCEPT_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ZOOSHI_INTERCEPT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace fpl {
+namespace zooshi {
+
+// Relative slack on every test, as a fraction of the magnitude of the terms
+// it compares. Far larger than float rounding error, far smaller than any
+// distance that matters.
+static const float kTolerance = 1e-4f;
+
+// Projectiles evaluated per instruction.
+static const int kLanes = 4;
+
+// Comparisons are written as "reject if greater", so that a NaN, which
+// compares false, is kept for the exact tests to deal with.
+int FilterInterceptsScalar(const InterceptProjectiles& projectiles,
+                           const int* indices, int count,
+                           const InterceptTarget& target, int* survivors) {
+  int survivor_count = 0;
+  for (int i = 0; i < count; ++i) {
+    const int index = indices[i];
+    const float x = projectiles.x[index];
+    const float y = projectiles.y[index];
+    const float velocity_x = projectiles.velocity_x[index];
+    const float velocity_y = projectiles.velocity_y[index];
+
+    // Reject projectiles moving away from the patron.
+    const float dx = target.x - x;
+    const float dy = target.y - y;
+    const float dot_x = velocity_x * dx;
+    const float dot_y = velocity_y * dy;
+    const float dot = dot_x + dot_y;
+    const float dot_scale = std::fabs(dot_x) + std::fabs(dot_y);
+    if (dot <= -kTolerance * dot_scale) continue;
+
+    if (dot > 0.0f) {
+      // Reject projectiles whose closest approach is out of reach.
+      const float dist_sq = dx * dx + dy * dy;
+      const float t = dist_sq / dot;
+      const float travel_x = velocity_x * t;
+      const float travel_y = velocity_y * t;
+      const float travel_sq = travel_x * travel_x + travel_y * travel_y;
+      const float miss_x = dx - travel_x;
+      const float miss_y = dy - travel_y;
+      const float miss_sq = miss_x * miss_x + miss_y * miss_y;
+      if (miss_sq >
+          target.max_distance_sq + kTolerance * (dist_sq + travel_sq)) {
+        continue;
+      }
+
+      if (target.limit_return) {
+        const float return_dx = target.return_x - x;
+        const float return_dy = target.return_y - y;
+        const float return_sq = return_dx * return_dx + return_dy * return_dy;
+        const float return_miss_x = return_dx - travel_x;
+        const float return_miss_y = return_dy - travel_y;
+        const float return_miss_sq =
+            return_miss_x * return_miss_x + return_miss_y * return_miss_y;
+        if (return_miss_sq >
+            target.max_distance_sq + kTolerance * (return_sq + travel_sq)) {
+          continue;
+        }
+      }
+    }
+    survivors[survivor_count++] = index;
+  }
+  return survivor_count;
+}
+
+#if ZOOSHI_INTERCEPT_SSE2
+
+static inline __m128 Gather(const float* values, const int* lane_index) {
+  return _mm_set_ps(values[lane_index[3]], values[lane_index[2]],
+                    values[lane_index[1]], values[lane_index[0]]);
+}
+
+static inline __m128 LengthSquared(__m128 x, __m128 y) {
+  return _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+}
+
+int FilterIntercepts(const InterceptProjectiles& projectiles,
+                     const int* indices, int count,
+                     const InterceptTarget& target, int* survivors) {
+  const __m128 target_x = _mm_set1_ps(target.x);
+  const __m128 target_y = _mm_set1_ps(target.y);
+  const __m128 return_x = _mm_set1_ps(target.return_x);
+  const __m128 return_y = _mm_set1_ps(target.return_y);
+  const __m128 max_distance_sq = _mm_set1_ps(target.max_distance_sq);
+  const __m128 tolerance = _mm_set1_ps(kTolerance);
+  const __m128 negative_tolerance = _mm_set1_ps(-kTolerance);
+  const __m128 sign_bit = _mm_set1_ps(-0.0f);
+  const __m128 zero = _mm_setzero_ps();
+
+  int survivor_count = 0;
+  for (int i = 0; i < count; i += kLanes) {
+    // Pad a partial batch by repeating its last projectile.
+    const int lanes = std::min(kLanes, count - i);
+    int lane_index[kLanes];
+    for (int lane = 0; lane < kLanes; ++lane) {
+      lane_index[lane] = indices[i + std::min(lane, lanes - 1)];
+    }
+    const __m128 x = Gather(projectiles.x, lane_index);
+    const __m128 y = Gather(projectiles.y, lane_index);
+    const __m128 velocity_x = Gather(projectiles.velocity_x, lane_index);
+    const __m128 velocity_y = Gather(projectiles.velocity_y, lane_index);
+
+    const __m128 dx = _mm_sub_ps(target_x, x);
+    const __m128 dy = _mm_sub_ps(target_y, y);
+    const __m128 dot_x = _mm_mul_ps(velocity_x, dx);
+    const __m128 dot_y = _mm_mul_ps(velocity_y, dy);
+    const __m128 dot = _mm_add_ps(dot_x, dot_y);
+    const __m128 dot_scale = _mm_add_ps(_mm_andnot_ps(sign_bit, dot_x),
+                                        _mm_andnot_ps(sign_bit, dot_y));
+    const __m128 moving =
+        _mm_cmpnle_ps(dot, _mm_mul_ps(negative_tolerance, dot_scale));
+
+    const __m128 dist_sq = LengthSquared(dx, dy);
+    const __m128 t = _mm_div_ps(dist_sq, dot);
+    const __m128 travel_x = _mm_mul_ps(velocity_x, t);
+    const __m128 travel_y = _mm_mul_ps(velocity_y, t);
+    const __m128 travel_sq = LengthSquared(travel_x, travel_y);
+    const __m128 miss_sq =
+        LengthSquared(_mm_sub_ps(dx, travel_x), _mm_sub_ps(dy, travel_y));
+    const __m128 miss_limit = _mm_add_ps(
+        max_distance_sq,
+        _mm_mul_ps(tolerance, _mm_add_ps(dist_sq, travel_sq)));
+    __m128 reachable = _mm_cmpngt_ps(miss_sq, miss_limit);
+
+    if (target.limit_return) {
+      const __m128 return_dx = _mm_sub_ps(return_x, x);
+      const __m128 return_dy = _mm_sub_ps(return_y, y);
+      const __m128 return_sq = LengthSquared(return_dx, return_dy);
+      const __m128 return_miss_sq =
+          LengthSquared(_mm_sub_ps(return_dx, travel_x),
+                        _mm_sub_ps(return_dy, travel_y));
+      const __m128 return_limit = _mm_add_ps(
+          max_distance_sq,
+          _mm_mul_ps(tolerance, _mm_add_ps(return_sq, travel_sq)));
+      reachable = _mm_and_ps(reachable,
+                             _mm_cmpngt_ps(return_miss_sq, return_limit));
+    }
+
+    const __m128 keep = _mm_and_ps(
+        moving, _mm_or_ps(_mm_cmple_ps(dot, zero), reachable));
+    const int mask = _mm_movemask_ps(keep);
+    for (int lane = 0; lane < lanes; ++lane) {
+      if (mask & (1 << lane)) survivors[survivor_count++] = lane_index[lane];
+    }
+  }
+  return survivor_count;
+}
+
+#elif ZOOSHI_INTERCEPT_NEON
+
+static inline float32x4_t Gather(const float* values, const int* lane_index) {
+  const float lanes[kLanes] = {values[lane_index[0]], values[lane_index[1]],
+                               values[lane_index[2]], values[lane_index[3]]};
+  return vld1q_f32(lanes);
+}
+
+static inline float32x4_t LengthSquared(float32x4_t x, float32x4_t y) {
+  return vaddq_f32(vmulq_f32(x, x), vmulq_f32(y, y));
+}
+
+static inline float32x4_t Divide(float32x4_t numerator,
+                                 float32x4_t denominator) {
+#if defined(__aarch64__)
+  return vdivq_f32(numerator, denominator);
+#else
+  // 32-bit NEON has no divide. Two Newton-Raphson steps on the reciprocal
+  // estimate are well within the tolerance.
+  float32x4_t reciprocal = vrecpeq_f32(denominator);
+  reciprocal = vmulq_f32(vrecpsq_f32(denominator, reciprocal), reciprocal);
+  reciprocal = vmulq_f32(vrecpsq_f32(denominator, reciprocal), reciprocal);
+  return vmulq_f32(numerator, reciprocal);
+#endif
+}
+
+// All bits set in lanes where `a > b` is false, including NaNs.
+static inline uint32x4_t NotGreater(float32x4_t a, float32x4_t b) {
+  return vmvnq_u32(vcgtq_f32(a, b));
+}
+
+int FilterIntercepts(const InterceptProjectiles& projectiles,
+                     const int* indices, int count,
+                     const InterceptTarget& target, int* survivors) {
+  const float32x4_t target_x = vdupq_n_f32(target.x);
+  const float32x4_t target_y = vdupq_n_f32(target.y);
+  const float32x4_t return_x = vdupq_n_f32(target.return_x);
+  const float32x4_t return_y = vdupq_n_f32(target.return_y);
+  const float32x4_t max_distance_sq = vdupq_n_f32(target.max_distance_sq);
+  const float32x4_t tolerance = vdupq_n_f32(kTolerance);
+  const float32x4_t negative_tolerance = vdupq_n_f32(-kTolerance);
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+
+  int survivor_count = 0;
+  for (int i = 0; i < count; i += kLanes) {
+    // Pad a partial batch by repeating its last projectile.
+    const int lanes = std::min(kLanes, count - i);
+    int lane_index[kLanes];
+    for (int lane = 0; lane < kLanes; ++lane) {
+      lane_index[lane] = indices[i + std::min(lane, lanes - 1)];
+    }
+    const float32x4_t x = Gather(projectiles.x, lane_index);
+    const float32x4_t y = Gather(projectiles.y, lane_index);
+    const float32x4_t velocity_x = Gather(projectiles.velocity_x, lane_index);
+    const float32x4_t velocity_y = Gather(projectiles.velocity_y, lane_index);
+
+    const float32x4_t dx = vsubq_f32(target_x, x);
+    const float32x4_t dy = vsubq_f32(target_y, y);
+    const float32x4_t dot_x = vmulq_f32(velocity_x, dx);
+    const float32x4_t dot_y = vmulq_f32(velocity_y, dy);
+    const float32x4_t dot = vaddq_f32(dot_x, dot_y);
+    const float32x4_t dot_scale = vaddq_f32(vabsq_f32(dot_x), vabsq_f32(dot_y));
+    const uint32x4_t moving = vmvnq_u32(
+        vcleq_f32(dot, vmulq_f32(negative_tolerance, dot_scale)));
+
+    const float32x4_t dist_sq = LengthSquared(dx, dy);
+    const float32x4_t t = Divide(dist_sq, dot);
+    const float32x4_t travel_x = vmulq_f32(velocity_x, t);
+    const float32x4_t travel_y = vmulq_f32(velocity_y, t);
+    const float32x4_t travel_sq = LengthSquared(travel_x, travel_y);
+    const float32x4_t miss_sq =
+        LengthSquared(vsubq_f32(dx, travel_x), vsubq_f32(dy, travel_y));
+    const float32x4_t miss_limit = vaddq_f32(
+        max_distance_sq, vmulq_f32(tolerance, vaddq_f32(dist_sq, travel_sq)));
+    uint32x4_t reachable = NotGreater(miss_sq, miss_limit);
+
+    if (target.limit_return) {
+      const float32x4_t return_dx = vsubq_f32(return_x, x);
+      const float32x4_t return_dy = vsubq_f32(return_y, y);
+      const float32x4_t return_sq = LengthSquared(return_dx, return_dy);
+      const float32x4_t return_miss_sq = LengthSquared(
+          vsubq_f32(return_dx, travel_x), vsubq_f32(return_dy, travel_y));
+      const float32x4_t return_limit = vaddq_f32(
+          max_distance_sq,
+          vmulq_f32(tolerance, vaddq_f32(return_sq, travel_sq)));
+      reachable = vandq_u32(reachable,
+                            NotGreater(return_miss_sq, return_limit));
+    }
+
+    uint32_t keep[kLanes];
+    vst1q_u32(keep, vandq_u32(moving,
+                              vorrq_u32(vcleq_f32(dot, zero), reachable)));
+    for (int lane = 0; lane < lanes; ++lane) {
+      if (keep[lane]) survivors[survivor_count++] = lane_index[lane];
+    }
+  }
+  return survivor_count;
+}
+
+#else
+
+int FilterIntercepts(const InterceptProjectiles& projectiles,
+                     const int* indices, int count,
+                     const InterceptTarget& target, int* survivors) {
+  return FilterInterceptsScalar(projectiles, indices, count, target,
+                                survivors);
+}
+
+#endif  // ZOOSHI_INTERCEPT_SSE2
+
+}  // zooshi
+}  // fpl
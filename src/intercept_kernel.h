@@ -0,0 +1,84 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_INTERCEPT_KERNEL_H_
+#define ZOOSHI_INTERCEPT_KERNEL_H_
+
+namespace fpl {
+namespace zooshi {
+
+// Horizontal position and velocity of a set of projectiles, one array per
+// coordinate.
+struct InterceptProjectiles {
+  const float* x;
+  const float* y;
+  const float* velocity_x;
+  const float* velocity_y;
+};
+
+// A patron looking for projectiles to catch.
+struct InterceptTarget {
+  InterceptTarget()
+      : x(0.0f),
+        y(0.0f),
+        max_distance_sq(0.0f),
+        limit_return(false),
+        return_x(0.0f),
+        return_y(0.0f) {}
+
+  // Where the patron is.
+  float x;
+  float y;
+
+  // Square of the furthest the patron will move to catch a projectile.
+  float max_distance_sq;
+
+  // If set, the catch point must also be within the max distance of the
+  // return position.
+  bool limit_return;
+  float return_x;
+  float return_y;
+};
+
+// Discard the projectiles that can't be caught by `target`, because they're
+// moving away from it or their horizontal path never comes close enough.
+// These are the first, cheap, rejections that PatronComponent makes before
+// its height and angle checks.
+//
+// Reads the projectiles at `indices[0..count)`, and writes the indices of
+// those that pass to `survivors`, in order, returning how many there are.
+// `survivors` may be `indices`.
+//
+// The tests are loosened by a small tolerance, so that no rounding
+// difference between this and the intercept math that follows can reject a
+// projectile that the intercept math would have accepted. Callers should
+// repeat the exact tests on the survivors.
+//
+// Evaluates four projectiles at a time with SSE2 or NEON where the compiler
+// supports them.
+int FilterIntercepts(const InterceptProjectiles& projectiles,
+                     const int* indices, int count,
+                     const InterceptTarget& target, int* survivors);
+
+// The same tests, one projectile at a time. Gives the same survivors as
+// FilterIntercepts(), except possibly for projectiles right at the edge of
+// the tolerance, which the exact tests reject anyway.
+int FilterInterceptsScalar(const InterceptProjectiles& projectiles,
+                           const int* indices, int count,
+                           const InterceptTarget& target, int* survivors);
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_INTERCEPT_KERNEL_H_
@@ -30,6 +30,7 @@ extern "C" int FPL_main(int argc, char* argv[]) {
   fpl::zooshi::Game::SetOverlayName(overlay.c_str());
 #else
   fpl::zooshi::Game::SetOverlayName(argc > 1 ? argv[1] : "");
+  fpl::zooshi::Game::SetTraceFileName(argc > 2 ? argv[2] : "");
 #endif  // defined(__ANDROID__)
 
   if (!game.Initialize(binary_directory)) {
@@ -0,0 +1,86 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "mapped_file.h"
+
+#if ZOOSHI_MAPPED_FILE_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include "fplbase/utilities.h"
+#endif  // ZOOSHI_MAPPED_FILE_USE_MMAP
+
+namespace fpl {
+namespace zooshi {
+
+MappedFile::MappedFile() : data_(nullptr), size_(0) {}
+
+MappedFile::~MappedFile() { Close(); }
+
+#if ZOOSHI_MAPPED_FILE_USE_MMAP
+
+bool MappedFile::Open(const char* file_name) {
+  Close();
+  const int fd = open(file_name, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat file_stat;
+  bool ok = fstat(fd, &file_stat) == 0 && file_stat.st_size > 0;
+  if (ok) {
+    const size_t size = static_cast<size_t>(file_stat.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ok = data != MAP_FAILED;
+    if (ok) {
+      data_ = static_cast<const uint8_t*>(data);
+      size_ = size;
+    }
+  }
+  // The mapping holds its own reference to the file.
+  close(fd);
+  return ok;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#else
+
+bool MappedFile::Open(const char* file_name) {
+  Close();
+  if (!fplbase::LoadFile(file_name, &contents_) || contents_.empty()) {
+    contents_.clear();
+    return false;
+  }
+  data_ = reinterpret_cast<const uint8_t*>(contents_.data());
+  size_ = contents_.size();
+  return true;
+}
+
+void MappedFile::Close() {
+  contents_.clear();
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#endif  // ZOOSHI_MAPPED_FILE_USE_MMAP
+
+}  // zooshi
+}  // fpl
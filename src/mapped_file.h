@@ -0,0 +1,67 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef ZOOSHI_MAPPED_FILE_H_
+#define ZOOSHI_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Memory mapping is used where asset files are plain files on disk. On
+// Android they're inside the APK, so they're read with fplbase::LoadFile().
+#if !defined(__ANDROID__) && !defined(_WIN32)
+#define ZOOSHI_MAPPED_FILE_USE_MMAP 1
+#else
+#define ZOOSHI_MAPPED_FILE_USE_MMAP 0
+#endif
+
+namespace fpl {
+namespace zooshi {
+
+// A read-only view of the contents of a whole file, which stays valid for as
+// long as the MappedFile does. Where possible the file is mapped rather than
+// read, so nothing is copied, and pages are only loaded as they're touched.
+// Either way, the contents start on at least an 8 byte boundary.
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+
+  // Map `file_name`, which is relative to the asset directory like the names
+  // passed to fplbase::LoadFile(). Fails quietly if the file doesn't exist.
+  bool Open(const char* file_name);
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+  void Close();
+
+  const uint8_t* data_;
+  size_t size_;
+
+#if !ZOOSHI_MAPPED_FILE_USE_MMAP
+  std::string contents_;
+#endif  // !ZOOSHI_MAPPED_FILE_USE_MMAP
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_MAPPED_FILE_H_
@@ -126,9 +126,36 @@ class CheckAllPatronsFedNode : public BaseNode {
   PlayerComponent* player_component_;
 };
 
-void InitializePlayerModule(ModuleRegistry* module_registry,
-                            PlayerComponent* player_component,
-                            GraphComponent* graph_component) {
+// Finish with a projectile, returning it to its pool. Use in place of
+// entity.delete_entity for projectiles.
+class ReleaseProjectileNode : public BaseNode {
+ public:
+  ReleaseProjectileNode(PlayerProjectileComponent* player_projectile_component)
+      : player_projectile_component_(player_projectile_component) {}
+  virtual ~ReleaseProjectileNode() {}
+
+  static void OnRegister(NodeSignature* node_sig) {
+    node_sig->AddInput<void>();
+    node_sig->AddInput<corgi::EntityRef>();
+  }
+
+  virtual void Execute(NodeArguments* args) {
+    if (args->IsInputDirty(0)) {
+      auto entity = args->GetInput<corgi::EntityRef>(1);
+      if (entity->IsValid()) {
+        player_projectile_component_->ReleaseProjectile(*entity);
+      }
+    }
+  }
+
+ private:
+  PlayerProjectileComponent* player_projectile_component_;
+};
+
+void InitializePlayerModule(
+    ModuleRegistry* module_registry, PlayerComponent* player_component,
+    PlayerProjectileComponent* player_projectile_component,
+    GraphComponent* graph_component) {
   Module* module = module_registry->RegisterModule("player");
   auto on_fire_ctor = [graph_component]() {
     return new OnFireNode(graph_component);
@@ -145,6 +172,12 @@ void InitializePlayerModule(ModuleRegistry* module_registry,
   };
   module->RegisterNode<CheckAllPatronsFedNode>("check_all_patrons_fed",
                                                check_all_patrons_fed_ctor);
+
+  auto release_projectile_ctor = [player_projectile_component]() {
+    return new ReleaseProjectileNode(player_projectile_component);
+  };
+  module->RegisterNode<ReleaseProjectileNode>("release_projectile",
+                                              release_projectile_ctor);
 }
 
 }  // zooshi
@@ -17,6 +17,7 @@
 
 #include "breadboard/module_registry.h"
 #include "components/player.h"
+#include "components/player_projectile.h"
 #include "corgi_component_library/graph.h"
 
 namespace fpl {
@@ -25,6 +26,7 @@ namespace zooshi {
 void InitializePlayerModule(
     breadboard::ModuleRegistry* module_registry,
     PlayerComponent* player_component,
+    PlayerProjectileComponent* player_projectile_component,
     corgi::component_library::GraphComponent* graph_component);
 
 }  // zooshi
@@ -0,0 +1,225 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "projectile_grid.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using mathfu::vec3;
+
+namespace fpl {
+namespace zooshi {
+
+// Must be a power of two.
+static const int kBucketCount = 256;
+
+// Paths or queries covering more cells than this aren't worth indexing.
+static const int kMaxCellsPerPath = kBucketCount;
+static const int kMaxCellsPerQuery = kBucketCount;
+
+// Queries are widened by this fraction of a cell, so that rounding in the path
+// rasterization can never hide a projectile.
+static const float kQueryMargin = 0.01f;
+
+ProjectileGrid::ProjectileGrid() : cell_size_(1.0f), query_stamp_(0) {
+  bucket_starts_.resize(kBucketCount + 1, 0);
+}
+
+void ProjectileGrid::Clear() {
+  entities_.clear();
+  x_.clear();
+  y_.clear();
+  z_.clear();
+  velocity_x_.clear();
+  velocity_y_.clear();
+  velocity_z_.clear();
+  gravities_.clear();
+  cell_entries_.clear();
+  bucket_projectiles_.clear();
+  everywhere_.clear();
+  std::fill(bucket_starts_.begin(), bucket_starts_.end(), 0);
+}
+
+void ProjectileGrid::AddProjectile(const corgi::EntityRef& entity,
+                                   const vec3& position, const vec3& velocity,
+                                   float gravity) {
+  entities_.push_back(entity);
+  x_.push_back(position.x);
+  y_.push_back(position.y);
+  z_.push_back(position.z);
+  velocity_x_.push_back(velocity.x);
+  velocity_y_.push_back(velocity.y);
+  velocity_z_.push_back(velocity.z);
+  gravities_.push_back(gravity);
+}
+
+int ProjectileGrid::Bucket(int cell_x, int cell_y) {
+  const uint32_t hash = static_cast<uint32_t>(cell_x) * 73856093u ^
+                        static_cast<uint32_t>(cell_y) * 19349663u;
+  return static_cast<int>(hash & (kBucketCount - 1));
+}
+
+void ProjectileGrid::AddToCell(int cell_x, int cell_y, int index) {
+  cell_entries_.push_back(std::make_pair(Bucket(cell_x, cell_y), index));
+}
+
+// Walk the cells crossed by the path's line segment, in order.
+void ProjectileGrid::AddPath(int index, float start_time, float end_time) {
+  const float x = x_[index];
+  const float y = y_[index];
+  const float velocity_x = velocity_x_[index];
+  const float velocity_y = velocity_y_[index];
+  const float inv_cell_size = 1.0f / cell_size_;
+  const float start_x = (x + velocity_x * start_time) * inv_cell_size;
+  const float start_y = (y + velocity_y * start_time) * inv_cell_size;
+  const float end_x = (x + velocity_x * end_time) * inv_cell_size;
+  const float end_y = (y + velocity_y * end_time) * inv_cell_size;
+
+  int cell_x = static_cast<int>(std::floor(start_x));
+  int cell_y = static_cast<int>(std::floor(start_y));
+  const int end_cell_x = static_cast<int>(std::floor(end_x));
+  const int end_cell_y = static_cast<int>(std::floor(end_y));
+  const int steps =
+      std::abs(end_cell_x - cell_x) + std::abs(end_cell_y - cell_y);
+  if (steps >= kMaxCellsPerPath) {
+    everywhere_.push_back(index);
+    return;
+  }
+
+  // Distance along the segment, as a fraction of its length, to the next cell
+  // boundary on each axis, and between boundaries.
+  const float dx = end_x - start_x;
+  const float dy = end_y - start_y;
+  const float infinity = std::numeric_limits<float>::infinity();
+  const int step_x = dx > 0.0f ? 1 : -1;
+  const int step_y = dy > 0.0f ? 1 : -1;
+  float next_x = dx != 0.0f
+                     ? (cell_x + (dx > 0.0f ? 1 : 0) - start_x) / dx
+                     : infinity;
+  float next_y = dy != 0.0f
+                     ? (cell_y + (dy > 0.0f ? 1 : 0) - start_y) / dy
+                     : infinity;
+  const float delta_x = dx != 0.0f ? std::fabs(1.0f / dx) : infinity;
+  const float delta_y = dy != 0.0f ? std::fabs(1.0f / dy) : infinity;
+
+  AddToCell(cell_x, cell_y, index);
+  for (int i = 0; i < steps; ++i) {
+    // Never step past the end cell on either axis, whatever rounding says.
+    const bool x_done = cell_x == end_cell_x;
+    const bool y_done = cell_y == end_cell_y;
+    if (y_done || (!x_done && next_x < next_y)) {
+      cell_x += step_x;
+      next_x += delta_x;
+    } else {
+      cell_y += step_y;
+      next_y += delta_y;
+    }
+    AddToCell(cell_x, cell_y, index);
+  }
+}
+
+void ProjectileGrid::Build(float start_time, float end_time, float cell_size) {
+  assert(cell_size > 0.0f);
+  cell_size_ = cell_size;
+  cell_entries_.clear();
+  everywhere_.clear();
+  for (int i = 0; i < size(); ++i) {
+    AddPath(i, start_time, end_time);
+  }
+
+  // Counting sort the entries by bucket.
+  std::fill(bucket_starts_.begin(), bucket_starts_.end(), 0);
+  for (auto it = cell_entries_.begin(); it != cell_entries_.end(); ++it) {
+    bucket_starts_[it->first + 1]++;
+  }
+  for (int bucket = 0; bucket < kBucketCount; ++bucket) {
+    bucket_starts_[bucket + 1] += bucket_starts_[bucket];
+  }
+  bucket_projectiles_.resize(cell_entries_.size());
+  for (auto it = cell_entries_.begin(); it != cell_entries_.end(); ++it) {
+    bucket_projectiles_[bucket_starts_[it->first]++] = it->second;
+  }
+  // Filling advanced each start to the next bucket's start, so shift back.
+  for (int bucket = kBucketCount; bucket > 0; --bucket) {
+    bucket_starts_[bucket] = bucket_starts_[bucket - 1];
+  }
+  bucket_starts_[0] = 0;
+
+  stamps_.assign(entities_.size(), 0);
+  query_stamp_ = 0;
+}
+
+const std::vector<int>& ProjectileGrid::Query(const vec3& position,
+                                              float radius) const {
+  results_.clear();
+  const float inv_cell_size = 1.0f / cell_size_;
+  const float reach = radius + kQueryMargin * cell_size_;
+  const int min_x = static_cast<int>(std::floor((position.x - reach) *
+                                                inv_cell_size));
+  const int max_x = static_cast<int>(std::floor((position.x + reach) *
+                                                inv_cell_size));
+  const int min_y = static_cast<int>(std::floor((position.y - reach) *
+                                                inv_cell_size));
+  const int max_y = static_cast<int>(std::floor((position.y + reach) *
+                                                inv_cell_size));
+  if ((max_x - min_x + 1) * (max_y - min_y + 1) > kMaxCellsPerQuery) {
+    for (int i = 0; i < size(); ++i) results_.push_back(i);
+    return results_;
+  }
+
+  query_stamp_++;
+  results_.insert(results_.end(), everywhere_.begin(), everywhere_.end());
+  for (auto it = everywhere_.begin(); it != everywhere_.end(); ++it) {
+    stamps_[*it] = query_stamp_;
+  }
+  for (int y = min_y; y <= max_y; ++y) {
+    for (int x = min_x; x <= max_x; ++x) {
+      const int bucket = Bucket(x, y);
+      for (int i = bucket_starts_[bucket]; i < bucket_starts_[bucket + 1];
+           ++i) {
+        const int index = bucket_projectiles_[i];
+        if (stamps_[index] == query_stamp_) continue;
+        stamps_[index] = query_stamp_;
+        results_.push_back(index);
+      }
+    }
+  }
+
+  // Keep the order projectiles were added in, so ties between equally good
+  // candidates are broken the same way as a search over every projectile.
+  std::sort(results_.begin(), results_.end());
+  return results_;
+}
+
+const std::vector<int>& ProjectileGrid::QueryIntercepts(
+    const InterceptTarget& target) const {
+  Query(vec3(target.x, target.y, 0.0f), std::sqrt(target.max_distance_sq));
+  InterceptProjectiles projectiles;
+  projectiles.x = x_.data();
+  projectiles.y = y_.data();
+  projectiles.velocity_x = velocity_x_.data();
+  projectiles.velocity_y = velocity_y_.data();
+  const int survivors =
+      FilterIntercepts(projectiles, results_.data(),
+                       static_cast<int>(results_.size()), target,
+                       results_.data());
+  results_.resize(survivors);
+  return results_;
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,120 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_PROJECTILE_GRID_H_
+#define ZOOSHI_PROJECTILE_GRID_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "corgi/entity_manager.h"
+#include "intercept_kernel.h"
+#include "mathfu/glsl_mappings.h"
+
+namespace fpl {
+namespace zooshi {
+
+// A snapshot of the projectiles in flight, indexed by where their horizontal
+// paths will take them over a window of time, so that a patron can find the
+// projectiles that might pass near it without checking every one.
+//
+// Projectiles are assumed to move in a straight line horizontally, which is
+// what the patron's intercept math assumes too. Each projectile's path over
+// the window is rasterized into a uniform grid on the XY plane. The grid is
+// hashed into a fixed number of buckets, so it covers any area, and
+// collisions only cost extra candidates.
+//
+// Rebuild once per frame with Clear(), AddProjectile() and Build(). Nothing is
+// allocated once the buffers have grown to fit the usual number of
+// projectiles. Projectile state is stored one array per coordinate, so that
+// QueryIntercepts() can test several projectiles at once.
+class ProjectileGrid {
+ public:
+  ProjectileGrid();
+
+  // Remove all projectiles.
+  void Clear();
+
+  // Add a projectile. `gravity` is its vertical acceleration.
+  void AddProjectile(const corgi::EntityRef& entity,
+                     const mathfu::vec3& position,
+                     const mathfu::vec3& velocity, float gravity);
+
+  // Index the paths the projectiles follow from `start_time` to `end_time`
+  // seconds from now, in cells `cell_size` across. Queries are cheapest when
+  // the cell size is about the query radius.
+  void Build(float start_time, float end_time, float cell_size);
+
+  // Indices of the projectiles whose path over the window passes within
+  // `radius` of `position` on the XY plane, in the order they were added. May
+  // also include some that don't. The result is valid until the next query.
+  const std::vector<int>& Query(const mathfu::vec3& position,
+                                float radius) const;
+
+  // Query() around `target`, then drop the projectiles that
+  // FilterIntercepts() says it can't catch.
+  const std::vector<int>& QueryIntercepts(const InterceptTarget& target) const;
+
+  int size() const { return static_cast<int>(entities_.size()); }
+  const corgi::EntityRef& entity(int index) const { return entities_[index]; }
+  mathfu::vec3 position(int index) const {
+    return mathfu::vec3(x_[index], y_[index], z_[index]);
+  }
+  mathfu::vec3 velocity(int index) const {
+    return mathfu::vec3(velocity_x_[index], velocity_y_[index],
+                        velocity_z_[index]);
+  }
+  float gravity(int index) const { return gravities_[index]; }
+
+ private:
+  static int Bucket(int cell_x, int cell_y);
+  void AddToCell(int cell_x, int cell_y, int index);
+  void AddPath(int index, float start_time, float end_time);
+
+  // Projectile state, in the order added.
+  std::vector<corgi::EntityRef> entities_;
+  std::vector<float> x_;
+  std::vector<float> y_;
+  std::vector<float> z_;
+  std::vector<float> velocity_x_;
+  std::vector<float> velocity_y_;
+  std::vector<float> velocity_z_;
+  std::vector<float> gravities_;
+
+  float cell_size_;
+
+  // (bucket, projectile index) for every cell each path crosses, before
+  // being sorted into `bucket_projectiles_`.
+  std::vector<std::pair<int, int>> cell_entries_;
+
+  // Projectile indices grouped by bucket. Those of bucket `b` are in
+  // [bucket_starts_[b], bucket_starts_[b + 1]).
+  std::vector<int> bucket_starts_;
+  std::vector<int> bucket_projectiles_;
+
+  // Projectiles whose paths cross too many cells to be worth indexing. These
+  // are returned by every query.
+  std::vector<int> everywhere_;
+
+  // Query scratch space. `stamps_` holds the query that last returned each
+  // projectile, so no projectile is returned twice.
+  mutable std::vector<uint32_t> stamps_;
+  mutable uint32_t query_stamp_;
+  mutable std::vector<int> results_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_PROJECTILE_GRID_H_
@@ -0,0 +1,310 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "rail_denizen_kernel.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZOOSHI_RAIL_DENIZEN_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ZOOSHI_RAIL_DENIZEN_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace fpl {
+namespace zooshi {
+
+// Rotations closer than this to none, or to a half turn, are treated as
+// exactly that, as quat::RotateFromTo() does. This is cos(0.1 degrees).
+static const float kRotateFromToCosine = 0.99999847691f;
+
+// Denizens evaluated per instruction.
+static const int kLanes = 4;
+
+static void TransformDenizens(const RailDenizenInputs& inputs, int begin,
+                              int end,
+                              const RailDenizenTransforms& transforms) {
+  for (int i = begin; i < end; ++i) {
+    // Rotate by the inverse of the rail orientation, which negates its vector
+    // part, the way quat::operator*(vec3) does.
+    const float s = inputs.orientation_s[i];
+    const float inverse_x = -inputs.orientation_x[i];
+    const float inverse_y = -inputs.orientation_y[i];
+    const float inverse_z = -inputs.orientation_z[i];
+    const float x = inputs.x[i];
+    const float y = inputs.y[i];
+    const float z = inputs.z[i];
+    const float ss = s + s;
+    const float scale = ss * s - 1.0f;
+    const float dot2 = 2.0f * (inverse_x * x + inverse_y * y + inverse_z * z);
+    const float rotated_x =
+        ss * (inverse_y * z - inverse_z * y) + scale * x + dot2 * inverse_x;
+    const float rotated_y =
+        ss * (inverse_z * x - inverse_x * z) + scale * y + dot2 * inverse_y;
+    const float rotated_z =
+        ss * (inverse_x * y - inverse_y * x) + scale * z + dot2 * inverse_z;
+    transforms.x[i] = rotated_x * inputs.scale_x[i] + inputs.offset_x[i];
+    transforms.y[i] = rotated_y * inputs.scale_y[i] + inputs.offset_y[i];
+    transforms.z[i] = rotated_z * inputs.scale_z[i] + inputs.offset_z[i];
+
+    // Pitch about -X by the angle of the direction above the XY plane. That
+    // angle is within 90 degrees, so the cosine of half of it is at least
+    // sqrt(1/2), and safe to divide by.
+    const float direction_x = inputs.direction_x[i];
+    const float direction_y = inputs.direction_y[i];
+    const float direction_z = inputs.direction_z[i];
+    const float xy_length_sq =
+        direction_x * direction_x + direction_y * direction_y;
+    const float xy_length = std::sqrt(xy_length_sq);
+    const float length = std::sqrt(xy_length_sq + direction_z * direction_z);
+    const float cos_pitch = length > 0.0f ? xy_length / length : 1.0f;
+    const float sin_pitch = length > 0.0f ? direction_z / length : 0.0f;
+    const float half_cos = std::sqrt(0.5f * (1.0f + cos_pitch));
+    const float half_sin = 0.5f * sin_pitch / half_cos;
+
+    // Yaw about Z, turning the direction on the XY plane onto the Y axis.
+    const float inverse_xy_length = xy_length > 0.0f ? 1.0f / xy_length : 0.0f;
+    const float u = direction_x * inverse_xy_length;
+    const float v = direction_y * inverse_xy_length;
+    float yaw_s;
+    float yaw_z;
+    if (v >= kRotateFromToCosine) {
+      yaw_s = 1.0f;
+      yaw_z = 0.0f;
+    } else if (v <= -kRotateFromToCosine) {
+      yaw_s = 0.0f;
+      yaw_z = -1.0f;
+    } else {
+      const float yaw_length = std::sqrt((1.0f + v) * (1.0f + v) + u * u);
+      yaw_s = (1.0f + v) / yaw_length;
+      yaw_z = u / yaw_length;
+    }
+
+    // The pitch times the yaw, then the rail orientation times that.
+    const float local_s = half_cos * yaw_s;
+    const float local_x = -half_sin * yaw_s;
+    const float local_y = half_sin * yaw_z;
+    const float local_z = half_cos * yaw_z;
+    const float rail_x = inputs.orientation_x[i];
+    const float rail_y = inputs.orientation_y[i];
+    const float rail_z = inputs.orientation_z[i];
+    transforms.orientation_s[i] =
+        s * local_s - (rail_x * local_x + rail_y * local_y + rail_z * local_z);
+    transforms.orientation_x[i] = s * local_x + local_s * rail_x +
+                                  (rail_y * local_z - rail_z * local_y);
+    transforms.orientation_y[i] = s * local_y + local_s * rail_y +
+                                  (rail_z * local_x - rail_x * local_z);
+    transforms.orientation_z[i] = s * local_z + local_s * rail_z +
+                                  (rail_x * local_y - rail_y * local_x);
+  }
+}
+
+void ComputeRailDenizenTransformsScalar(
+    const RailDenizenInputs& inputs, int count,
+    const RailDenizenTransforms& transforms) {
+  TransformDenizens(inputs, 0, count, transforms);
+}
+
+#if ZOOSHI_RAIL_DENIZEN_SSE2 || ZOOSHI_RAIL_DENIZEN_NEON
+
+// The few operations the kernel needs, so it can be written once for both
+// instruction sets. A Mask has all bits set in lanes where a test passed.
+#if ZOOSHI_RAIL_DENIZEN_SSE2
+
+typedef __m128 Lanes;
+typedef __m128 Mask;
+
+static inline Lanes Load(const float* values) { return _mm_loadu_ps(values); }
+static inline void Store(float* values, Lanes a) { _mm_storeu_ps(values, a); }
+static inline Lanes Splat(float value) { return _mm_set1_ps(value); }
+static inline Lanes Add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+static inline Lanes Sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+static inline Lanes Mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+static inline Lanes Div(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+static inline Lanes Sqrt(Lanes a) { return _mm_sqrt_ps(a); }
+static inline Mask Greater(Lanes a, Lanes b) { return _mm_cmpgt_ps(a, b); }
+static inline Mask GreaterEqual(Lanes a, Lanes b) {
+  return _mm_cmpge_ps(a, b);
+}
+static inline Mask LessEqual(Lanes a, Lanes b) { return _mm_cmple_ps(a, b); }
+static inline Lanes Select(Mask mask, Lanes a, Lanes b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+#else  // ZOOSHI_RAIL_DENIZEN_NEON
+
+typedef float32x4_t Lanes;
+typedef uint32x4_t Mask;
+
+static inline Lanes Load(const float* values) { return vld1q_f32(values); }
+static inline void Store(float* values, Lanes a) { vst1q_f32(values, a); }
+static inline Lanes Splat(float value) { return vdupq_n_f32(value); }
+static inline Lanes Add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+static inline Lanes Sub(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+static inline Lanes Mul(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+static inline Mask Greater(Lanes a, Lanes b) { return vcgtq_f32(a, b); }
+static inline Mask GreaterEqual(Lanes a, Lanes b) { return vcgeq_f32(a, b); }
+static inline Mask LessEqual(Lanes a, Lanes b) { return vcleq_f32(a, b); }
+static inline Lanes Select(Mask mask, Lanes a, Lanes b) {
+  return vbslq_f32(mask, a, b);
+}
+
+static inline Lanes Div(Lanes a, Lanes b) {
+#if defined(__aarch64__)
+  return vdivq_f32(a, b);
+#else
+  // 32-bit NEON has no divide. Two Newton-Raphson steps on the reciprocal
+  // estimate bring it to within float rounding.
+  float32x4_t reciprocal = vrecpeq_f32(b);
+  reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+  reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+  return vmulq_f32(a, reciprocal);
+#endif
+}
+
+static inline Lanes Sqrt(Lanes a) {
+#if defined(__aarch64__)
+  return vsqrtq_f32(a);
+#else
+  // Nor a square root, so refine the reciprocal square root estimate the
+  // same way. The estimate of zero's is infinite, so zero is kept apart.
+  float32x4_t reciprocal = vrsqrteq_f32(a);
+  reciprocal = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, reciprocal), reciprocal),
+                         reciprocal);
+  reciprocal = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, reciprocal), reciprocal),
+                         reciprocal);
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  return vbslq_f32(vcgtq_f32(a, zero), vmulq_f32(a, reciprocal), zero);
+#endif
+}
+
+#endif  // ZOOSHI_RAIL_DENIZEN_SSE2
+
+// The same steps as TransformDenizens(), with each branch replaced by
+// computing both sides and selecting. Lanes that select away a division by
+// zero compute an infinity or NaN, which is discarded.
+void ComputeRailDenizenTransforms(const RailDenizenInputs& inputs, int count,
+                                  const RailDenizenTransforms& transforms) {
+  const Lanes zero = Splat(0.0f);
+  const Lanes half = Splat(0.5f);
+  const Lanes one = Splat(1.0f);
+  const Lanes two = Splat(2.0f);
+  const Lanes rotate_from_to_cosine = Splat(kRotateFromToCosine);
+  const Lanes negative_rotate_from_to_cosine = Splat(-kRotateFromToCosine);
+
+  int i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    const Lanes s = Load(inputs.orientation_s + i);
+    const Lanes rail_x = Load(inputs.orientation_x + i);
+    const Lanes rail_y = Load(inputs.orientation_y + i);
+    const Lanes rail_z = Load(inputs.orientation_z + i);
+    const Lanes inverse_x = Sub(zero, rail_x);
+    const Lanes inverse_y = Sub(zero, rail_y);
+    const Lanes inverse_z = Sub(zero, rail_z);
+    const Lanes x = Load(inputs.x + i);
+    const Lanes y = Load(inputs.y + i);
+    const Lanes z = Load(inputs.z + i);
+    const Lanes ss = Add(s, s);
+    const Lanes scale = Sub(Mul(ss, s), one);
+    const Lanes dot2 =
+        Mul(two, Add(Add(Mul(inverse_x, x), Mul(inverse_y, y)),
+                     Mul(inverse_z, z)));
+    const Lanes rotated_x =
+        Add(Add(Mul(ss, Sub(Mul(inverse_y, z), Mul(inverse_z, y))),
+                Mul(scale, x)),
+            Mul(dot2, inverse_x));
+    const Lanes rotated_y =
+        Add(Add(Mul(ss, Sub(Mul(inverse_z, x), Mul(inverse_x, z))),
+                Mul(scale, y)),
+            Mul(dot2, inverse_y));
+    const Lanes rotated_z =
+        Add(Add(Mul(ss, Sub(Mul(inverse_x, y), Mul(inverse_y, x))),
+                Mul(scale, z)),
+            Mul(dot2, inverse_z));
+    Store(transforms.x + i, Add(Mul(rotated_x, Load(inputs.scale_x + i)),
+                                Load(inputs.offset_x + i)));
+    Store(transforms.y + i, Add(Mul(rotated_y, Load(inputs.scale_y + i)),
+                                Load(inputs.offset_y + i)));
+    Store(transforms.z + i, Add(Mul(rotated_z, Load(inputs.scale_z + i)),
+                                Load(inputs.offset_z + i)));
+
+    const Lanes direction_x = Load(inputs.direction_x + i);
+    const Lanes direction_y = Load(inputs.direction_y + i);
+    const Lanes direction_z = Load(inputs.direction_z + i);
+    const Lanes xy_length_sq =
+        Add(Mul(direction_x, direction_x), Mul(direction_y, direction_y));
+    const Lanes xy_length = Sqrt(xy_length_sq);
+    const Lanes length =
+        Sqrt(Add(xy_length_sq, Mul(direction_z, direction_z)));
+    const Mask has_length = Greater(length, zero);
+    const Lanes cos_pitch = Select(has_length, Div(xy_length, length), one);
+    const Lanes sin_pitch =
+        Select(has_length, Div(direction_z, length), zero);
+    const Lanes half_cos = Sqrt(Mul(half, Add(one, cos_pitch)));
+    const Lanes half_sin = Div(Mul(half, sin_pitch), half_cos);
+
+    const Lanes inverse_xy_length =
+        Select(Greater(xy_length, zero), Div(one, xy_length), zero);
+    const Lanes u = Mul(direction_x, inverse_xy_length);
+    const Lanes v = Mul(direction_y, inverse_xy_length);
+    const Lanes one_plus_v = Add(one, v);
+    const Lanes yaw_length =
+        Sqrt(Add(Mul(one_plus_v, one_plus_v), Mul(u, u)));
+    const Mask no_turn = GreaterEqual(v, rotate_from_to_cosine);
+    const Mask half_turn = LessEqual(v, negative_rotate_from_to_cosine);
+    const Lanes yaw_s =
+        Select(no_turn, one,
+               Select(half_turn, zero, Div(one_plus_v, yaw_length)));
+    const Lanes yaw_z =
+        Select(no_turn, zero,
+               Select(half_turn, Sub(zero, one), Div(u, yaw_length)));
+
+    const Lanes local_s = Mul(half_cos, yaw_s);
+    const Lanes local_x = Sub(zero, Mul(half_sin, yaw_s));
+    const Lanes local_y = Mul(half_sin, yaw_z);
+    const Lanes local_z = Mul(half_cos, yaw_z);
+    Store(transforms.orientation_s + i,
+          Sub(Mul(s, local_s),
+              Add(Add(Mul(rail_x, local_x), Mul(rail_y, local_y)),
+                  Mul(rail_z, local_z))));
+    Store(transforms.orientation_x + i,
+          Add(Add(Mul(s, local_x), Mul(local_s, rail_x)),
+              Sub(Mul(rail_y, local_z), Mul(rail_z, local_y))));
+    Store(transforms.orientation_y + i,
+          Add(Add(Mul(s, local_y), Mul(local_s, rail_y)),
+              Sub(Mul(rail_z, local_x), Mul(rail_x, local_z))));
+    Store(transforms.orientation_z + i,
+          Add(Add(Mul(s, local_z), Mul(local_s, rail_z)),
+              Sub(Mul(rail_x, local_y), Mul(rail_y, local_x))));
+  }
+
+  // Finish a partial batch one denizen at a time.
+  TransformDenizens(inputs, i, count, transforms);
+}
+
+#else
+
+void ComputeRailDenizenTransforms(const RailDenizenInputs& inputs, int count,
+                                  const RailDenizenTransforms& transforms) {
+  TransformDenizens(inputs, 0, count, transforms);
+}
+
+#endif  // ZOOSHI_RAIL_DENIZEN_SSE2 || ZOOSHI_RAIL_DENIZEN_NEON
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,88 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef ZOOSHI_RAIL_DENIZEN_KERNEL_H_
+#define ZOOSHI_RAIL_DENIZEN_KERNEL_H_
+
+namespace fpl {
+namespace zooshi {
+
+// Where a set of rail denizens are on their rails, which way they're heading,
+// and the transform from each rail to the world, one array per coordinate.
+// Quaternions are split into their scalar part `s` and vector part.
+struct RailDenizenInputs {
+  // Position on the rail.
+  const float* x;
+  const float* y;
+  const float* z;
+
+  // Direction of travel along the rail. Need not be normalized.
+  const float* direction_x;
+  const float* direction_y;
+  const float* direction_z;
+
+  // RailDenizenData::rail_orientation, rail_scale and rail_offset.
+  const float* orientation_s;
+  const float* orientation_x;
+  const float* orientation_y;
+  const float* orientation_z;
+  const float* scale_x;
+  const float* scale_y;
+  const float* scale_z;
+  const float* offset_x;
+  const float* offset_y;
+  const float* offset_z;
+};
+
+// World position and target orientation of a set of rail denizens, one array
+// per coordinate.
+struct RailDenizenTransforms {
+  float* x;
+  float* y;
+  float* z;
+  float* orientation_s;
+  float* orientation_x;
+  float* orientation_y;
+  float* orientation_z;
+};
+
+// Compute the world transform of `count` rail denizens, as
+// RailDenizenComponent applies it:
+//
+//   position = rail_orientation.Inverse() * rail_position * rail_scale +
+//              rail_offset
+//   orientation = rail_orientation *
+//                 quat::FromAngleAxis(pitch, -kAxisX3f) *
+//                 quat::RotateFromTo(direction_on_xy_plane, kAxisY3f)
+//
+// where `pitch` is the angle of the direction above the XY plane. The pitch
+// is found from its cosine and sine rather than atan2f, and a direction with
+// no XY part gives no yaw rather than an invalid quaternion. Otherwise the
+// results match the mathfu expressions to within float rounding.
+//
+// Evaluates four denizens at a time with SSE2 or NEON where the compiler
+// supports them.
+void ComputeRailDenizenTransforms(const RailDenizenInputs& inputs, int count,
+                                  const RailDenizenTransforms& transforms);
+
+// The same computation, one denizen at a time.
+void ComputeRailDenizenTransformsScalar(
+    const RailDenizenInputs& inputs, int count,
+    const RailDenizenTransforms& transforms);
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_RAIL_DENIZEN_KERNEL_H_
@@ -14,7 +14,14 @@
 
 #include "railmanager.h"
 
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <map>
+#include <utility>
 #include "components/rail_denizen.h"
 #include "components/rail_node.h"
 #include "corgi_component_library/transform.h"
@@ -29,6 +36,68 @@ namespace zooshi {
 
 static const float kSplineGranularity = 10.0f;
 
+// The lookup table holds this many samples per position the rail was made
+// from, but never fewer than the minimum.
+static const int kLookupSamplesPerPosition = 8;
+static const int kMinLookupSamples = 64;
+
+// RefitNode() refits the nodes within this many of the one that moved.
+static const int kRefitMargin = 4;
+
+// Leaves of the segment tree hold at most this many segments.
+static const int kSegmentsPerLeaf = 4;
+
+// Deep enough for a segment tree over any lookup table that fits in memory.
+static const int kMaxSegmentTreeDepth = 64;
+
+// Baked rails start with a BakedRailHeader, followed by the arrays it lists.
+// Each array starts on a multiple of the alignment from the start of the
+// file, so that it can be used in place. Bump the version whenever the
+// layout of a baked rail changes, or what's derived from the rail does.
+static const char kBakedRailIdentifier[4] = {'Z', 'R', 'A', 'L'};
+static const uint32_t kBakedRailVersion = 1;
+static const size_t kBakedRailAlignment = 16;
+
+// Baked rail file names end with a hash of what the rail is fit to, with
+// positions and times rounded to this many steps per unit.
+static const double kBakedRailHashScale = 1000.0;
+
+// A baked rail is only used if it was fit to the same positions as the rail
+// that's wanted, give or take this much.
+static const float kBakedRailPositionTolerance = 0.001f;
+
+struct BakedRailHeader {
+  char identifier[4];
+  uint32_t version;
+  // Sizes of the structures baked in place, as a check that their layout
+  // hasn't changed since.
+  uint32_t spline_struct_size;
+  uint32_t segment_node_size;
+
+  // What the rail was fit to.
+  float reliable_distance;
+  float total_time;
+  uint32_t wraps;
+  uint32_t num_positions;
+  uint32_t positions_offset;
+
+  // The rail's CompactSpline array, as laid out in memory.
+  uint32_t splines_size;
+  uint32_t splines_offset;
+
+  // The tables derived from the splines.
+  float table_step;
+  uint32_t table_size;
+  uint32_t table_positions_offset;
+  uint32_t table_directions_offset;
+  uint32_t table_distances_offset;
+  float distance_step;
+  uint32_t distance_size;
+  uint32_t distance_times_offset;
+  uint32_t segment_tree_size;
+  uint32_t segment_tree_offset;
+};
+
 using mathfu::vec3;
 using mathfu::vec3_packed;
 
@@ -52,16 +121,17 @@ void Rail::InitializeFromPositions(const std::vector<vec3_packed> &positions,
                                    float reliable_distance, float total_time,
                                    bool wraps) {
   const size_t num_positions = positions.size();
-  std::vector<float> times;
-  std::vector<vec3_packed> derivatives;
-  times.resize(num_positions);
-  derivatives.resize(num_positions);
+  fit_positions_ = positions;
+  fit_times_.resize(num_positions);
+  fit_derivatives_.resize(num_positions);
+  fit_reliable_distance_ = reliable_distance;
+  fit_granularity_ = spline_granularity;
   wraps_ = wraps;
 
   // Calculate derivates and times from positions.
   motive::CalculateConstSpeedCurveFromPositions<3>(
       &positions[0], static_cast<int>(num_positions), total_time,
-      reliable_distance, &times[0], &derivatives[0]);
+      reliable_distance, &fit_times_[0], &fit_derivatives_[0]);
 
   // Get position extremes.
   vec3 position_min(std::numeric_limits<float>::infinity());
@@ -76,28 +146,682 @@ void Rail::InitializeFromPositions(const std::vector<vec3_packed> &positions,
   splines_ = motive::CompactSpline::CreateArray(
       2 * static_cast<motive::CompactSplineIndex>(num_positions), kDimensions);
 
-  // Initialize the compact-splines to have the best precision possible,
-  // given the range limits.
+  // Give the compact-splines the best precision possible, given the range
+  // limits.
   const float kRangeSafeBoundsPercent = 1.1f;
+  fit_ranges_.clear();
+  for (motive::MotiveDimension i = 0; i < kDimensions; ++i) {
+    fit_ranges_.push_back(motive::Range(position_min[i], position_max[i])
+                              .Lengthen(kRangeSafeBoundsPercent));
+  }
+  FitSplines();
+
+  BuildLookupTable(std::max(kMinLookupSamples,
+                            kLookupSamplesPerPosition *
+                                static_cast<int>(num_positions)));
+  UseBuiltTables();
+}
+
+void Rail::FitSplines() {
   for (motive::MotiveDimension i = 0; i < kDimensions; ++i) {
-    Spline(i)->Init(motive::Range(position_min[i], position_max[i])
-                        .Lengthen(kRangeSafeBoundsPercent),
-                    spline_granularity);
-  }
-
-  // Initialize the splines. For now, the splines all have key points at the
-  // same time values, but this is a limitation that we can (and should) lift
-  // to maximize compression.
-  for (size_t k = 0; k < num_positions; ++k) {
-    const float t = times[k];
-    const vec3 position(positions[k]);
-    const vec3 derivative(derivatives[k]);
+    Spline(i)->Init(fit_ranges_[i], fit_granularity_);
+  }
+
+  // For now, the splines all have key points at the same time values, but
+  // this is a limitation that we can (and should) lift to maximize
+  // compression.
+  for (size_t k = 0; k < fit_positions_.size(); ++k) {
+    const float t = fit_times_[k];
+    const vec3 position(fit_positions_[k]);
+    const vec3 derivative(fit_derivatives_[k]);
     for (motive::MotiveDimension i = 0; i < kDimensions; ++i) {
       Spline(i)->AddNode(t, position[i], derivative[i]);
     }
   }
 }
 
+bool Rail::RefitNode(int index, const vec3 &position) {
+  // A baked rail doesn't keep what it was fit to.
+  const int num_positions = static_cast<int>(fit_positions_.size());
+  if (baked_ || index < 0 || index >= num_positions) return false;
+  for (motive::MotiveDimension i = 0; i < kDimensions; ++i) {
+    if (position[i] < fit_ranges_[i].start() ||
+        position[i] > fit_ranges_[i].end()) {
+      return false;
+    }
+  }
+  if ((vec3(fit_positions_[index]) - position).LengthSquared() == 0.0f) {
+    return true;
+  }
+
+  // On a rail that wraps, the first position is repeated at the end.
+  const bool seam = wraps_ && (index == 0 || index == num_positions - 1);
+  const int first = seam ? 0 : index;
+  const int last = seam ? num_positions - 1 : index;
+  fit_positions_[first] = position;
+  fit_positions_[last] = position;
+  RefitWindow(first);
+  if (last != first) RefitWindow(last);
+  FitSplines();
+  RefitLookupTable(first);
+  if (last != first) RefitLookupTable(last);
+  if (InvertDistances() && built_segment_tree_.empty()) {
+    BuildSegmentTree(0, static_cast<int>(built_positions_.size()) - 1);
+  }
+  UseBuiltTables();
+  return true;
+}
+
+// Fit a rail to the window alone, as though it were the whole rail, taking
+// the same time as it does now. Its nodes are then spaced at a constant speed
+// within the window, but the nodes at its ends keep their times, and the
+// rest of the rail is untouched. The ends' derivatives are only refit where
+// the window ends with the rail, since elsewhere the window can't see past
+// them.
+void Rail::RefitWindow(int index) {
+  const int num_positions = static_cast<int>(fit_positions_.size());
+  const int begin = std::max(index - kRefitMargin, 0);
+  const int end = std::min(index + kRefitMargin, num_positions - 1);
+  const int count = end - begin + 1;
+  if (count < 2) return;
+  std::vector<float> times(count);
+  std::vector<vec3_packed> derivatives(count);
+  motive::CalculateConstSpeedCurveFromPositions<3>(
+      &fit_positions_[begin], count, fit_times_[end] - fit_times_[begin],
+      fit_reliable_distance_, &times[0], &derivatives[0]);
+  for (int i = 0; i < count; ++i) {
+    const int node = begin + i;
+    if (node != begin && node != end) {
+      fit_times_[node] = fit_times_[begin] + times[i];
+    }
+    if ((node != begin || begin == 0) &&
+        (node != end || end == num_positions - 1)) {
+      fit_derivatives_[node] = derivatives[i];
+    }
+  }
+}
+
+void Rail::BuildLookupTable(int num_samples) {
+  built_positions_.clear();
+  built_directions_.clear();
+  built_distances_.clear();
+  built_distance_times_.clear();
+  built_segment_tree_.clear();
+  table_step_ = 0.0f;
+  distance_step_ = 0.0f;
+  const float end_time = EndTime();
+  if (end_time <= 0.0f || num_samples < 2) return;
+
+  // Sample evenly in time, with the last sample exactly at the end.
+  table_step_ = end_time / (num_samples - 1);
+  built_positions_.resize(num_samples);
+  built_directions_.resize(num_samples);
+  built_distances_.resize(num_samples);
+  SamplePositions(0, num_samples);
+  SampleDirections(0, num_samples);
+  SampleDistances(0);
+  if (InvertDistances()) BuildSegmentTree(0, num_samples - 1);
+}
+
+// Only the splines between the ends of the window have changed.
+void Rail::RefitLookupTable(int index) {
+  const int num_samples = static_cast<int>(built_positions_.size());
+  if (num_samples < 2 || table_step_ <= 0.0f) return;
+  const int num_positions = static_cast<int>(fit_positions_.size());
+  const float start_time = fit_times_[std::max(index - kRefitMargin, 0)];
+  const float end_time =
+      fit_times_[std::min(index + kRefitMargin, num_positions - 1)];
+  const int begin = std::max(
+      static_cast<int>(std::floor(start_time / table_step_)), 0);
+  const int end = std::min(
+      static_cast<int>(std::ceil(end_time / table_step_)) + 1, num_samples);
+  if (begin >= end) return;
+  SamplePositions(begin, end);
+
+  // Directions are differences of the neighbors, which wrap at the seam.
+  SampleDirections(std::max(begin - 1, 0), std::min(end + 1, num_samples));
+  if (wraps_ && (begin <= 1 || end >= num_samples - 1)) {
+    SampleDirections(0, 2);
+    SampleDirections(num_samples - 2, num_samples);
+  }
+  SampleDistances(std::max(begin, 1));
+  if (!built_segment_tree_.empty()) RefitSegmentTree(0, begin, end - 1);
+}
+
+void Rail::SamplePositions(int begin, int end) {
+  motive::CompactSpline::BulkYs<3>(
+      Splines(), begin * table_step_, table_step_,
+      static_cast<size_t>(end - begin), &built_positions_[begin]);
+}
+
+// Directions are central differences. At the ends of a rail that wraps, the
+// neighbors are on the other side of the seam, where the first and last
+// samples are the same point.
+void Rail::SampleDirections(int begin, int end) {
+  const int num_samples = static_cast<int>(built_positions_.size());
+  vec3 direction =
+      begin > 0 ? vec3(built_directions_[begin - 1]) : mathfu::kAxisY3f;
+  for (int i = begin; i < end; ++i) {
+    int prev = i - 1;
+    int next = i + 1;
+    if (prev < 0) prev = wraps_ ? num_samples - 2 : 0;
+    if (next >= num_samples) next = wraps_ ? 1 : num_samples - 1;
+    const vec3 difference =
+        vec3(built_positions_[next]) - vec3(built_positions_[prev]);
+    const float length = difference.Length();
+    // Keep the previous direction where the rail stops.
+    if (length > 0.0f) direction = difference / length;
+    built_directions_[i] = direction;
+  }
+}
+
+void Rail::SampleDistances(int begin) {
+  const int num_samples = static_cast<int>(built_distances_.size());
+  if (begin == 0) built_distances_[begin++] = 0.0f;
+  for (int i = begin; i < num_samples; ++i) {
+    built_distances_[i] =
+        built_distances_[i - 1] +
+        (vec3(built_positions_[i]) - vec3(built_positions_[i - 1])).Length();
+  }
+}
+
+// Invert the distances, walking both tables together.
+bool Rail::InvertDistances() {
+  const int num_samples = static_cast<int>(built_distances_.size());
+  built_distance_times_.clear();
+  distance_step_ = 0.0f;
+  const float total_distance = built_distances_.back();
+  if (total_distance <= 0.0f) return false;
+  distance_step_ = total_distance / (num_samples - 1);
+  built_distance_times_.resize(num_samples);
+  int segment = 0;
+  for (int i = 0; i < num_samples; ++i) {
+    const float distance = std::min(i * distance_step_, total_distance);
+    while (segment < num_samples - 2 &&
+           built_distances_[segment + 1] < distance) {
+      ++segment;
+    }
+    const float segment_length =
+        built_distances_[segment + 1] - built_distances_[segment];
+    const float fraction =
+        segment_length > 0.0f
+            ? (distance - built_distances_[segment]) / segment_length
+            : 0.0f;
+    built_distance_times_[i] = (segment + fraction) * table_step_;
+  }
+  return true;
+}
+
+// Consecutive segments are close together, so halving the range at each
+// level makes a tree as good as splitting along an axis, and is cheaper.
+int Rail::BuildSegmentTree(int begin, int end) {
+  const int index = static_cast<int>(built_segment_tree_.size());
+  SegmentNode node;
+  node.begin = begin;
+  node.end = end;
+  node.second_child = -1;
+  built_segment_tree_.push_back(node);
+  if (end - begin > kSegmentsPerLeaf) {
+    const int middle = begin + (end - begin) / 2;
+    BuildSegmentTree(begin, middle);
+    // Building the children may grow the vector, so don't hold a reference
+    // into it across the call.
+    const int second_child = BuildSegmentTree(middle, end);
+    built_segment_tree_[index].second_child = second_child;
+  }
+  BoundSegments(index);
+  return index;
+}
+
+void Rail::RefitSegmentTree(int index, int first_sample, int last_sample) {
+  const SegmentNode &node = built_segment_tree_[index];
+  if (node.end < first_sample || node.begin > last_sample) return;
+  if (node.second_child >= 0) {
+    RefitSegmentTree(index + 1, first_sample, last_sample);
+    RefitSegmentTree(node.second_child, first_sample, last_sample);
+  }
+  BoundSegments(index);
+}
+
+// Bound a leaf's samples, or the bounds of a node's children.
+void Rail::BoundSegments(int index) {
+  SegmentNode &node = built_segment_tree_[index];
+  vec3 bounds_min;
+  vec3 bounds_max;
+  if (node.second_child >= 0) {
+    const SegmentNode &first = built_segment_tree_[index + 1];
+    const SegmentNode &second = built_segment_tree_[node.second_child];
+    bounds_min = vec3::Min(vec3(first.min), vec3(second.min));
+    bounds_max = vec3::Max(vec3(first.max), vec3(second.max));
+  } else {
+    bounds_min = vec3(built_positions_[node.begin]);
+    bounds_max = bounds_min;
+    for (int i = node.begin + 1; i <= node.end; ++i) {
+      bounds_min = vec3::Min(bounds_min, vec3(built_positions_[i]));
+      bounds_max = vec3::Max(bounds_max, vec3(built_positions_[i]));
+    }
+  }
+  node.min = bounds_min;
+  node.max = bounds_max;
+}
+
+void Rail::UseBuiltTables() {
+  table_size_ = static_cast<int>(built_positions_.size());
+  table_positions_ = built_positions_.data();
+  table_directions_ = built_directions_.data();
+  table_distances_ = built_distances_.data();
+  distance_size_ = static_cast<int>(built_distance_times_.size());
+  distance_times_ = built_distance_times_.data();
+  segment_tree_size_ = static_cast<int>(built_segment_tree_.size());
+  segment_tree_ = built_segment_tree_.data();
+}
+
+// Pad `baked` to the alignment, append `size` bytes of `data`, and return
+// where they start.
+static uint32_t AppendAligned(const void *data, size_t size,
+                              std::string *baked) {
+  const size_t offset = (baked->size() + kBakedRailAlignment - 1) /
+                        kBakedRailAlignment * kBakedRailAlignment;
+  baked->resize(offset, '\0');
+  baked->append(static_cast<const char *>(data), size);
+  return static_cast<uint32_t>(offset);
+}
+
+void Rail::Bake(const std::vector<vec3_packed> &positions,
+                float reliable_distance, float total_time,
+                std::string *baked) const {
+  assert(splines_ != nullptr);
+  BakedRailHeader header;
+  memset(&header, 0, sizeof(header));
+  baked->assign(sizeof(header), '\0');
+
+  memcpy(header.identifier, kBakedRailIdentifier, sizeof(header.identifier));
+  header.version = kBakedRailVersion;
+  header.spline_struct_size = sizeof(motive::CompactSpline);
+  header.segment_node_size = sizeof(SegmentNode);
+
+  header.reliable_distance = reliable_distance;
+  header.total_time = total_time;
+  header.wraps = wraps_ ? 1 : 0;
+  header.num_positions = static_cast<uint32_t>(positions.size());
+  header.positions_offset = AppendAligned(
+      positions.data(), positions.size() * sizeof(positions[0]), baked);
+
+  // The splines are laid out one after another, all the same size.
+  const size_t splines_size =
+      kDimensions * (reinterpret_cast<const uint8_t *>(Spline(1)) -
+                     reinterpret_cast<const uint8_t *>(Spline(0)));
+  header.splines_size = static_cast<uint32_t>(splines_size);
+  header.splines_offset = AppendAligned(splines_, splines_size, baked);
+
+  header.table_step = table_step_;
+  header.table_size = static_cast<uint32_t>(table_size_);
+  header.table_positions_offset = AppendAligned(
+      table_positions_, table_size_ * sizeof(table_positions_[0]), baked);
+  header.table_directions_offset = AppendAligned(
+      table_directions_, table_size_ * sizeof(table_directions_[0]), baked);
+  header.table_distances_offset = AppendAligned(
+      table_distances_, table_size_ * sizeof(table_distances_[0]), baked);
+  header.distance_step = distance_step_;
+  header.distance_size = static_cast<uint32_t>(distance_size_);
+  header.distance_times_offset = AppendAligned(
+      distance_times_, distance_size_ * sizeof(distance_times_[0]), baked);
+  header.segment_tree_size = static_cast<uint32_t>(segment_tree_size_);
+  header.segment_tree_offset = AppendAligned(
+      segment_tree_, segment_tree_size_ * sizeof(segment_tree_[0]), baked);
+
+  memcpy(&(*baked)[0], &header, sizeof(header));
+}
+
+bool Rail::InitializeFromBaked(const char *file_name,
+                               const std::vector<vec3_packed> &positions,
+                               float reliable_distance, float total_time,
+                               bool wraps) {
+  std::unique_ptr<MappedFile> file(new MappedFile());
+  if (!file->Open(file_name)) return false;
+  const uint8_t *data = file->data();
+  const size_t size = file->size();
+
+  BakedRailHeader header;
+  if (size < sizeof(header)) {
+    fplbase::LogError("Rail: %s is too short to be a baked rail", file_name);
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.identifier, kBakedRailIdentifier,
+             sizeof(header.identifier)) != 0 ||
+      header.version != kBakedRailVersion ||
+      header.spline_struct_size != sizeof(motive::CompactSpline) ||
+      header.segment_node_size != sizeof(SegmentNode)) {
+    fplbase::LogInfo("Rail: %s was baked by another version, refitting",
+                     file_name);
+    return false;
+  }
+
+  // Every array has to be aligned and inside the file.
+  auto in_file = [size](uint32_t offset, size_t count, size_t element_size) {
+    return offset % kBakedRailAlignment == 0 && offset <= size &&
+           count <= (size - offset) / element_size;
+  };
+  const size_t table_size = header.table_size;
+  if (!in_file(header.positions_offset, header.num_positions,
+               sizeof(vec3_packed)) ||
+      !in_file(header.splines_offset, header.splines_size, 1) ||
+      header.splines_size == 0 ||
+      !in_file(header.table_positions_offset, table_size,
+               sizeof(vec3_packed)) ||
+      !in_file(header.table_directions_offset, table_size,
+               sizeof(vec3_packed)) ||
+      !in_file(header.table_distances_offset, table_size, sizeof(float)) ||
+      !in_file(header.distance_times_offset, header.distance_size,
+               sizeof(float)) ||
+      !in_file(header.segment_tree_offset, header.segment_tree_size,
+               sizeof(SegmentNode)) ||
+      table_size == 1 || (table_size > 0) != (header.segment_tree_size > 0) ||
+      (header.distance_size > 0 && header.distance_size < 2)) {
+    fplbase::LogError("Rail: %s is corrupt", file_name);
+    return false;
+  }
+  const SegmentNode *segment_tree =
+      reinterpret_cast<const SegmentNode *>(data + header.segment_tree_offset);
+  for (uint32_t i = 0; i < header.segment_tree_size; ++i) {
+    const SegmentNode &node = segment_tree[i];
+    if (node.begin < 0 || node.begin >= node.end ||
+        static_cast<size_t>(node.end) >= table_size ||
+        (node.second_child >= 0 &&
+         (node.second_child <= static_cast<int32_t>(i) + 1 ||
+          static_cast<uint32_t>(node.second_child) >=
+              header.segment_tree_size))) {
+      fplbase::LogError("Rail: %s is corrupt", file_name);
+      return false;
+    }
+  }
+
+  // Only use the baked rail if it was fit to what we'd fit now.
+  bool same_inputs = header.num_positions == positions.size() &&
+                     header.wraps == (wraps ? 1u : 0u) &&
+                     header.reliable_distance == reliable_distance &&
+                     header.total_time == total_time;
+  const vec3_packed *baked_positions =
+      reinterpret_cast<const vec3_packed *>(data + header.positions_offset);
+  for (size_t i = 0; same_inputs && i < positions.size(); ++i) {
+    same_inputs = (vec3(baked_positions[i]) - vec3(positions[i]))
+                      .LengthSquared() <=
+                  kBakedRailPositionTolerance * kBakedRailPositionTolerance;
+  }
+  if (!same_inputs) {
+    fplbase::LogInfo("Rail: %s is out of date, refitting", file_name);
+    return false;
+  }
+
+  // The splines are only ever read once they're built.
+  splines_ = reinterpret_cast<motive::CompactSpline *>(
+      const_cast<uint8_t *>(data + header.splines_offset));
+  wraps_ = wraps;
+  table_step_ = header.table_step;
+  table_size_ = static_cast<int>(table_size);
+  table_positions_ = reinterpret_cast<const vec3_packed *>(
+      data + header.table_positions_offset);
+  table_directions_ = reinterpret_cast<const vec3_packed *>(
+      data + header.table_directions_offset);
+  table_distances_ =
+      reinterpret_cast<const float *>(data + header.table_distances_offset);
+  distance_step_ = header.distance_step;
+  distance_size_ = static_cast<int>(header.distance_size);
+  distance_times_ =
+      reinterpret_cast<const float *>(data + header.distance_times_offset);
+  segment_tree_size_ = static_cast<int>(header.segment_tree_size);
+  segment_tree_ = segment_tree;
+  baked_ = std::move(file);
+  return true;
+}
+
+float Rail::WrapOrClamp(float value, float end) const {
+  if (wraps_) {
+    value = std::fmod(value, end);
+    return value < 0.0f ? value + end : value;
+  }
+  return mathfu::Clamp(value, 0.0f, end);
+}
+
+// Return the index of the table sample at or before `time`, and set
+// `fraction` to how far `time` is from it towards the next sample.
+int Rail::TableIndex(float time, float *fraction) const {
+  const int last_segment = table_size_ - 2;
+  const float samples = WrapOrClamp(time, EndTime()) / table_step_;
+  const int index = std::min(static_cast<int>(samples), last_segment);
+  *fraction = samples - index;
+  return index;
+}
+
+vec3 Rail::PositionAtTime(float time) const {
+  if (table_size_ == 0) return mathfu::kZeros3f;
+  float fraction;
+  const int i = TableIndex(time, &fraction);
+  return vec3::Lerp(vec3(table_positions_[i]), vec3(table_positions_[i + 1]),
+                    fraction);
+}
+
+vec3 Rail::DirectionAtTime(float time) const {
+  if (table_size_ == 0) return mathfu::kAxisY3f;
+  float fraction;
+  const int i = TableIndex(time, &fraction);
+  const vec3 direction = vec3::Lerp(vec3(table_directions_[i]),
+                                    vec3(table_directions_[i + 1]), fraction);
+  const float length = direction.Length();
+  return length > 0.0f ? direction / length : vec3(table_directions_[i]);
+}
+
+float Rail::DistanceAtTime(float time) const {
+  if (table_size_ == 0) return 0.0f;
+  float fraction;
+  const int i = TableIndex(time, &fraction);
+  return mathfu::Lerp(table_distances_[i], table_distances_[i + 1], fraction);
+}
+
+float Rail::TimeAtDistance(float distance) const {
+  if (distance_size_ == 0) return 0.0f;
+  const int last_segment = distance_size_ - 2;
+  const float samples =
+      WrapOrClamp(distance, TotalDistance()) / distance_step_;
+  const int i = std::min(static_cast<int>(samples), last_segment);
+  return mathfu::Lerp(distance_times_[i], distance_times_[i + 1],
+                      samples - i);
+}
+
+static float BoxDistanceSquared(const vec3_packed &box_min,
+                                const vec3_packed &box_max,
+                                const vec3 &point) {
+  const vec3 nearest =
+      vec3::Max(vec3(box_min), vec3::Min(vec3(box_max), point));
+  return (nearest - point).LengthSquared();
+}
+
+static float SegmentDistanceSquared(const vec3_packed &segment_start,
+                                    const vec3_packed &segment_end,
+                                    const vec3 &point) {
+  const vec3 a(segment_start);
+  const vec3 ab = vec3(segment_end) - a;
+  const float length_sq = ab.LengthSquared();
+  const float fraction =
+      length_sq > 0.0f
+          ? mathfu::Clamp(vec3::DotProduct(point - a, ab) / length_sq, 0.0f,
+                          1.0f)
+          : 0.0f;
+  return (a + fraction * ab - point).LengthSquared();
+}
+
+// Visit the nearer child first, and skip nodes farther away than the closest
+// segment found so far.
+float Rail::ClosestTime(const vec3 &point, float *distance_sq) const {
+  float best_distance_sq = std::numeric_limits<float>::infinity();
+  int best_segment = 0;
+  float best_fraction = 0.0f;
+
+  // Nodes still to visit, and their distances from `point`, squared.
+  int stack_nodes[kMaxSegmentTreeDepth];
+  float stack_distances_sq[kMaxSegmentTreeDepth];
+  int depth = 0;
+  if (segment_tree_size_ > 0) {
+    stack_nodes[0] = 0;
+    stack_distances_sq[0] = BoxDistanceSquared(
+        segment_tree_[0].min, segment_tree_[0].max, point);
+    depth = 1;
+  }
+  while (depth > 0) {
+    --depth;
+    if (stack_distances_sq[depth] >= best_distance_sq) continue;
+    const int index = stack_nodes[depth];
+    const SegmentNode &node = segment_tree_[index];
+
+    if (node.second_child < 0) {
+      for (int s = node.begin; s < node.end; ++s) {
+        const vec3 a(table_positions_[s]);
+        const vec3 ab = vec3(table_positions_[s + 1]) - a;
+        const float length_sq = ab.LengthSquared();
+        const float fraction =
+            length_sq > 0.0f
+                ? mathfu::Clamp(vec3::DotProduct(point - a, ab) / length_sq,
+                                0.0f, 1.0f)
+                : 0.0f;
+        const float d_sq = (a + fraction * ab - point).LengthSquared();
+        if (d_sq < best_distance_sq) {
+          best_distance_sq = d_sq;
+          best_segment = s;
+          best_fraction = fraction;
+        }
+      }
+      continue;
+    }
+
+    // Push the farther child first, so the nearer is visited next.
+    int near_child = index + 1;
+    int far_child = node.second_child;
+    float near_sq = BoxDistanceSquared(segment_tree_[near_child].min,
+                                       segment_tree_[near_child].max, point);
+    float far_sq = BoxDistanceSquared(segment_tree_[far_child].min,
+                                      segment_tree_[far_child].max, point);
+    if (far_sq < near_sq) {
+      std::swap(near_child, far_child);
+      std::swap(near_sq, far_sq);
+    }
+    assert(depth + 2 <= kMaxSegmentTreeDepth);
+    stack_nodes[depth] = far_child;
+    stack_distances_sq[depth] = far_sq;
+    stack_nodes[depth + 1] = near_child;
+    stack_distances_sq[depth + 1] = near_sq;
+    depth += 2;
+  }
+
+  if (distance_sq != nullptr) *distance_sq = best_distance_sq;
+  return (best_segment + best_fraction) * table_step_;
+}
+
+// Skip nodes that are entirely out of reach. The first child is visited
+// before the second, so segments are found in order, and runs of them can be
+// joined as they're found.
+void Rail::TimesWithin(const vec3 &point, float radius,
+                       std::vector<motive::Range> *times) const {
+  times->clear();
+  const float radius_sq = radius * radius;
+  int run_begin = -1;
+  int run_end = -1;
+
+  int stack[kMaxSegmentTreeDepth];
+  int depth = 0;
+  if (segment_tree_size_ > 0) stack[depth++] = 0;
+  while (depth > 0) {
+    const int index = stack[--depth];
+    const SegmentNode &node = segment_tree_[index];
+    if (BoxDistanceSquared(node.min, node.max, point) > radius_sq) continue;
+
+    if (node.second_child >= 0) {
+      assert(depth + 2 <= kMaxSegmentTreeDepth);
+      stack[depth++] = node.second_child;
+      stack[depth++] = index + 1;
+      continue;
+    }
+
+    for (int s = node.begin; s < node.end; ++s) {
+      if (SegmentDistanceSquared(table_positions_[s], table_positions_[s + 1],
+                                 point) > radius_sq) {
+        continue;
+      }
+      if (s != run_end) {
+        if (run_begin >= 0) {
+          times->push_back(
+              motive::Range(run_begin * table_step_, run_end * table_step_));
+        }
+        run_begin = s;
+      }
+      run_end = s + 1;
+    }
+  }
+  if (run_begin >= 0) {
+    times->push_back(
+        motive::Range(run_begin * table_step_, run_end * table_step_));
+  }
+}
+
+float Rail::DistanceBetween(float start_time, float end_time) const {
+  float distance = DistanceAtTime(end_time) - DistanceAtTime(start_time);
+  if (wraps_ && distance < 0.0f) distance += TotalDistance();
+  return distance;
+}
+
+// FNV-1a over what the rail is fit to, rounded so that small differences in
+// how the positions were computed don't change it. scripts/build_assets.py
+// computes the same hash, to name the baked rails it writes.
+static std::string BakedRailFileName(const char *rail_name,
+                                     const std::vector<vec3_packed> &positions,
+                                     float reliable_distance,
+                                     float total_time, bool wraps) {
+  uint64_t hash = 14695981039346656037ull;
+  auto add = [&hash](float value) {
+    const uint32_t rounded = static_cast<uint32_t>(static_cast<int32_t>(
+        std::floor(static_cast<double>(value) * kBakedRailHashScale + 0.5)));
+    for (int i = 0; i < 4; ++i) {
+      hash = (hash ^ ((rounded >> (8 * i)) & 0xff)) * 1099511628211ull;
+    }
+  };
+  for (auto p = positions.begin(); p != positions.end(); ++p) {
+    const vec3 position(*p);
+    add(position.x);
+    add(position.y);
+    add(position.z);
+  }
+  add(reliable_distance);
+  add(total_time);
+  hash = (hash ^ (wraps ? 1u : 0u)) * 1099511628211ull;
+
+  char hash_string[17];
+  snprintf(hash_string, sizeof(hash_string), "%016llx",
+           static_cast<unsigned long long>(hash));
+  return std::string("rails/") + rail_name + "_" + hash_string + ".zoorail";
+}
+
+bool RailManager::BakeRail(const std::vector<vec3_packed> &positions,
+                           float reliable_distance, float total_time,
+                           bool wraps, const char *file_name) {
+  Rail rail;
+  rail.InitializeFromPositions(positions, kSplineGranularity,
+                               reliable_distance, total_time, wraps);
+  std::string baked;
+  rail.Bake(positions, reliable_distance, total_time, &baked);
+
+  FILE *file = fopen(file_name, "wb");
+  if (file == nullptr) {
+    fplbase::LogError("RailManager: can't write %s", file_name);
+    return false;
+  }
+  const bool ok = fwrite(baked.data(), 1, baked.size(), file) == baked.size();
+  if (fclose(file) != 0 || !ok) {
+    fplbase::LogError("RailManager: failed writing %s", file_name);
+    return false;
+  }
+  return true;
+}
+
 Rail *RailManager::GetRail(RailId rail_file) {
   if (rail_map.find(rail_file) == rail_map.end()) {
     // New rail, so we load it up:
@@ -114,12 +838,20 @@ Rail *RailManager::GetRail(RailId rail_file) {
 
 Rail *RailManager::GetRailFromComponents(const char *rail_name,
                                          corgi::EntityManager *entity_manager) {
-  std::map<float, corgi::EntityRef> rail_entities;
-
   auto *rail_component = entity_manager->GetComponent<RailNodeComponent>();
-  for (auto i = rail_component->begin(); i != rail_component->end(); ++i) {
-    if (i->data.rail_name == rail_name) {
-      rail_entities[i->data.ordering] = i->entity;
+  const int version = rail_component->RailVersion(rail_name);
+  auto cached_version = component_rail_versions.find(rail_name);
+  if (cached_version != component_rail_versions.end() &&
+      cached_version->second == version) {
+    return rail_map[rail_name].get();
+  }
+
+  std::map<float, corgi::EntityRef> rail_entities;
+  const std::vector<corgi::EntityRef> *nodes =
+      rail_component->RailNodes(rail_name);
+  if (nodes != nullptr) {
+    for (auto i = nodes->begin(); i != nodes->end(); ++i) {
+      rail_entities[rail_component->GetComponentData(*i)->ordering] = *i;
     }
   }
 
@@ -144,9 +876,13 @@ Rail *RailManager::GetRailFromComponents(const char *rail_name,
       entity_manager
           ->GetComponent<corgi::component_library::TransformComponent>();
   // map will sort by the key
+  std::vector<corgi::EntityRef> &ordered_nodes =
+      component_rail_nodes[rail_name];
+  ordered_nodes.clear();
   int i = 0;
   for (auto iter = rail_entities.begin(); iter != rail_entities.end(); ++iter) {
     positions[i++] = transform_component->WorldPosition(iter->second);
+    ordered_nodes.push_back(iter->second);
   }
   if (wraps) {
     // Repeat the first node at the end so we loop.
@@ -154,10 +890,16 @@ Rail *RailManager::GetRailFromComponents(const char *rail_name,
         transform_component->WorldPosition(rail_entities.begin()->second);
   }
 
-  // Create a new rail with the requested positions.
+  // Create a new rail with the requested positions, from the assets if it
+  // was baked when they were built.
   Rail *new_rail = new Rail();
-  new_rail->InitializeFromPositions(
-      positions, kSplineGranularity, reliable_distance, total_time, wraps);
+  const std::string baked_file = BakedRailFileName(
+      rail_name, positions, reliable_distance, total_time, wraps);
+  if (!new_rail->InitializeFromBaked(baked_file.c_str(), positions,
+                                     reliable_distance, total_time, wraps)) {
+    new_rail->InitializeFromPositions(
+        positions, kSplineGranularity, reliable_distance, total_time, wraps);
+  }
 
   // Update anything that may be using the old rail.
   auto old_rail = rail_map.find(rail_name);
@@ -167,12 +909,46 @@ Rail *RailManager::GetRailFromComponents(const char *rail_name,
     rail_denizen_component->ChangeRail(old_rail->second.get(), new_rail);
   }
 
-  // Cache this until we request the rail from these components again.
+  // Cache this until the rail's nodes change.
   rail_map[rail_name] = std::unique_ptr<Rail>(new_rail);
+  component_rail_versions[rail_name] = version;
   return new_rail;
 }
 
-void RailManager::Clear() { rail_map.clear(); }
+Rail *RailManager::RefitRailNode(const corgi::EntityRef &node,
+                                 corgi::EntityManager *entity_manager) {
+  auto *rail_component = entity_manager->GetComponent<RailNodeComponent>();
+  const RailNodeData *node_data = rail_component->GetComponentData(node);
+  if (node_data == nullptr) return nullptr;
+  const std::string &rail_name = node_data->rail_name;
+
+  // The rail can only be refit if nothing but the nodes' positions has
+  // changed since it was built.
+  auto cached_version = component_rail_versions.find(rail_name);
+  if (cached_version == component_rail_versions.end() ||
+      cached_version->second != rail_component->RailVersion(rail_name)) {
+    return nullptr;
+  }
+  const std::vector<corgi::EntityRef> &nodes = component_rail_nodes[rail_name];
+  auto found = std::find(nodes.begin(), nodes.end(), node);
+  if (found == nodes.end()) return nullptr;
+
+  auto *transform_component =
+      entity_manager
+          ->GetComponent<corgi::component_library::TransformComponent>();
+  Rail *rail = rail_map[rail_name].get();
+  if (!rail->RefitNode(static_cast<int>(found - nodes.begin()),
+                       transform_component->WorldPosition(node))) {
+    return nullptr;
+  }
+  return rail;
+}
+
+void RailManager::Clear() {
+  rail_map.clear();
+  component_rail_versions.clear();
+  component_rail_nodes.clear();
+}
 
 }  // zooshi
 }  // fpl
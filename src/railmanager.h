@@ -15,10 +15,14 @@
 #ifndef RAILMANAGER_H
 #define RAILMANAGER_H
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include "components_generated.h"
 #include "corgi/entity_manager.h"
+#include "mapped_file.h"
 #include "mathfu/glsl_mappings.h"
 #include "motive/math/compact_spline.h"
 #include "rail_def_generated.h"
@@ -30,8 +34,25 @@ typedef std::string RailId;
 
 class Rail {
  public:
-  Rail() : splines_(nullptr), wraps_(true) {}
-  ~Rail() { motive::CompactSpline::DestroyArray(splines_, kDimensions); }
+  Rail()
+      : splines_(nullptr),
+        wraps_(true),
+        table_step_(0.0f),
+        table_size_(0),
+        table_positions_(nullptr),
+        table_directions_(nullptr),
+        table_distances_(nullptr),
+        distance_step_(0.0f),
+        distance_size_(0),
+        distance_times_(nullptr),
+        segment_tree_size_(0),
+        segment_tree_(nullptr),
+        fit_reliable_distance_(0.0f),
+        fit_granularity_(0.0f) {}
+  ~Rail() {
+    // Baked splines live in the baked rail's memory.
+    if (!baked_) motive::CompactSpline::DestroyArray(splines_, kDimensions);
+  }
 
   void Initialize(const RailDef* rail_def, float spline_granularity);
 
@@ -49,6 +70,50 @@ class Rail {
   /// Length of the rail.
   float EndTime() const { return splines_->EndX(); }
 
+  /// The following are answered in constant time from a table of samples
+  /// taken when the rail is initialized, interpolating linearly between
+  /// them. They are much faster than PositionCalculatedSlowly(), and agree
+  /// with it to within a few centimeters. Times and distances past either
+  /// end are wrapped if the rail wraps, and clamped if it doesn't.
+
+  /// Return the rail position at `time`.
+  mathfu::vec3 PositionAtTime(float time) const;
+
+  /// Return the unit direction the rail is heading in at `time`.
+  mathfu::vec3 DirectionAtTime(float time) const;
+
+  /// Return the distance along the rail from its start to `time`.
+  float DistanceAtTime(float time) const;
+
+  /// Return the time at which the rail is `distance` along from its start.
+  float TimeAtDistance(float distance) const;
+
+  /// Return the distance along the rail from `start_time` forward to
+  /// `end_time`. On a rail that wraps, this goes around through the end if
+  /// `end_time` is before `start_time`. Otherwise it's negative.
+  float DistanceBetween(float start_time, float end_time) const;
+
+  /// Return the time at which the rail passes closest to `point`, and set
+  /// `distance_sq` to the square of the distance between them, if it's not
+  /// null. The rail is treated as straight between the lookup table's
+  /// samples. Answered from a bounding box tree over those segments, so
+  /// only the segments near `point` are tested.
+  float ClosestTime(const mathfu::vec3& point, float* distance_sq) const;
+
+  /// Set `times` to the spans of time, in order, during which the rail
+  /// passes within `radius` of `point`. The rail is treated as straight
+  /// between the lookup table's samples, and each span covers whole segments
+  /// between them, so it may start a little early and end a little late.
+  /// Answered from a bounding box tree over those segments, so only the
+  /// segments near `point` are tested.
+  void TimesWithin(const mathfu::vec3& point, float radius,
+                   std::vector<motive::Range>* times) const;
+
+  /// Distance along the whole rail.
+  float TotalDistance() const {
+    return table_size_ == 0 ? 0.0f : table_distances_[table_size_ - 1];
+  }
+
   /// Internal structure representing the rails.
   const motive::CompactSpline* Splines() const { return splines_; }
 
@@ -57,12 +122,53 @@ class Rail {
       float spline_granularity, float reliable_distance, float total_time,
       bool wraps);
 
+  /// Move the position at `index` of those the rail was fit to, and refit
+  /// only the part of the rail near it. The positions further away keep their
+  /// times, so anything following the rail keeps its place along it, but the
+  /// rail only keeps a constant speed within the refit part until it's next
+  /// fit from scratch. On a rail that wraps, the first position is also the
+  /// last. Fails, leaving the rail as it was, if the rail was baked or the
+  /// new position is outside the range its splines can represent.
+  bool RefitNode(int index, const mathfu::vec3& position);
+
+  /// Set `baked` to the rail, with everything derived from it, as a baked
+  /// rail. `positions`, `reliable_distance` and `total_time` are what the rail
+  /// was initialized from, and are recorded so that a stale baked rail can be
+  /// detected when it's loaded.
+  void Bake(const std::vector<mathfu::vec3_packed>& positions,
+            float reliable_distance, float total_time,
+            std::string* baked) const;
+
+  /// Use the rail baked into `file_name`, in place, instead of fitting one.
+  /// Fails if the file is missing or unreadable, or if it wasn't baked from
+  /// these arguments to InitializeFromPositions(), and leaves the rail
+  /// uninitialized.
+  bool InitializeFromBaked(const char* file_name,
+                           const std::vector<mathfu::vec3_packed>& positions,
+                           float reliable_distance, float total_time,
+                           bool wraps);
+
   /// Does the rail wrap around to itself at the end.
   bool wraps() const { return wraps_; }
 
  private:
   static const motive::MotiveDimension kDimensions = 3;
 
+  void FitSplines();
+  void RefitWindow(int index);
+  void BuildLookupTable(int num_samples);
+  void RefitLookupTable(int index);
+  void SamplePositions(int begin, int end);
+  void SampleDirections(int begin, int end);
+  void SampleDistances(int begin);
+  bool InvertDistances();
+  int BuildSegmentTree(int begin, int end);
+  void RefitSegmentTree(int index, int first_sample, int last_sample);
+  void BoundSegments(int index);
+  void UseBuiltTables();
+  float WrapOrClamp(float value, float end) const;
+  int TableIndex(float time, float* fraction) const;
+
   motive::CompactSpline* Spline(int idx) { return splines_->NextAtIdx(idx); }
   const motive::CompactSpline* Spline(int idx) const {
     return const_cast<Rail*>(this)->Spline(idx);
@@ -73,6 +179,57 @@ class Rail {
 
   // Does the rail wrap around to itself at the end.
   bool wraps_;
+
+  // A bounding box tree over the lookup table's segments, in depth first
+  // order. Segment `s` joins samples `s` and `s + 1`. Each node bounds the
+  // segments in [begin, end); its first child follows it, and `second_child`
+  // is the index of the other. Leaves have no children.
+  struct SegmentNode {
+    mathfu::vec3_packed min;
+    mathfu::vec3_packed max;
+    int32_t begin;
+    int32_t end;
+    int32_t second_child;
+  };
+
+  // The tables below point either into the `built_` vectors, or into the
+  // baked rail's memory.
+
+  // The rail sampled every `table_step_` of time: its position, unit
+  // direction, and the distance along it from the start.
+  float table_step_;
+  int table_size_;
+  const mathfu::vec3_packed* table_positions_;
+  const mathfu::vec3_packed* table_directions_;
+  const float* table_distances_;
+
+  // The time at every `distance_step_` of distance along the rail, so that
+  // TimeAtDistance() doesn't have to search `table_distances_`.
+  float distance_step_;
+  int distance_size_;
+  const float* distance_times_;
+
+  int segment_tree_size_;
+  const SegmentNode* segment_tree_;
+
+  std::vector<mathfu::vec3_packed> built_positions_;
+  std::vector<mathfu::vec3_packed> built_directions_;
+  std::vector<float> built_distances_;
+  std::vector<float> built_distance_times_;
+  std::vector<SegmentNode> built_segment_tree_;
+
+  // What InitializeFromPositions() fit the splines to, so that RefitNode()
+  // can refit part of them. A node's derivative depends on its neighbors, so
+  // refitting one changes the curve on either side of it.
+  std::vector<mathfu::vec3_packed> fit_positions_;
+  std::vector<float> fit_times_;
+  std::vector<mathfu::vec3_packed> fit_derivatives_;
+  std::vector<motive::Range> fit_ranges_;
+  float fit_reliable_distance_;
+  float fit_granularity_;
+
+  // The file the rail was baked into, if it was loaded from one.
+  std::unique_ptr<MappedFile> baked_;
 };
 
 // Class for handling loading and storing of rails.
@@ -84,13 +241,38 @@ class RailManager {
   Rail* GetRail(RailId rail_file);
 
   // Returns the data for a rail specified by RailNodeComponent entities.
+  // The rail is cached, and only rebuilt once its RailNodes have changed.
   Rail* GetRailFromComponents(const char* rail_name,
                               corgi::EntityManager* entity_manager);
 
+  // Refit the part of the rail `node` belongs to near it, after the node has
+  // moved, with Rail::RefitNode(). Returns the rail, which is changed in
+  // place, or null if it has to be rebuilt from scratch by
+  // GetRailFromComponents() instead, such as when its nodes have been added,
+  // removed or reordered since it was built.
+  Rail* RefitRailNode(const corgi::EntityRef& node,
+                      corgi::EntityManager* entity_manager);
+
   void Clear();
 
+  // Fit a rail to `positions` as GetRailFromComponents() does, and write it
+  // to `file_name` as a baked rail. GetRailFromComponents() uses the baked
+  // rail instead of fitting one if it's in the assets under the name that
+  // scripts/build_assets.py gives it.
+  static bool BakeRail(const std::vector<mathfu::vec3_packed>& positions,
+                       float reliable_distance, float total_time, bool wraps,
+                       const char* file_name);
+
  private:
   std::unordered_map<RailId, std::unique_ptr<Rail>> rail_map;
+
+  // The RailNodeComponent::RailVersion() each rail in `rail_map` was built
+  // from, for those built from components.
+  std::unordered_map<RailId, int> component_rail_versions;
+
+  // The RailNodes each rail built from components was fit to, in order.
+  std::unordered_map<RailId, std::vector<corgi::EntityRef>>
+      component_rail_nodes;
 };
 
 }  // zooshi
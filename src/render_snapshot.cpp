@@ -0,0 +1,50 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "render_snapshot.h"
+
+namespace fpl {
+namespace zooshi {
+
+void RenderSnapshot::Clear() {
+  for (int pass = 0; pass < corgi::RenderPass_Count; ++pass) {
+    passes[pass].clear();
+  }
+  bones.clear();
+  texts.clear();
+}
+
+RenderSnapshotBuffer::RenderSnapshotBuffer()
+    : back_(0), front_(1), ready_(2), has_front_(false) {}
+
+void RenderSnapshotBuffer::Publish() {
+  // Release so the reader sees the snapshot's contents, acquire so we don't
+  // start writing into the old ready slot before the reader is done with it.
+  const int previous =
+      ready_.exchange(back_ | kFreshBit, std::memory_order_acq_rel);
+  back_ = previous & ~kFreshBit;
+}
+
+RenderSnapshot* RenderSnapshotBuffer::AcquireFront() {
+  if (ready_.load(std::memory_order_relaxed) & kFreshBit) {
+    // Only the reader clears the fresh bit, so it's still set here.
+    const int previous = ready_.exchange(front_, std::memory_order_acq_rel);
+    front_ = previous & ~kFreshBit;
+    has_front_ = true;
+  }
+  return has_front_ ? &snapshots_[front_] : nullptr;
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,187 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_RENDER_SNAPSHOT_H_
+#define ZOOSHI_RENDER_SNAPSHOT_H_
+
+#include <atomic>
+#include <vector>
+
+#include "camera.h"
+#include "components/light.h"
+#include "components/render_3d_text.h"
+#include "components_generated.h"
+#include "corgi_component_library/rendermesh.h"
+#include "fplbase/mesh.h"
+#include "full_screen_fader.h"
+#include "fplbase/shader.h"
+#include "mathfu/glsl_mappings.h"
+#include "mathfu/utilities.h"
+
+namespace fpl {
+namespace zooshi {
+
+// The #defines that can be applied to a shader.
+enum ShaderDefines {
+  kPhongShading,
+  kSpecularEffect,
+  kShadowEffect,
+  kNormalMaps,
+  kNumShaderDefines
+};
+
+// Different rendering modes can have different values for shader defines.
+enum RenderingMode {
+  kRenderingMonoscopic,
+  kRenderingStereoscopic,
+  kNumRenderingModes
+};
+
+// One mesh to draw, with everything RenderMeshComponent would otherwise read
+// out of the entity's components at render time.
+struct RenderSnapshotDraw {
+  fplbase::Mesh* mesh;
+
+  // Indexed by ShaderIndex. nullptr if the mesh has no shader for that pass.
+  fplbase::Shader* shaders[ShaderIndex_Count];
+
+  // Entity world transform, with single-bone animations already applied.
+  mathfu::mat4 world_transform;
+
+  mathfu::vec4 tint;
+
+  // Squared distance from the camera. Used to sort the render passes.
+  float z_depth;
+
+  // World space bounds of the mesh, when they are known. A draw with bounds is
+  // skipped by any camera, including the shadow map's, that can't see them.
+  bool has_bounds;
+  mathfu::vec3 bounds_min;
+  mathfu::vec3 bounds_max;
+
+  // Range of this draw's skinning transforms in RenderSnapshot::bones.
+  // bone_count is 0 when the mesh isn't skinned.
+  int bone_offset;
+  int bone_count;
+};
+
+// A Render3dTextComponent label, positioned in world space.
+struct RenderSnapshotText {
+  // Model transform of the label. Multiply by the camera to get its MVP.
+  mathfu::mat4 model;
+  Render3dTextData data;
+};
+
+// Everything the render thread needs to draw one frame of the world. Filled
+// in by WorldRenderer::RenderPrep() on the update thread, so that rendering
+// never has to touch live entity data.
+struct RenderSnapshot {
+  typedef std::vector<RenderSnapshotDraw,
+                      mathfu::simd_allocator<RenderSnapshotDraw>> DrawList;
+  typedef std::vector<mathfu::AffineTransform,
+                      mathfu::simd_allocator<mathfu::AffineTransform>>
+      BoneList;
+  typedef std::vector<RenderSnapshotText,
+                      mathfu::simd_allocator<RenderSnapshotText>> TextList;
+
+  RenderSnapshot()
+      : mesh_light_position(mathfu::kZeros3f),
+        shadow_light_position(mathfu::kZeros3f),
+        river_offset(0.0f),
+        rendering_mode(kRenderingMonoscopic),
+        rendering_options_version(0),
+        skip_rendermesh_rendering(false),
+        draw_debug_physics(false) {
+    for (int s = 0; s < kNumShaderDefines; ++s) rendering_options[s] = false;
+  }
+
+  // Empty the lists, keeping their memory for the next frame.
+  void Clear();
+
+  // The camera the snapshot was culled against.
+  Camera camera;
+
+  // Visible meshes for each corgi::RenderPass, sorted the way
+  // RenderMeshComponent sorts them.
+  DrawList passes[corgi::RenderPass_Count];
+
+  // Skinning transforms for every skinned mesh in `passes`.
+  BoneList bones;
+
+  TextList texts;
+
+  // Light position used to shade meshes.
+  mathfu::vec3 mesh_light_position;
+
+  // Position of the main light entity, which the shadow map is rendered from.
+  mathfu::vec3 shadow_light_position;
+
+  // Lighting parameters of the main light entity.
+  LightData light;
+
+  float river_offset;
+
+  // The world's rendering mode, and the options enabled in it, indexed by
+  // ShaderDefines. The version changes whenever the options do, so that the
+  // render thread knows to rebuild its shaders.
+  RenderingMode rendering_mode;
+  bool rendering_options[kNumShaderDefines];
+  int rendering_options_version;
+
+  // The world's debug switches.
+  bool skip_rendermesh_rendering;
+  bool draw_debug_physics;
+
+  // The fading overlay drawn over the world.
+  FullScreenFaderState fader;
+
+  MATHFU_DEFINE_CLASS_SIMD_AWARE_NEW_DELETE
+};
+
+// Hands RenderSnapshots from the update thread to the render thread without
+// locking. Three snapshots rotate between the writer, which fills back(), the
+// reader, which draws the one returned by AcquireFront(), and a ready slot
+// holding the most recently published snapshot. Each side swaps its snapshot
+// with the ready slot in a single atomic exchange, so neither ever waits on
+// the other, and the reader always gets the newest complete snapshot.
+class RenderSnapshotBuffer {
+ public:
+  RenderSnapshotBuffer();
+
+  // The snapshot being filled in. Writer only.
+  RenderSnapshot& back() { return snapshots_[back_]; }
+
+  // Make back() available to the reader, and start a new back().
+  void Publish();
+
+  // Switch to the newest published snapshot, if there is one the reader
+  // hasn't seen. Returns nullptr until the first snapshot is published. The
+  // result stays valid until the next call. Reader only.
+  RenderSnapshot* AcquireFront();
+
+ private:
+  // Set in `ready_` when it holds a snapshot the reader hasn't acquired.
+  static const int kFreshBit = 4;
+
+  RenderSnapshot snapshots_[3];
+  int back_;
+  int front_;
+  std::atomic<int> ready_;
+  bool has_front_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_RENDER_SNAPSHOT_H_
@@ -135,9 +135,8 @@ void GameMenuState::Initialize(
   UpdateVolumes();
 }
 
-void GameMenuState::AdvanceFrame(int delta_time, int *next_state) {
-  world_->entity_manager.UpdateComponents(delta_time);
-  UpdateMainCamera(&main_camera_, world_);
+void GameMenuState::HandleInput(int * /*next_state*/) {
+  world_->player_component.HandleInput();
 
   bool back_button =
       input_system_->GetButton(fplbase::FPLK_ESCAPE).went_down() ||
@@ -161,6 +160,11 @@ void GameMenuState::AdvanceFrame(int delta_time, int *next_state) {
       menu_state_ = kMenuStateStart;
     }
   }
+}
+
+void GameMenuState::AdvanceFrame(int delta_time, int *next_state) {
+  world_->UpdateComponents(delta_time);
+  UpdateMainCamera(&main_camera_, world_);
 
   if (menu_state_ == kMenuStateStart) {
     world_->SetRenderingMode(kRenderingMonoscopic);
@@ -204,6 +208,10 @@ void GameMenuState::RenderPrep() {
   world_->world_renderer->RenderPrep(main_camera_, world_);
 }
 
+void GameMenuState::SaveInterpolationState() {
+  world_->world_renderer->SaveInterpolationState(main_camera_, world_);
+}
+
 void GameMenuState::Render(fplbase::Renderer *renderer) {
   // Ensure assets are instantiated after they've been loaded.
   // This must be called from the render thread.
@@ -213,7 +221,7 @@ void GameMenuState::Render(fplbase::Renderer *renderer) {
 #if FPLBASE_ANDROID_VR
   cardboard_camera = &cardboard_camera_;
 #endif
-  RenderWorld(*renderer, world_, main_camera_, cardboard_camera, input_system_);
+  RenderWorld(*renderer, world_, cardboard_camera, input_system_);
 }
 
 void GameMenuState::HandleUI(fplbase::Renderer *renderer) {
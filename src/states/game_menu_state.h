@@ -97,7 +97,9 @@ class GameMenuState : public StateNode {
                   pindrop::AudioEngine* audio_engine, FullScreenFader* fader);
 
   virtual void AdvanceFrame(int delta_time, int* next_state);
+  virtual void HandleInput(int* next_state);
   virtual void RenderPrep();
+  virtual void SaveInterpolationState();
   virtual void Render(fplbase::Renderer* renderer);
   virtual void HandleUI(fplbase::Renderer* renderer);
   virtual void OnEnter(int previous_state);
@@ -75,9 +75,13 @@ void GameOverState::Initialize(fplbase::InputSystem* input_system, World* world,
 #endif
 }
 
-void GameOverState::AdvanceFrame(int delta_time, int* next_state) {
-  world_->entity_manager.UpdateComponents(delta_time);
+void GameOverState::AdvanceFrame(int delta_time, int* /*next_state*/) {
+  world_->UpdateComponents(delta_time);
   UpdateMainCamera(&main_camera_, world_);
+}
+
+void GameOverState::HandleInput(int* next_state) {
+  world_->player_component.HandleInput();
 
   // Return to the title screen after any key is hit.
   static const corgi::WorldTime kMinTimeInEndState =
@@ -111,12 +115,16 @@ void GameOverState::RenderPrep() {
   world_->world_renderer->RenderPrep(main_camera_, world_);
 }
 
+void GameOverState::SaveInterpolationState() {
+  world_->world_renderer->SaveInterpolationState(main_camera_, world_);
+}
+
 void GameOverState::Render(fplbase::Renderer* renderer) {
   Camera* cardboard_camera = nullptr;
 #if FPLBASE_ANDROID_VR
   cardboard_camera = &cardboard_camera_;
 #endif
-  RenderWorld(*renderer, world_, main_camera_, cardboard_camera, input_system_);
+  RenderWorld(*renderer, world_, cardboard_camera, input_system_);
 }
 
 void GameOverState::OnEnter(int /*previous_state*/) {
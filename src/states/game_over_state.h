@@ -37,8 +37,11 @@ class GameOverState : public StateNode {
                   GPGManager* gpg_manager_, pindrop::AudioEngine* audio_engine);
 
   virtual void AdvanceFrame(int delta_time, int* next_state);
+  virtual void HandleInput(int* next_state);
   virtual void RenderPrep();
+  virtual void SaveInterpolationState();
   virtual void Render(fplbase::Renderer* renderer);
+  virtual bool RendersConcurrently() const { return true; }
   virtual void OnEnter(int previous_state);
   virtual void OnExit(int next_state);
 
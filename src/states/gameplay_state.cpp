@@ -18,6 +18,7 @@
 
 #include "mathfu/internal/disable_warnings_end.h"
 
+#include "allocation_tracker.h"
 #include "fplbase/asset_manager.h"
 #include "fplbase/input.h"
 #include "full_screen_fader.h"
@@ -87,12 +88,26 @@ static void UpdateMusic(corgi::EntityManager* entity_manager, int* previous_lap,
 
 void GameplayState::AdvanceFrame(int delta_time, int* next_state) {
   // Update the world.
-  world_->entity_manager.UpdateComponents(delta_time);
+  world_->UpdateComponents(delta_time);
   UpdateMainCamera(&main_camera_, world_);
   UpdateMusic(&world_->entity_manager, &previous_lap_, &percent_, delta_time,
               &music_channel_lap_1_, &music_channel_lap_2_,
               &music_channel_lap_3_);
 
+  // The state machine for the world may request a state change.
+  *next_state = requested_state_;
+
+  // Switch back to scene lab if we're single stepping.
+  if (scene_lab_ && world_->is_single_stepping) {
+    *next_state = kGameStateSceneLab;
+    world_->is_single_stepping = false;
+  }
+  fader_->AdvanceFrame(delta_time);
+}
+
+void GameplayState::HandleInput(int* next_state) {
+  world_->player_component.HandleInput();
+
   if (input_system_->GetButton(fplbase::FPLK_F9).went_down()) {
     world_->draw_debug_physics = !world_->draw_debug_physics;
   }
@@ -100,23 +115,15 @@ void GameplayState::AdvanceFrame(int delta_time, int* next_state) {
     world_->skip_rendermesh_rendering = !world_->skip_rendermesh_rendering;
   }
 
-  // The state machine for the world may request a state change.
-  *next_state = requested_state_;
-
   // Switch into scene lab if the keyboard requests.
-  // Switch back to scene lab if we're single stepping.
   if (scene_lab_ && (input_system_->GetButton(fplbase::FPLK_F10).went_down() ||
-                     input_system_->GetButton(fplbase::FPLK_1).went_down() ||
-                     world_->is_single_stepping)) {
-    if (!world_->is_single_stepping) {
-      scene_lab::GenericCamera camera;
-      camera.position = main_camera_.position();
-      camera.facing = main_camera_.facing();
-      camera.up = main_camera_.up();
-      scene_lab_->SetInitialCamera(camera);
-    }
+                     input_system_->GetButton(fplbase::FPLK_1).went_down())) {
+    scene_lab::GenericCamera camera;
+    camera.position = main_camera_.position();
+    camera.facing = main_camera_.facing();
+    camera.up = main_camera_.up();
+    scene_lab_->SetInitialCamera(camera);
     *next_state = kGameStateSceneLab;
-    world_->is_single_stepping = false;
   }
 
   // Pause the game.
@@ -125,11 +132,14 @@ void GameplayState::AdvanceFrame(int delta_time, int* next_state) {
     audio_engine_->PlaySound(sound_pause_);
     *next_state = kGameStatePause;
   }
-  fader_->AdvanceFrame(delta_time);
 }
 
 void GameplayState::RenderPrep() {
-  world_->world_renderer->RenderPrep(main_camera_, world_);
+  world_->world_renderer->RenderPrep(main_camera_, world_, fader_);
+}
+
+void GameplayState::SaveInterpolationState() {
+  world_->world_renderer->SaveInterpolationState(main_camera_, world_);
 }
 
 void GameplayState::Render(fplbase::Renderer* renderer) {
@@ -138,11 +148,12 @@ void GameplayState::Render(fplbase::Renderer* renderer) {
 #if FPLBASE_ANDROID_VR
   cardboard_camera = &cardboard_camera_;
 #endif
-  RenderWorld(*renderer, world_, main_camera_, cardboard_camera, input_system_);
-  if (!fader_->Finished()) {
+  const RenderSnapshot* snapshot =
+      RenderWorld(*renderer, world_, cardboard_camera, input_system_);
+  if (snapshot != nullptr && snapshot->fader.visible) {
     renderer->set_model_view_projection(
         mathfu::mat4::Ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f));
-    fader_->Render(renderer);
+    fader_->Render(renderer, snapshot->fader);
   }
 }
 
@@ -186,6 +197,10 @@ void GameplayState::OnEnter(int previous_state) {
   input_system_->SetRelativeMouseMode(true);
   UpdateMainCamera(&main_camera_, world_);
 
+  // Measure allocations from the start of each stretch of gameplay, since
+  // menus and loading are expected to allocate.
+  AllocationTrackerReset();
+
   // Assign textures for the onscreen controller.
   auto* onscreen_controller_ui = &world_->onscreen_controller_ui;
   auto* asset_manager = world_->asset_manager;
@@ -52,8 +52,11 @@ class GameplayState : public StateNode {
                   pindrop::AudioEngine* audio_engine, FullScreenFader* fader);
 
   virtual void AdvanceFrame(int delta_time, int* next_state);
+  virtual void HandleInput(int* next_state);
   virtual void RenderPrep();
+  virtual void SaveInterpolationState();
   virtual void Render(fplbase::Renderer* renderer);
+  virtual bool RendersConcurrently() const { return true; }
   virtual void HandleUI(fplbase::Renderer* renderer);
   virtual void OnEnter(int previous_state);
   virtual void OnExit(int next_state);
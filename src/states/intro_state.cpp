@@ -64,7 +64,7 @@ void IntroState::SetBoxVisibility(bool visibility) {
 
 void IntroState::AdvanceFrame(int delta_time, int* next_state) {
   // Update components so that the player can throw sushi.
-  world_->entity_manager.UpdateComponents(delta_time);
+  world_->UpdateComponents(delta_time);
   // Update camera so that the player can look around.
   UpdateMainCamera(&main_camera_, world_);
 
@@ -92,12 +92,6 @@ void IntroState::AdvanceFrame(int delta_time, int* next_state) {
     fade_timer_ -= delta_time;
   }
 
-  // Go back to menu.
-  if (input_system_->GetButton(fplbase::FPLK_ESCAPE).went_down() ||
-      input_system_->GetButton(fplbase::FPLK_AC_BACK).went_down()) {
-    *next_state = kGameStateGameMenu;
-  }
-
   if (fader_->AdvanceFrame(delta_time)) {
     SetBoxVisibility(false);
     // Enter the game.
@@ -105,8 +99,22 @@ void IntroState::AdvanceFrame(int delta_time, int* next_state) {
   }
 }
 
+void IntroState::HandleInput(int* next_state) {
+  world_->player_component.HandleInput();
+
+  // Go back to menu.
+  if (input_system_->GetButton(fplbase::FPLK_ESCAPE).went_down() ||
+      input_system_->GetButton(fplbase::FPLK_AC_BACK).went_down()) {
+    *next_state = kGameStateGameMenu;
+  }
+}
+
 void IntroState::RenderPrep() {
-  world_->world_renderer->RenderPrep(main_camera_, world_);
+  world_->world_renderer->RenderPrep(main_camera_, world_, fader_);
+}
+
+void IntroState::SaveInterpolationState() {
+  world_->world_renderer->SaveInterpolationState(main_camera_, world_);
 }
 
 void IntroState::Render(fplbase::Renderer* renderer) {
@@ -114,11 +122,12 @@ void IntroState::Render(fplbase::Renderer* renderer) {
 #if FPLBASE_ANDROID_VR
   cardboard_camera = &cardboard_camera_;
 #endif  // FPLBASE_ANDROID_VR
-  RenderWorld(*renderer, world_, main_camera_, cardboard_camera, input_system_);
-  if (!fader_->Finished()) {
+  const RenderSnapshot* snapshot =
+      RenderWorld(*renderer, world_, cardboard_camera, input_system_);
+  if (snapshot != nullptr && snapshot->fader.visible) {
     renderer->set_model_view_projection(
           mat4::Ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f));
-    fader_->Render(renderer);
+    fader_->Render(renderer, snapshot->fader);
   }
 }
 
@@ -134,6 +143,7 @@ void IntroState::OnEnter(int /*previous_state*/) {
       world_->entity_manager.GetComponentData<TransformData>(player);
   // TODO(proppy): get position of the introbox entity
   player_transform->position += mathfu::vec3(0, 0, 500);
+  world_->world_renderer->SnapInterpolation(player, world_);
   fade_timer_ = kFadeTimerPending;
   SetBoxVisibility(true);
   master_bus_.FadeTo(0.0f, kFadeWaitTime / 1000.0f);
@@ -145,6 +155,7 @@ void IntroState::OnExit(int /*next_state*/) {
   auto player_transform =
       world_->entity_manager.GetComponentData<TransformData>(player);
   player_transform->position = mathfu::vec3(0, 0, 0);
+  world_->world_renderer->SnapInterpolation(player, world_);
   master_bus_.FadeTo(1.0f, kFadeWaitTime / 1000.0f);
 }
 
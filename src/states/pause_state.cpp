@@ -56,26 +56,27 @@ void PauseState::AdvanceFrame(int /*delta_time*/, int *next_state) {
   UpdateMainCamera(&main_camera_, world_);
 
   *next_state = next_state_;
+  if (*next_state == kGameStateGameplay) {
+    audio_engine_->PlaySound(sound_continue_);
+  } else if (*next_state == kGameStateGameMenu) {
+    world_->SetRenderingMode(kRenderingMonoscopic);
+    audio_engine_->PlaySound(sound_exit_);
+  }
 
+  next_state_ = kGameStatePause;
+}
+
+void PauseState::HandleInput(int * /*next_state*/) {
   // Unpause
   if (input_system_->GetButton(fplbase::FPLK_p).went_down()) {
-    *next_state = kGameStateGameplay;
+    next_state_ = kGameStateGameplay;
   }
 
   // Exit the game.
   if (input_system_->GetButton(fplbase::FPLK_ESCAPE).went_down() ||
       input_system_->GetButton(fplbase::FPLK_AC_BACK).went_down()) {
-    *next_state = kGameStateGameMenu;
+    next_state_ = kGameStateGameMenu;
   }
-
-  if (*next_state == kGameStateGameplay) {
-    audio_engine_->PlaySound(sound_continue_);
-  } else if (*next_state == kGameStateGameMenu) {
-    world_->SetRenderingMode(kRenderingMonoscopic);
-    audio_engine_->PlaySound(sound_exit_);
-  }
-
-  next_state_ = kGameStatePause;
 }
 
 GameState PauseState::PauseMenu(fplbase::AssetManager &assetman,
@@ -124,21 +125,31 @@ void PauseState::RenderPrep() {
   world_->world_renderer->RenderPrep(main_camera_, world_);
 }
 
+void PauseState::SaveInterpolationState() {
+  world_->world_renderer->SaveInterpolationState(main_camera_, world_);
+}
+
 void PauseState::Render(fplbase::Renderer *renderer) {
   Camera *cardboard_camera = nullptr;
 #if FPLBASE_ANDROID_VR
   cardboard_camera = &cardboard_camera_;
 #endif
-  RenderWorld(*renderer, world_, main_camera_, cardboard_camera, input_system_);
+  RenderWorld(*renderer, world_, cardboard_camera, input_system_);
 }
 
 void PauseState::HandleUI(fplbase::Renderer *renderer) {
   // No culling when drawing the menu.
   renderer->SetCulling(fplbase::kCullingModeNone);
-  next_state_ = PauseMenu(*asset_manager_, *font_manager_, *input_system_);
+  // Keep a choice until an update acts on it, even if the menu is drawn
+  // again first.
+  const GameState choice =
+      PauseMenu(*asset_manager_, *font_manager_, *input_system_);
+  if (choice != kGameStatePause) next_state_ = choice;
 }
 
 void PauseState::OnEnter(int /*previous_state*/) {
+  // Drop any choice made on a menu drawn after the last pause ended.
+  next_state_ = kGameStatePause;
   world_->player_component.set_state(kPlayerState_Disabled);
   input_system_->SetRelativeMouseMode(false);
   UpdateMainCamera(&main_camera_, world_);
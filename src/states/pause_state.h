@@ -38,8 +38,11 @@ class PauseState : public StateNode {
                   flatui::FontManager* font_manager,
                   pindrop::AudioEngine* audio_engine);
   virtual void AdvanceFrame(int delta_time, int* next_state);
+  virtual void HandleInput(int* next_state);
   virtual void RenderPrep();
+  virtual void SaveInterpolationState();
   virtual void Render(fplbase::Renderer* renderer);
+  virtual bool RendersConcurrently() const { return true; }
   virtual void HandleUI(fplbase::Renderer* renderer);
   virtual void OnEnter(int previous_state);
 
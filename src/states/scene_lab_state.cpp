@@ -49,6 +49,12 @@ void SceneLabState::Initialize(fplbase::Renderer* renderer,
 
 void SceneLabState::AdvanceFrame(corgi::WorldTime delta_time, int* next_state) {
   scene_lab_->AdvanceFrame(delta_time);
+  if (scene_lab_->IsReadyToExit()) {
+    *next_state = kGameStateGameplay;
+  }
+}
+
+void SceneLabState::HandleInput(int* next_state) {
   if (input_system_->GetButton(fplbase::FPLK_F11).went_down()) {
     scene_lab_->SaveScene();
   }
@@ -57,9 +63,6 @@ void SceneLabState::AdvanceFrame(corgi::WorldTime delta_time, int* next_state) {
       input_system_->GetButton(fplbase::FPLK_ESCAPE).went_down()) {
     scene_lab_->RequestExit();
   }
-  if (scene_lab_->IsReadyToExit()) {
-    *next_state = kGameStateGameplay;
-  }
   if (input_system_->GetButton(fplbase::FPLK_F7).went_down()) {
     *next_state = kGameStateGameplay;
     world_->is_single_stepping = true;
@@ -73,26 +76,31 @@ void SceneLabState::AdvanceFrame(corgi::WorldTime delta_time, int* next_state) {
 }
 
 void SceneLabState::RenderPrep() {
-  const corgi::CameraInterface* camera = corgi_adapter_->GetCorgiCamera();
-  world_->world_renderer->RenderPrep(*camera, world_);
+  // Scene Lab also uses the camera to pick entities, so keep it in sync with
+  // the window, not just the snapshot's copy.
+  camera_->set_viewport_resolution(vec2(renderer_->window_size()));
+  world_->world_renderer->RenderPrep(*camera_, world_);
 }
 
-void SceneLabState::Render(fplbase::Renderer* renderer) {
-  camera_->set_viewport_resolution(vec2(renderer->window_size()));
+void SceneLabState::SaveInterpolationState() {
+  world_->world_renderer->SaveInterpolationState(*camera_, world_);
+}
 
-  const auto camera = corgi_adapter_->GetCorgiCamera();
+void SceneLabState::Render(fplbase::Renderer* renderer) {
+  RenderSnapshot* snapshot = world_->world_renderer->AcquireSnapshot();
+  if (snapshot == nullptr) return;
+  Camera& camera = snapshot->camera;
+  camera.set_viewport_resolution(vec2(renderer->window_size()));
 
-  mat4 camera_transform = camera->GetTransformMatrix();
+  mat4 camera_transform = camera.GetTransformMatrix();
   renderer->set_color(mathfu::kOnes4f);
   renderer->SetDepthFunction(fplbase::kDepthFunctionLess);
   renderer->set_model_view_projection(camera_transform);
 
-  world_->river_component.UpdateRiverMeshes();
-
-  if (world_->RenderingOptionEnabled(kShadowEffect)) {
-    world_->world_renderer->RenderShadowMap(*camera, *renderer, world_);
+  if (snapshot->rendering_options[kShadowEffect]) {
+    world_->world_renderer->RenderShadowMap(*snapshot, *renderer, world_);
   }
-  world_->world_renderer->RenderWorld(*camera, *renderer, world_);
+  world_->world_renderer->RenderWorld(*snapshot, camera, *renderer, world_);
 }
 
 void SceneLabState::HandleUI(fplbase::Renderer* renderer) {
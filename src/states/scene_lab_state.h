@@ -50,7 +50,9 @@ class SceneLabState : public StateNode {
                   scene_lab_corgi::CorgiAdapter* corgi_adapter, World* world);
 
   virtual void AdvanceFrame(int delta_time, int* next_state);
+  virtual void HandleInput(int* next_state);
   virtual void RenderPrep();
+  virtual void SaveInterpolationState();
   virtual void Render(fplbase::Renderer* renderer);
   virtual void HandleUI(fplbase::Renderer* renderer);
   virtual void OnEnter(int previous_state);
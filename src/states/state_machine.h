@@ -27,9 +27,20 @@ class StateNode {
   virtual ~StateNode() {}
 
   virtual void AdvanceFrame(int delta_time, int* next_state) = 0;
+  // Called once each time input is polled, before the updates for that
+  // frame, of which there may be any number. Handle presses, like
+  // went_down(), here instead of in AdvanceFrame() so each is seen once.
+  virtual void HandleInput(int* /*next_state*/) {}
   virtual void RenderPrep() {}
+  // Called before the last fixed-length update of a displayed frame, so that
+  // rendering can interpolate from the state before it.
+  virtual void SaveInterpolationState() {}
   virtual void Render(fplbase::Renderer* render) = 0;
   virtual void HandleUI(fplbase::Renderer* /*renderer*/) {}
+  // Return true if Render() only draws the world from the render snapshot, so
+  // it can run while the update thread advances the next frame. HandleUI()
+  // changes game state, so it still waits for that update to finish.
+  virtual bool RendersConcurrently() const { return false; }
   virtual void OnEnter(int /*previous_state*/) {}
   virtual void OnExit(int /*next_state*/) {}
 };
@@ -41,7 +52,7 @@ class StateMachine {
 
   // Initializes the StateMachine. You must call SetCurrentStateId to a valid
   // state before running AdvanceFrame or Render.
-  StateMachine() : current_state_id_(-1) {}
+  StateMachine() : current_state_id_(-1), render_state_id_(-1) {}
 
   StateNode* get_state(StateId state_id) { return &states_[state_id]; }
 
@@ -51,6 +62,15 @@ class StateMachine {
     states_[id] = state;
   }
 
+  // Handle the input polled for this frame on the current game state.
+  void HandleInput() {
+    if (valid_id(current_state_id_)) {
+      StateId new_id = current_state_id_;
+      states_[current_state_id_]->HandleInput(&new_id);
+      SetCurrentStateId(new_id);
+    }
+  }
+
   // Run the logic on the current game state.
   void AdvanceFrame(int delta_time) {
     if (valid_id(current_state_id_)) {
@@ -66,17 +86,35 @@ class StateMachine {
       states_[current_state_id_]->RenderPrep();
     }
   }
-  // Render the current game state.
-  void Render(fplbase::Renderer* renderer) {
+  // Choose the state that Render and HandleUI will draw. Call while the
+  // update thread is blocked, so that a state change made by a concurrent
+  // AdvanceFrame can't switch states part way through a frame.
+  void LatchRenderState() { render_state_id_ = current_state_id_; }
+
+  // Whether the latched state can render while the game updates.
+  bool RendersConcurrently() {
+    return valid_id(render_state_id_) &&
+           states_[render_state_id_]->RendersConcurrently();
+  }
+
+  // Save the current game state for render interpolation.
+  void SaveInterpolationState() {
     if (valid_id(current_state_id_)) {
-      states_[current_state_id_]->Render(renderer);
+      states_[current_state_id_]->SaveInterpolationState();
     }
   }
 
-  // Prepare to render the current game state.
+  // Render the latched game state.
+  void Render(fplbase::Renderer* renderer) {
+    if (valid_id(render_state_id_)) {
+      states_[render_state_id_]->Render(renderer);
+    }
+  }
+
+  // Handle the UI of the latched game state.
   void HandleUI(fplbase::Renderer* renderer) {
-    if (valid_id(current_state_id_)) {
-      states_[current_state_id_]->HandleUI(renderer);
+    if (valid_id(render_state_id_)) {
+      states_[render_state_id_]->HandleUI(renderer);
     }
   }
 
@@ -104,6 +142,7 @@ class StateMachine {
   bool valid_id(StateId id) { return id >= 0 && id < state_count_; }
 
   StateId current_state_id_;
+  StateId render_state_id_;
   StateNode* states_[state_count_];
 };
 
@@ -56,12 +56,14 @@ static void RenderSettingsGear(fplbase::Renderer& renderer, World* world) {
 #endif  // FPLBASE_ANDROID_VR
 
 static void RenderStereoscopic(fplbase::Renderer& renderer, World* world,
-                               Camera& camera, Camera* cardboard_camera,
+                               const RenderSnapshot& snapshot,
+                               Camera* cardboard_camera,
                                fplbase::InputSystem* input_system) {
 #if FPLBASE_ANDROID_VR
+  const Camera& camera = snapshot.camera;
   // Render shadow map before undistortion occurs.
-  if (world->RenderingOptionEnabled(kShadowEffect)) {
-    world->world_renderer->RenderShadowMap(camera, renderer, world);
+  if (snapshot.rendering_options[kShadowEffect]) {
+    world->world_renderer->RenderShadowMap(snapshot, renderer, world);
   }
   fplbase::HeadMountedDisplayViewSettings view_settings;
   HeadMountedDisplayRenderStart(input_system->head_mounted_display_input(),
@@ -86,42 +88,52 @@ static void RenderStereoscopic(fplbase::Renderer& renderer, World* world,
       1, camera.position() + corrected_translation_right);
   cardboard_camera->set_viewport(1, view_settings.viewport_extents[1]);
 
-  world->world_renderer->RenderWorld(*cardboard_camera, renderer, world);
+  world->world_renderer->RenderWorld(snapshot, *cardboard_camera, renderer,
+                                     world);
 
   HeadMountedDisplayRenderEnd(&renderer, true);
   RenderSettingsGear(renderer, world);
 #else
   (void)renderer;
   (void)world;
-  (void)camera;
+  (void)snapshot;
   (void)cardboard_camera;
   (void)input_system;
 #endif  // FPLBASE_ANDROID_VR
 }
 
-void RenderWorld(fplbase::Renderer& renderer, World* world, Camera& camera,
-                 Camera* cardboard_camera, fplbase::InputSystem* input_system) {
+const RenderSnapshot* RenderWorld(fplbase::Renderer& renderer, World* world,
+                                  Camera* cardboard_camera,
+                                  fplbase::InputSystem* input_system) {
+  RenderSnapshot* snapshot = world->world_renderer->AcquireSnapshot();
+  if (snapshot == nullptr) {
+    // Nothing has been prepared yet.
+    renderer.ClearFrameBuffer(mathfu::kZeros4f);
+    return nullptr;
+  }
+  Camera& camera = snapshot->camera;
   vec2 window_size = vec2(renderer.window_size());
-  world->river_component.UpdateRiverMeshes();
-  if (world->rendering_mode() == kRenderingStereoscopic) {
+  if (snapshot->rendering_mode == kRenderingStereoscopic) {
     window_size.x = window_size.x / 2;
     cardboard_camera->set_viewport_resolution(window_size);
   }
   camera.set_viewport_resolution(window_size);
-  if (world->rendering_mode() == kRenderingStereoscopic) {
+  if (snapshot->rendering_mode == kRenderingStereoscopic) {
     // This takes care of setting/clearing the framebuffer for us.
-    RenderStereoscopic(renderer, world, camera, cardboard_camera, input_system);
+    RenderStereoscopic(renderer, world, *snapshot, cardboard_camera,
+                       input_system);
   } else {
     // Always clear the framebuffer, even though we overwrite it with the
     // skybox, since it's a speedup on tile-based architectures, see .e.g.:
     // http://www.seas.upenn.edu/~pcozzi/OpenGLInsights/OpenGLInsights-TileBasedArchitectures.pdf
     renderer.ClearFrameBuffer(mathfu::kZeros4f);
 
-    if (world->RenderingOptionEnabled(kShadowEffect)) {
-      world->world_renderer->RenderShadowMap(camera, renderer, world);
+    if (snapshot->rendering_options[kShadowEffect]) {
+      world->world_renderer->RenderShadowMap(*snapshot, renderer, world);
     }
-    world->world_renderer->RenderWorld(camera, renderer, world);
+    world->world_renderer->RenderWorld(*snapshot, camera, renderer, world);
   }
+  return snapshot;
 }
 
 void UpdateMainCamera(Camera* main_camera, World* world) {
@@ -26,9 +26,13 @@ namespace zooshi {
 // Update the camera to the location of the player in the given world.
 void UpdateMainCamera(Camera* camera, World* world);
 
-// Render the world monoscopically or stereoscopically.
-void RenderWorld(fplbase::Renderer& renderer, World* world, Camera& camera,
-                 Camera* cardboard_camera, fplbase::InputSystem* input_system);
+// Render the world monoscopically or stereoscopically, from the latest
+// snapshot published by WorldRenderer::RenderPrep. Does not touch live entity
+// data, so it is safe to call while the update thread is running. Returns the
+// snapshot drawn, or nullptr if none has been published yet.
+const RenderSnapshot* RenderWorld(fplbase::Renderer& renderer, World* world,
+                                  Camera* cardboard_camera,
+                                  fplbase::InputSystem* input_system);
 
 }  // zooshi
 }  // fpl
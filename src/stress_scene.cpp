@@ -0,0 +1,360 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "stress_scene.h"
+
+#include <assert.h>
+#include <cmath>
+
+#include "components/lap_dependent.h"
+#include "config_generated.h"
+#include "fplbase/utilities.h"
+#include "mathfu/constants.h"
+#include "world.h"
+
+using corgi::component_library::PhysicsData;
+using corgi::component_library::TransformData;
+using mathfu::quat;
+using mathfu::vec3;
+
+namespace fpl {
+namespace zooshi {
+
+static const float kTwoPi = 6.28318531f;
+
+// Content at 1x, which is about what the endless level holds.
+static const int kPatronsPerScale = 40;
+static const int kSceneryPerScale = 160;
+static const int kRailDenizensPerScale = 8;
+static const int kLapDependentPerScale = 16;
+static const int kProjectilesPerScale = 16;
+
+// The rail is a wobbly loop about as long as the endless level's at 1x, and
+// is traversed in the same time. It grows with the scale, so the raft's speed
+// and the curvature of the rail stay the same.
+static const float kRailRadius = 80.0f;
+static const float kRailWobble = 0.15f;
+static const int kRailLobesPerScale = 3;
+static const int kRailNodesPerScale = 32;
+static const float kRailHeight = 2.0f;
+static const float kRailLapTime = 60000.0f;
+static const float kRailReliableDistance = 1.0f;
+
+// How far from the rail each kind of entity is placed, in meters, and how
+// high. The river banks rise away from the rail.
+static const float kPatronMinDistance = 9.0f;
+static const float kPatronMaxDistance = 12.0f;
+static const float kPatronHeight = 1.0f;
+static const float kSceneryMinDistance = 15.0f;
+static const float kSceneryMaxDistance = 40.0f;
+static const float kSceneryHeight = 3.0f;
+static const float kLapDependentMinDistance = 12.0f;
+static const float kLapDependentMaxDistance = 20.0f;
+static const float kLapDependentHeight = 2.0f;
+
+// Lap dependent props each show for one lap out of this many.
+static const int kLapDependentCycle = 4;
+
+// Sushi are thrown from up to this far from the raft, in any direction.
+static const float kProjectileLaunchDistance = 15.0f;
+static const float kProjectileLaunchHeight = 2.0f;
+static const float kProjectileMinSpeed = 8.0f;
+static const float kProjectileMaxSpeed = 16.0f;
+static const float kProjectileUpkick = 6.0f;
+
+static const unsigned int kRandomSeed = 123456789;
+
+static const char* kPatronPrototypes[] = {
+    "PatronHungryHippo", "PatronLadyMandrill", "PatronMoustacheCroc",
+    "PatronGiraffette", "PatronBankerBirdNoRail"};
+static const char* kSceneryPrototypes[] = {
+    "MidGroundTree", "SavannaTree", "RockSmallest", "RockShort",
+    "RockMid",       "FernShort",   "FernMid",      "GrassDense"};
+static const char* kRailNodePrototype = "RailNode";
+static const char* kRailDenizenPrototype = "RiverRail";
+static const char* kLapDependentPrototype = "RockMid_RenderMesh";
+
+template <typename C>
+static void DeleteEntitiesOf(C* component,
+                             corgi::EntityManager* entity_manager) {
+  for (auto iter = component->begin(); iter != component->end(); ++iter) {
+    if (!iter->entity->marked_for_deletion()) {
+      entity_manager->DeleteEntity(iter->entity);
+    }
+  }
+}
+
+StressSceneCounts StressSceneCounts::ForScale(int scale) {
+  StressSceneCounts counts;
+  counts.patrons = kPatronsPerScale * scale;
+  counts.scenery = kSceneryPerScale * scale;
+  counts.rail_denizens = kRailDenizensPerScale * scale;
+  counts.lap_dependent = kLapDependentPerScale * scale;
+  counts.projectiles = kProjectilesPerScale * scale;
+  return counts;
+}
+
+StressScene::StressScene(int scale)
+    : scale_(scale),
+      counts_(StressSceneCounts::ForScale(scale)),
+      random_(kRandomSeed) {
+  assert(scale > 0);
+}
+
+StressScene::StressScene(int scale, const StressSceneCounts& counts)
+    : scale_(scale), counts_(counts), random_(kRandomSeed) {
+  assert(scale > 0);
+  assert(counts.patrons >= 0 && counts.scenery >= 0 &&
+         counts.rail_denizens >= 0 && counts.lap_dependent >= 0 &&
+         counts.projectiles >= 0);
+}
+
+void StressScene::Load(World* world, const WorldDef* world_def) {
+  LoadWorldDefEntities(world, world_def);
+
+  // The river follows the raft's rail, so it names the rail to replace.
+  if (world->river_component.begin() == world->river_component.end()) {
+    fplbase::LogError("StressScene: the level has no river to follow.");
+    PostLoadWorldDef(world);
+    return;
+  }
+  const std::string rail_name = world->river_component.begin()->data.rail_name;
+
+  RemoveAuthoredContent(world, rail_name);
+  CreateRail(world, rail_name);
+  CreatePatrons(world);
+  CreateScenery(world);
+  CreateRailDenizens(world, rail_name);
+  CreateLapDependentProps(world);
+  PostLoadWorldDef(world);
+
+  // Nobody is going to feed the first patron, which is what usually starts
+  // the raft moving.
+  corgi::EntityRef raft = world->services_component.raft_entity();
+  RailDenizenData* raft_rail_denizen =
+      world->rail_denizen_component.GetComponentData(raft);
+  if (raft_rail_denizen != nullptr) {
+    raft_rail_denizen->SetPlaybackRate(1.0f, 0.0f);
+  }
+
+  projectiles_.clear();
+  fplbase::LogInfo(
+      "StressScene: %dx, %d patrons, %d scenery, %d rail denizens, "
+      "%d lap dependent props, %d projectiles",
+      scale_, counts_.patrons, counts_.scenery, counts_.rail_denizens,
+      counts_.lap_dependent, counts_.projectiles);
+}
+
+// Delete everything placed along the level's rail, and the rails themselves,
+// keeping only what rides the raft's rail.
+void StressScene::RemoveAuthoredContent(World* world,
+                                        const std::string& rail_name) {
+  corgi::EntityManager* entity_manager = &world->entity_manager;
+  DeleteEntitiesOf(&world->patron_component, entity_manager);
+  DeleteEntitiesOf(&world->scenery_component, entity_manager);
+  DeleteEntitiesOf(&world->lap_dependent_component, entity_manager);
+  DeleteEntitiesOf(&world->rail_node_component, entity_manager);
+  for (auto iter = world->rail_denizen_component.begin();
+       iter != world->rail_denizen_component.end(); ++iter) {
+    if (iter->data.rail_name != rail_name &&
+        !iter->entity->marked_for_deletion()) {
+      entity_manager->DeleteEntity(iter->entity);
+    }
+  }
+  entity_manager->DeleteMarkedEntities();
+}
+
+vec3 StressScene::RailPosition(float lap_progress) const {
+  const float angle = kTwoPi * lap_progress;
+  const float lobes = static_cast<float>(kRailLobesPerScale * scale_);
+  const float radius =
+      kRailRadius * scale_ * (1.0f + kRailWobble * std::sin(lobes * angle));
+  return vec3(radius * std::cos(angle), radius * std::sin(angle), kRailHeight);
+}
+
+// A point `distance` meters to the side of the rail, on the left when
+// positive.
+vec3 StressScene::BesideRail(float lap_progress, float distance,
+                             float height) const {
+  const float kTangentStep = 0.0001f;
+  const vec3 tangent =
+      RailPosition(lap_progress + kTangentStep) - RailPosition(lap_progress);
+  const vec3 side = vec3(-tangent.y, tangent.x, 0.0f).Normalized();
+  vec3 position = RailPosition(lap_progress) + distance * side;
+  position.z = height;
+  return position;
+}
+
+corgi::EntityRef StressScene::CreateEntity(World* world,
+                                           const char* prototype,
+                                           const vec3& position,
+                                           float face_angle) {
+  corgi::EntityRef entity = world->entity_factory->CreateEntityFromPrototype(
+      prototype, &world->entity_manager);
+  TransformData* transform_data =
+      world->transform_component.GetComponentData(entity);
+  transform_data->position = position;
+  transform_data->orientation =
+      quat::FromAngleAxis(face_angle, mathfu::kAxisZ3f);
+  return entity;
+}
+
+void StressScene::CreateRail(World* world, const std::string& rail_name) {
+  const int num_nodes = kRailNodesPerScale * scale_;
+  for (int i = 0; i < num_nodes; ++i) {
+    corgi::EntityRef node =
+        CreateEntity(world, kRailNodePrototype,
+                     RailPosition(static_cast<float>(i) / num_nodes), 0.0f);
+    world->entity_manager.AddEntityToComponent<RailNodeComponent>(node);
+    RailNodeData* rail_node_data =
+        world->rail_node_component.GetComponentData(node);
+    rail_node_data->rail_name = rail_name;
+    rail_node_data->ordering = static_cast<float>(i);
+    // The rail's timing is read from its first node.
+    if (i == 0) {
+      rail_node_data->total_time = kRailLapTime * scale_;
+      rail_node_data->reliable_distance = kRailReliableDistance;
+    }
+  }
+}
+
+void StressScene::CreatePatrons(World* world) {
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  const size_t num_prototypes = FPL_ARRAYSIZE(kPatronPrototypes);
+  for (int i = 0; i < counts_.patrons; ++i) {
+    const float lap_progress = (i + unit(random_)) / counts_.patrons;
+    const float side = i % 2 == 0 ? 1.0f : -1.0f;
+    const float distance =
+        kPatronMinDistance +
+        (kPatronMaxDistance - kPatronMinDistance) * unit(random_);
+    CreateEntity(world, kPatronPrototypes[i % num_prototypes],
+                 BesideRail(lap_progress, side * distance, kPatronHeight),
+                 kTwoPi * unit(random_));
+  }
+}
+
+void StressScene::CreateScenery(World* world) {
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  const size_t num_prototypes = FPL_ARRAYSIZE(kSceneryPrototypes);
+  for (int i = 0; i < counts_.scenery; ++i) {
+    const float lap_progress = (i + unit(random_)) / counts_.scenery;
+    const float side = i % 2 == 0 ? 1.0f : -1.0f;
+    const float distance =
+        kSceneryMinDistance +
+        (kSceneryMaxDistance - kSceneryMinDistance) * unit(random_);
+    CreateEntity(world, kSceneryPrototypes[i % num_prototypes],
+                 BesideRail(lap_progress, side * distance, kSceneryHeight),
+                 kTwoPi * unit(random_));
+  }
+}
+
+// Rail denizens ride the raft's rail, spread evenly around the lap.
+void StressScene::CreateRailDenizens(World* world,
+                                     const std::string& rail_name) {
+  for (int i = 0; i < counts_.rail_denizens; ++i) {
+    corgi::EntityRef denizen = world->entity_factory->CreateEntityFromPrototype(
+        kRailDenizenPrototype, &world->entity_manager);
+    RailDenizenData* rail_denizen_data =
+        world->rail_denizen_component.GetComponentData(denizen);
+    rail_denizen_data->rail_name = rail_name;
+    rail_denizen_data->start_time =
+        kRailLapTime * scale_ * i / counts_.rail_denizens;
+    rail_denizen_data->initial_playback_rate = 1.0f;
+  }
+}
+
+void StressScene::CreateLapDependentProps(World* world) {
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  for (int i = 0; i < counts_.lap_dependent; ++i) {
+    const float lap_progress = (i + unit(random_)) / counts_.lap_dependent;
+    const float side = i % 2 == 0 ? 1.0f : -1.0f;
+    const float distance =
+        kLapDependentMinDistance +
+        (kLapDependentMaxDistance - kLapDependentMinDistance) * unit(random_);
+    corgi::EntityRef prop = CreateEntity(
+        world, kLapDependentPrototype,
+        BesideRail(lap_progress, side * distance, kLapDependentHeight),
+        kTwoPi * unit(random_));
+    world->entity_manager.AddEntityToComponent<LapDependentComponent>(prop);
+    LapDependentData* lap_dependent_data =
+        world->lap_dependent_component.GetComponentData(prop);
+    lap_dependent_data->min_lap = static_cast<float>(i % kLapDependentCycle);
+    lap_dependent_data->max_lap = lap_dependent_data->min_lap + 1.0f;
+  }
+}
+
+void StressScene::LaunchProjectiles(World* world) {
+  PlayerProjectileComponent* projectile_component =
+      &world->player_projectile_component;
+
+  // Forget the sushi that have been caught or have expired.
+  size_t num_in_flight = 0;
+  for (size_t i = 0; i < projectiles_.size(); ++i) {
+    const corgi::EntityRef& projectile = projectiles_[i];
+    const PlayerProjectileData* projectile_data =
+        projectile ? projectile_component->GetComponentData(projectile)
+                   : nullptr;
+    if (projectile_data != nullptr && projectile_data->active) {
+      projectiles_[num_in_flight++] = projectile;
+    }
+  }
+  projectiles_.resize(num_in_flight);
+
+  corgi::EntityRef raft = world->services_component.raft_entity();
+  if (!raft) return;
+  const vec3 raft_position = world->transform_component.WorldPosition(raft);
+  const RailDenizenData* raft_rail_denizen =
+      world->rail_denizen_component.GetComponentData(raft);
+  const vec3 raft_velocity = raft_rail_denizen != nullptr
+                                 ? raft_rail_denizen->Velocity()
+                                 : mathfu::kZeros3f;
+  const SushiConfig* sushi =
+      static_cast<const SushiConfig*>(world->SelectedSushi()->data());
+
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  while (static_cast<int>(projectiles_.size()) < counts_.projectiles) {
+    corgi::EntityRef projectile =
+        projectile_component->AcquireProjectile(sushi->prototype()->c_str());
+
+    const float offset_angle = kTwoPi * unit(random_);
+    const float offset = kProjectileLaunchDistance * unit(random_);
+    TransformData* transform_data =
+        world->transform_component.GetComponentData(projectile);
+    transform_data->position =
+        raft_position +
+        vec3(offset * std::cos(offset_angle), offset * std::sin(offset_angle),
+             kProjectileLaunchHeight);
+
+    const float heading = kTwoPi * unit(random_);
+    const float speed =
+        kProjectileMinSpeed +
+        (kProjectileMaxSpeed - kProjectileMinSpeed) * unit(random_);
+    const vec3 velocity =
+        vec3(speed * std::cos(heading), speed * std::sin(heading),
+             kProjectileUpkick) +
+        raft_velocity;
+    PhysicsData* physics_data =
+        world->physics_component.GetComponentData(projectile);
+    physics_data->SetVelocity(velocity);
+    world->physics_component.UpdatePhysicsFromTransform(projectile);
+
+    projectile_component->GetComponentData(projectile)->owner =
+        world->active_player_entity;
+    projectiles_.push_back(projectile);
+  }
+}
+
+}  // zooshi
+}  // fpl
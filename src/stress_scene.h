@@ -0,0 +1,102 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef ZOOSHI_STRESS_SCENE_H_
+#define ZOOSHI_STRESS_SCENE_H_
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "corgi/entity_manager.h"
+#include "mathfu/glsl_mappings.h"
+
+namespace fpl {
+namespace zooshi {
+
+struct World;
+struct WorldDef;
+
+// How many of each kind of entity a stress scene holds.
+struct StressSceneCounts {
+  StressSceneCounts()
+      : patrons(0),
+        scenery(0),
+        rail_denizens(0),
+        lap_dependent(0),
+        projectiles(0) {}
+
+  // Counts at scale `scale`, which is `scale` times about what the endless
+  // level holds.
+  static StressSceneCounts ForScale(int scale);
+
+  int patrons;
+  int scenery;
+  int rail_denizens;
+  int lap_dependent;
+  int projectiles;
+};
+
+// A procedurally generated level, for measuring how the simulation's cost
+// grows with the amount of content in it.
+//
+// The player, raft and river come from the current level, but its rail and
+// everything placed along it are replaced. The rail becomes a generated loop,
+// and patrons, scenery, rail denizens and lap dependent props are created
+// from the entity library's prototypes and scattered along it. At scale `n`
+// the loop is `n` times as long. By default it holds `n` times as much of
+// everything, so the density of content the raft passes stays the same, but
+// the count of each kind of entity can be set separately.
+class StressScene {
+ public:
+  explicit StressScene(int scale);
+  StressScene(int scale, const StressSceneCounts& counts);
+
+  // Load the scene into `world`, in place of LoadWorldDef().
+  void Load(World* world, const WorldDef* world_def);
+
+  // Throw sushi from around the raft until `counts().projectiles` of the
+  // ones thrown are in flight. Call once per update.
+  void LaunchProjectiles(World* world);
+
+  int scale() const { return scale_; }
+  const StressSceneCounts& counts() const { return counts_; }
+
+ private:
+  void RemoveAuthoredContent(World* world, const std::string& rail_name);
+  void CreateRail(World* world, const std::string& rail_name);
+  void CreatePatrons(World* world);
+  void CreateScenery(World* world);
+  void CreateRailDenizens(World* world, const std::string& rail_name);
+  void CreateLapDependentProps(World* world);
+  corgi::EntityRef CreateEntity(World* world, const char* prototype,
+                                const mathfu::vec3& position,
+                                float face_angle);
+  mathfu::vec3 RailPosition(float lap_progress) const;
+  mathfu::vec3 BesideRail(float lap_progress, float distance,
+                          float height) const;
+
+  int scale_;
+  StressSceneCounts counts_;
+  std::mt19937 random_;
+
+  // Sushi thrown by LaunchProjectiles() that may still be in flight.
+  std::vector<corgi::EntityRef> projectiles_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_STRESS_SCENE_H_
@@ -0,0 +1,245 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Match the rest of the game, which compiles Systrace out on Android. See
+// game.h.
+#ifdef __ANDROID__
+#define FPLBASE_ENABLE_SYSTRACE 0
+#endif
+
+#include "trace.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SDL_thread.h"
+#include "allocation_tracker.h"
+#include "fplbase/debug_markers.h"
+#include "fplbase/systrace.h"
+#include "fplbase/utilities.h"
+
+using fplbase::LogError;
+using fplbase::LogInfo;
+
+namespace fpl {
+namespace zooshi {
+
+// Chrome trace event phases.
+enum TracePhase {
+  kTracePhaseBegin = 'B',
+  kTracePhaseEnd = 'E',
+  kTracePhaseAsyncBegin = 'b',
+  kTracePhaseAsyncEnd = 'e',
+  kTracePhaseCounter = 'C',
+  kTracePhaseInstant = 'i',
+};
+
+struct TraceEvent {
+  const char* name;
+  int64_t timestamp;  // In microseconds since TraceStart().
+  uint64_t thread_id;
+  int32_t value;  // Cookie for async events, value for counters.
+  char phase;
+};
+
+typedef std::chrono::steady_clock TraceClock;
+
+// Everything is static so that recording never has to check for an
+// uninitialized buffer, only the `enabled` flag.
+static std::vector<TraceEvent> trace_events;
+static std::atomic<uint64_t> trace_next_event(0);
+static std::atomic<bool> trace_enabled(false);
+static TraceClock::time_point trace_start_time;
+
+// Thread names are set rarely, so a lock is fine here.
+static std::mutex trace_thread_names_mutex;
+static std::vector<std::pair<uint64_t, std::string>> trace_thread_names;
+
+static void TraceRecord(TracePhase phase, const char* name, int32_t value) {
+  if (!trace_enabled.load(std::memory_order_acquire)) return;
+
+  const uint64_t index =
+      trace_next_event.fetch_add(1, std::memory_order_relaxed);
+  TraceEvent& event = trace_events[index % trace_events.size()];
+  event.name = name;
+  event.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+                        TraceClock::now() - trace_start_time).count();
+  event.thread_id = static_cast<uint64_t>(SDL_ThreadID());
+  event.value = value;
+  event.phase = static_cast<char>(phase);
+}
+
+void TraceStart(size_t capacity) {
+  assert(capacity > 0);
+  trace_enabled.store(false, std::memory_order_release);
+  trace_events.assign(capacity, TraceEvent());
+  trace_next_event.store(0, std::memory_order_relaxed);
+  trace_start_time = TraceClock::now();
+  trace_enabled.store(true, std::memory_order_release);
+}
+
+void TraceStop() { trace_enabled.store(false, std::memory_order_release); }
+
+bool TraceEnabled() { return trace_enabled.load(std::memory_order_relaxed); }
+
+void TraceSetThreadName(const char* name) {
+  AllocationSetThreadName(name);
+  const uint64_t thread_id = static_cast<uint64_t>(SDL_ThreadID());
+  std::lock_guard<std::mutex> lock(trace_thread_names_mutex);
+  for (auto it = trace_thread_names.begin(); it != trace_thread_names.end();
+       ++it) {
+    if (it->first == thread_id) {
+      it->second = name;
+      return;
+    }
+  }
+  trace_thread_names.push_back(std::make_pair(thread_id, std::string(name)));
+}
+
+// Write `str` as a JSON string, escaping the few characters that could
+// appear in a marker name.
+static void WriteJsonString(FILE* file, const char* str) {
+  fputc('"', file);
+  for (const char* c = str; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') fputc('\\', file);
+    fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+bool TraceWriteFile(const char* filename) {
+  FILE* file = fopen(filename, "w");
+  if (!file) {
+    LogError("Unable to open trace file %s for writing.", filename);
+    return false;
+  }
+
+  // If the buffer wrapped, the oldest surviving event is the one that will be
+  // overwritten next.
+  const uint64_t total = trace_next_event.load(std::memory_order_relaxed);
+  const uint64_t capacity = trace_events.size();
+  const uint64_t count = total < capacity ? total : capacity;
+  const uint64_t first = total - count;
+
+  // Chrome trace events only need a process id to group threads.
+  static const int kProcessId = 1;
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first_line = true;
+  {
+    std::lock_guard<std::mutex> lock(trace_thread_names_mutex);
+    for (auto it = trace_thread_names.begin(); it != trace_thread_names.end();
+         ++it) {
+      fprintf(file,
+              "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+              "\"tid\":%llu,\"args\":{\"name\":",
+              first_line ? "" : ",\n", kProcessId,
+              static_cast<unsigned long long>(it->first));
+      WriteJsonString(file, it->second.c_str());
+      fprintf(file, "}}");
+      first_line = false;
+    }
+  }
+
+  for (uint64_t i = first; i < total; ++i) {
+    const TraceEvent& event = trace_events[i % capacity];
+    fprintf(file, "%s{\"ph\":\"%c\",\"pid\":%d,\"tid\":%llu,\"ts\":%lld",
+            first_line ? "" : ",\n", event.phase, kProcessId,
+            static_cast<unsigned long long>(event.thread_id),
+            static_cast<long long>(event.timestamp));
+    first_line = false;
+    if (event.name) {
+      fprintf(file, ",\"name\":");
+      WriteJsonString(file, event.name);
+    }
+    switch (event.phase) {
+      case kTracePhaseAsyncBegin:
+      case kTracePhaseAsyncEnd:
+        fprintf(file, ",\"cat\":\"zooshi\",\"id\":%d", event.value);
+        break;
+      case kTracePhaseCounter:
+        fprintf(file, ",\"args\":{\"value\":%d}", event.value);
+        break;
+      case kTracePhaseInstant:
+        fprintf(file, ",\"s\":\"t\"");
+        break;
+      default:
+        break;
+    }
+    fprintf(file, "}");
+  }
+  fprintf(file, "\n]}\n");
+
+  const bool ok = ferror(file) == 0;
+  fclose(file);
+  if (ok) {
+    LogInfo("Wrote %llu trace events to %s",
+            static_cast<unsigned long long>(count), filename);
+  } else {
+    LogError("Error writing trace file %s.", filename);
+  }
+  return ok;
+}
+
+void TraceBegin(const char* name) {
+  SystraceBegin(name);
+  AllocationScopePush(name);
+  TraceRecord(kTracePhaseBegin, name, 0);
+}
+
+void TraceEnd() {
+  SystraceEnd();
+  AllocationScopePop();
+  TraceRecord(kTracePhaseEnd, nullptr, 0);
+}
+
+void TraceAsyncBegin(const char* name, int32_t cookie) {
+  SystraceAsyncBegin(name, cookie);
+  TraceRecord(kTracePhaseAsyncBegin, name, cookie);
+}
+
+void TraceAsyncEnd(const char* name, int32_t cookie) {
+  SystraceAsyncEnd(name, cookie);
+  TraceRecord(kTracePhaseAsyncEnd, name, cookie);
+}
+
+void TraceCounter(const char* name, int32_t value) {
+  SystraceCounter(name, value);
+  TraceRecord(kTracePhaseCounter, name, value);
+}
+
+void TraceInstant(const char* name) {
+  TraceRecord(kTracePhaseInstant, name, 0);
+}
+
+void TracePushMarker(const char* name) {
+  PushDebugMarker(name);
+  AllocationScopePush(name);
+  TraceRecord(kTracePhaseBegin, name, 0);
+}
+
+void TracePopMarker() {
+  PopDebugMarker();
+  AllocationScopePop();
+  TraceRecord(kTracePhaseEnd, nullptr, 0);
+}
+
+}  // zooshi
+}  // fpl
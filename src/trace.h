@@ -0,0 +1,89 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_TRACE_H_
+#define ZOOSHI_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Trace markers for profiling.
+//
+// Each of these forwards to the equivalent fplbase Systrace or debug marker
+// call, so they show up in Android systrace and GPU debuggers as before. In
+// addition, once TraceStart() has been called, every marker is recorded into
+// a fixed-size in-memory ring buffer that can be written out with
+// TraceWriteFile() in the Chrome trace event JSON format. That file can be
+// opened in chrome://tracing or the Perfetto UI, which is how we get traces
+// on desktop Linux where Systrace is unavailable.
+//
+// Recording costs one clock read and one atomic increment per event, and the
+// buffer never grows, so it is safe to leave on in release builds. When the
+// buffer is full the oldest events are overwritten.
+//
+// All `name` arguments must outlive the recording, since only the pointer is
+// stored. In practice they are string literals.
+
+namespace fpl {
+namespace zooshi {
+
+// 64k events is a little over a megabyte, which holds several seconds of
+// frames.
+static const size_t kDefaultTraceCapacity = 64 * 1024;
+
+// Begin recording markers into a ring buffer of `capacity` events. Any events
+// from a previous recording are discarded.
+void TraceStart(size_t capacity = kDefaultTraceCapacity);
+
+// Stop recording. The buffer is kept until the next TraceStart().
+void TraceStop();
+
+// Returns true between TraceStart() and TraceStop().
+bool TraceEnabled();
+
+// Write the buffered events to `filename` as Chrome trace event JSON. Should
+// be called after TraceStop(), since events being recorded concurrently may
+// be written half-formed.
+bool TraceWriteFile(const char* filename);
+
+// Label the calling thread in the trace and in the allocation stats. Call
+// once at the start of each thread, whether or not recording has started.
+void TraceSetThreadName(const char* name);
+
+// Synchronous slice on the calling thread. Calls must nest properly. Heap
+// allocations made inside the slice are attributed to it, see
+// allocation_tracker.h.
+void TraceBegin(const char* name);
+void TraceEnd();
+
+// Slice that may start and finish on different threads. `cookie` pairs the
+// begin with the end.
+void TraceAsyncBegin(const char* name, int32_t cookie);
+void TraceAsyncEnd(const char* name, int32_t cookie);
+
+// Plot `value` on a graph named `name`.
+void TraceCounter(const char* name, int32_t value);
+
+// A zero length event on the calling thread, e.g. a vsync.
+void TraceInstant(const char* name);
+
+// Render thread markers. These also push and pop GPU debug markers, so should
+// only be used where there is a current GL context.
+void TracePushMarker(const char* name);
+void TracePopMarker();
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_TRACE_H_
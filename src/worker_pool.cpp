@@ -0,0 +1,148 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "worker_pool.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <utility>
+
+#include "trace.h"
+
+namespace fpl {
+namespace zooshi {
+
+// Threads the game already keeps busy: the update thread, which takes part in
+// every batch, and the render thread.
+static const int kReservedThreads = 2;
+
+// More workers than this just contend for the same few components.
+static const int kMaxWorkerThreads = 6;
+
+WorkerPool::WorkerPool(int thread_count)
+    : task_(nullptr),
+      task_count_(0),
+      batch_(0),
+      batch_open_(false),
+      next_task_(0),
+      active_workers_(0),
+      quit_(false) {
+  assert(thread_count >= 0);
+  for (int i = 0; i < thread_count; ++i) {
+    threads_.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  work_ready_.notify_all();
+  for (auto it = threads_.begin(); it != threads_.end(); ++it) it->join();
+}
+
+int WorkerPool::DefaultThreadCount() {
+  // hardware_concurrency() is 0 when unknown, which leaves no workers.
+  const int cores = static_cast<int>(std::thread::hardware_concurrency());
+  return std::min(std::max(cores - kReservedThreads, 0), kMaxWorkerThreads);
+}
+
+void WorkerPool::ParallelFor(int count,
+                             const std::function<void(int)>& task) {
+  if (count <= 1 || threads_.empty()) {
+    for (int i = 0; i < count; ++i) task(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    task_count_ = count;
+    next_task_ = 0;
+    batch_open_ = true;
+    batch_++;
+  }
+  work_ready_.notify_all();
+
+  RunTasks();
+
+  // Every task has been claimed, so close the batch to latecomers and wait
+  // for the workers that joined it to finish theirs.
+  std::unique_lock<std::mutex> lock(mutex_);
+  batch_open_ = false;
+  work_done_.wait(lock, [this]() { return active_workers_ == 0; });
+  task_ = nullptr;
+}
+
+void WorkerPool::Post(std::function<void()> job) {
+  if (threads_.empty()) {
+    job();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(std::move(job));
+  }
+  work_ready_.notify_one();
+}
+
+void WorkerPool::WorkerLoop() {
+  TraceSetThreadName("Zooshi Worker Thread");
+  int last_batch = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    work_ready_.wait(lock, [this, last_batch]() {
+      return quit_ || (batch_open_ && batch_ != last_batch) || !jobs_.empty();
+    });
+
+    // Batches come first, since the update thread is waiting on them.
+    if (batch_open_ && batch_ != last_batch) {
+      last_batch = batch_;
+      active_workers_++;
+
+      lock.unlock();
+      RunTasks();
+      lock.lock();
+
+      if (--active_workers_ == 0) work_done_.notify_one();
+      continue;
+    }
+
+    // Queued jobs are still run when quitting, so nothing posted is dropped.
+    if (!jobs_.empty()) {
+      std::function<void()> job = std::move(jobs_.front());
+      jobs_.pop_front();
+
+      lock.unlock();
+      job();
+      lock.lock();
+      continue;
+    }
+
+    if (quit_) return;
+  }
+}
+
+void WorkerPool::RunTasks() {
+  for (;;) {
+    const int index = next_task_.fetch_add(1);
+    if (index >= task_count_) return;
+    (*task_)(index);
+  }
+}
+
+}  // zooshi
+}  // fpl
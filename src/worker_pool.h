@@ -0,0 +1,90 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_WORKER_POOL_H_
+#define ZOOSHI_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fpl {
+namespace zooshi {
+
+// A fixed set of threads that help the calling thread run a batch of
+// independent tasks. The caller always takes part, so a pool with no threads
+// just runs every task on the caller.
+//
+// Only one thread may submit batches at a time. Background jobs may be posted
+// from any thread; idle workers pick them up between batches.
+class WorkerPool {
+ public:
+  // Start `thread_count` worker threads.
+  explicit WorkerPool(int thread_count);
+  ~WorkerPool();
+
+  // Call task(i) for every i in [0, count), spread over the workers and the
+  // calling thread, and return once all of them have finished.
+  void ParallelFor(int count, const std::function<void(int)>& task);
+
+  // Run `job` on a worker once one is free, and return without waiting for
+  // it. A worker busy with a job sits out any batches until it's done, so
+  // long jobs don't hold up ParallelFor(). With no workers, `job` is run
+  // before returning.
+  void Post(std::function<void()> job);
+
+  int thread_count() const { return static_cast<int>(threads_.size()); }
+
+  // Number of worker threads to use alongside the game's update and render
+  // threads on this device.
+  static int DefaultThreadCount();
+
+ private:
+  void WorkerLoop();
+
+  // Run tasks from the current batch until there are none left to claim.
+  void RunTasks();
+
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable work_done_;
+
+  // The current batch. `batch_` changes every time a batch is submitted, so
+  // workers can tell a new batch from one they've already run. Workers only
+  // join a batch while it's open.
+  const std::function<void(int)>* task_;
+  int task_count_;
+  int batch_;
+  bool batch_open_;
+  std::atomic<int> next_task_;
+
+  // Workers that joined the current batch and are still running its tasks.
+  int active_workers_;
+
+  // Background jobs waiting for a free worker.
+  std::deque<std::function<void()>> jobs_;
+
+  bool quit_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_WORKER_POOL_H_
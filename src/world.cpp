@@ -37,6 +37,9 @@
 #include "fplbase/renderer_hmd.h"
 #endif
 
+using corgi::component_library::AnimationComponent;
+using corgi::component_library::RenderMeshComponent;
+using corgi::component_library::TransformComponent;
 using scene_lab::SceneLab;
 using mathfu::vec2i;
 using mathfu::vec2;
@@ -53,6 +56,102 @@ static const char kEntityLibraryFile[] = "entity_prototypes.zooentity";
 static const char kComponentDefBinarySchema[] =
     "flatbufferschemas/components.bfbs";
 
+template <typename T>
+void World::RegisterComponent(T* component, ComponentDataUnion data_type,
+                              const char* table_name) {
+  entity_factory->SetComponentType(entity_manager.RegisterComponent(component),
+                                   data_type, table_name);
+  component_scheduler.AddComponent(component, table_name);
+}
+
+// The access mask bit for the data of component `T`.
+template <typename T>
+static ComponentAccess::Mask DataOf() {
+  return ComponentAccess::Bit(T::GetComponentId());
+}
+
+// The access mask bit for shared system `system`.
+static ComponentAccess::Mask Uses(SharedSystem system) {
+  return ComponentAccess::Bit(system);
+}
+
+void World::DeclareComponentAccess() {
+  // Components whose updates do nothing.
+  component_scheduler.SkipUpdates(&services_component);
+  component_scheduler.SkipUpdates(&attributes_component);
+  component_scheduler.SkipUpdates(&rail_node_component);
+  component_scheduler.SkipUpdates(&render_3d_text_component);
+  component_scheduler.SkipUpdates(&light_component);
+
+  // Everything not declared below keeps exclusive access, because it creates
+  // or deletes entities, broadcasts events, or calls into physics, rendering
+  // or Scene Lab. Patrons do all of those when they are fed, so they are
+  // left exclusive too.
+  //
+  // Conflicts are tracked per type of data, not per entity, so updates that
+  // write TransformData are never run together. That rules out pairing simple
+  // movement and shadow controller, and rail denizens and scenery. The
+  // animation component advances the motive engine, so it runs apart from
+  // every update that reads a motivator.
+  //
+  // Rail denizens leave their lap events and interpolation snaps for
+  // FinishUpdate(), which runs on the update thread after their wave.
+  component_scheduler.SetAccess(
+      &rail_denizen_component,
+      ComponentAccess(DataOf<ServicesComponent>() |
+                          DataOf<RailDenizenComponent>() |
+                          Uses(kSharedSystemMotiveEngine),
+                      DataOf<RailDenizenComponent>() |
+                          DataOf<TransformComponent>()));
+  component_scheduler.SetFinish(&rail_denizen_component, [this]() {
+    rail_denizen_component.FinishUpdate();
+  });
+  component_scheduler.SetAccess(
+      &simple_movement_component,
+      ComponentAccess(DataOf<SimpleMovementComponent>(),
+                      DataOf<TransformComponent>()));
+
+  // The audio listener and sound both call into the audio engine, which isn't
+  // thread safe, so they run one after the other. The river only reads the
+  // raft's playback rate, so it can run alongside them.
+  component_scheduler.SetAccess(
+      &audio_listener_component,
+      ComponentAccess(DataOf<AudioListenerComponent>() |
+                          DataOf<TransformComponent>(),
+                      Uses(kSharedSystemAudioEngine)));
+  component_scheduler.SetAccess(
+      &sound_component,
+      ComponentAccess(
+          DataOf<SoundComponent>() | DataOf<TransformComponent>(),
+          Uses(kSharedSystemAudioEngine)));
+  component_scheduler.SetAccess(
+      &river_component,
+      ComponentAccess(DataOf<ServicesComponent>() |
+                          DataOf<RailDenizenComponent>() |
+                          Uses(kSharedSystemMotiveEngine),
+                      DataOf<RiverComponent>()));
+  component_scheduler.SetAccess(
+      &shadow_controller_component,
+      ComponentAccess(0, DataOf<ShadowControllerComponent>() |
+                             DataOf<TransformComponent>()));
+
+  // Scenery shows, hides and animates its render children, and starts
+  // motivators to turn towards the raft.
+  component_scheduler.SetAccess(
+      &scenery_component,
+      ComponentAccess(DataOf<ServicesComponent>() |
+                          DataOf<RailDenizenComponent>(),
+                      DataOf<SceneryComponent>() |
+                          DataOf<TransformComponent>() |
+                          DataOf<RenderMeshComponent>() |
+                          DataOf<AnimationComponent>() |
+                          Uses(kSharedSystemMotiveEngine)));
+  component_scheduler.SetAccess(
+      &animation_component,
+      ComponentAccess(0, DataOf<AnimationComponent>() |
+                             Uses(kSharedSystemMotiveEngine)));
+}
+
 void World::Initialize(
     const Config& config_, fplbase::InputSystem* input_system,
     fplbase::AssetManager* asset_mgr, WorldRenderer* worldrenderer,
@@ -84,82 +183,67 @@ void World::Initialize(
                                 audio_engine, font_manager, &rail_manager,
                                 entity_factory.get(), this, scene_lab);
 
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&common_services_component),
-      ComponentDataUnion_ServicesDef, "corgi.CommonServicesDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&services_component),
-      ComponentDataUnion_ServicesDef, "corgi.ServicesDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&graph_component),
-      ComponentDataUnion_corgi_GraphDef, "corgi.GraphDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&attributes_component),
-      ComponentDataUnion_AttributesDef, "fpl.AttributesDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&rail_denizen_component),
-      ComponentDataUnion_RailDenizenDef, "fpl.RailDenizenDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&simple_movement_component),
-      ComponentDataUnion_SimpleMovementDef, "fpl.SimpleMovementDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&lap_dependent_component),
-      ComponentDataUnion_LapDependentDef, "fpl.LapDependentDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&player_component),
-      ComponentDataUnion_PlayerDef, "fpl.PlayerDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&player_projectile_component),
-      ComponentDataUnion_PlayerProjectileDef, "fpl.PlayerProjectileDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&render_mesh_component),
-      ComponentDataUnion_corgi_RenderMeshDef, "corgi.RenderMeshDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&physics_component),
-      ComponentDataUnion_corgi_PhysicsDef, "corgi.PhysicsDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&patron_component),
-      ComponentDataUnion_PatronDef, "fpl.PatronDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&time_limit_component),
-      ComponentDataUnion_TimeLimitDef, "fpl.TimeLimitDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&audio_listener_component),
-      ComponentDataUnion_ListenerDef, "fpl.ListenerDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&sound_component),
-      ComponentDataUnion_SoundDef, "fpl.SoundDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&river_component),
-      ComponentDataUnion_RiverDef, "fpl.RiverDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&shadow_controller_component),
-      ComponentDataUnion_ShadowControllerDef, "fpl.ShadowControllerDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&meta_component),
-      ComponentDataUnion_corgi_MetaDef, "corgi.MetaDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&edit_options_component),
-      ComponentDataUnion_scene_lab_EditOptionsDef, "scene_lab.EditOptionsDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&scenery_component),
-      ComponentDataUnion_SceneryDef, "fpl.SceneryDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&animation_component),
-      ComponentDataUnion_corgi_AnimationDef, "corgi.AnimationDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&rail_node_component),
-      ComponentDataUnion_RailNodeDef, "fpl.RailNodeDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&render_3d_text_component),
-      ComponentDataUnion_Render3dTextDef, "fpl.Render3dTextDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&light_component),
-      ComponentDataUnion_LightDef, "fpl.LightDef");
+  RegisterComponent(&common_services_component, ComponentDataUnion_ServicesDef,
+                    "corgi.CommonServicesDef");
+  RegisterComponent(&services_component, ComponentDataUnion_ServicesDef,
+                    "corgi.ServicesDef");
+  RegisterComponent(&graph_component, ComponentDataUnion_corgi_GraphDef,
+                    "corgi.GraphDef");
+  RegisterComponent(&attributes_component, ComponentDataUnion_AttributesDef,
+                    "fpl.AttributesDef");
+  RegisterComponent(&rail_denizen_component, ComponentDataUnion_RailDenizenDef,
+                    "fpl.RailDenizenDef");
+  RegisterComponent(&simple_movement_component,
+                    ComponentDataUnion_SimpleMovementDef,
+                    "fpl.SimpleMovementDef");
+  RegisterComponent(&lap_dependent_component,
+                    ComponentDataUnion_LapDependentDef, "fpl.LapDependentDef");
+  RegisterComponent(&player_component, ComponentDataUnion_PlayerDef,
+                    "fpl.PlayerDef");
+  RegisterComponent(&player_projectile_component,
+                    ComponentDataUnion_PlayerProjectileDef,
+                    "fpl.PlayerProjectileDef");
+  RegisterComponent(&render_mesh_component,
+                    ComponentDataUnion_corgi_RenderMeshDef,
+                    "corgi.RenderMeshDef");
+  RegisterComponent(&physics_component, ComponentDataUnion_corgi_PhysicsDef,
+                    "corgi.PhysicsDef");
+  RegisterComponent(&patron_component, ComponentDataUnion_PatronDef,
+                    "fpl.PatronDef");
+  RegisterComponent(&time_limit_component, ComponentDataUnion_TimeLimitDef,
+                    "fpl.TimeLimitDef");
+  RegisterComponent(&audio_listener_component, ComponentDataUnion_ListenerDef,
+                    "fpl.ListenerDef");
+  RegisterComponent(&sound_component, ComponentDataUnion_SoundDef,
+                    "fpl.SoundDef");
+  RegisterComponent(&river_component, ComponentDataUnion_RiverDef,
+                    "fpl.RiverDef");
+  RegisterComponent(&shadow_controller_component,
+                    ComponentDataUnion_ShadowControllerDef,
+                    "fpl.ShadowControllerDef");
+  RegisterComponent(&meta_component, ComponentDataUnion_corgi_MetaDef,
+                    "corgi.MetaDef");
+  RegisterComponent(&edit_options_component,
+                    ComponentDataUnion_scene_lab_EditOptionsDef,
+                    "scene_lab.EditOptionsDef");
+  RegisterComponent(&scenery_component, ComponentDataUnion_SceneryDef,
+                    "fpl.SceneryDef");
+  RegisterComponent(&animation_component, ComponentDataUnion_corgi_AnimationDef,
+                    "corgi.AnimationDef");
+  RegisterComponent(&rail_node_component, ComponentDataUnion_RailNodeDef,
+                    "fpl.RailNodeDef");
+  RegisterComponent(&render_3d_text_component,
+                    ComponentDataUnion_Render3dTextDef, "fpl.Render3dTextDef");
+  RegisterComponent(&light_component, ComponentDataUnion_LightDef,
+                    "fpl.LightDef");
   // Make sure you register TransformComponent after any components that use it.
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&transform_component),
-      ComponentDataUnion_corgi_TransformDef, "corgi.TransformDef");
+  RegisterComponent(&transform_component, ComponentDataUnion_corgi_TransformDef,
+                    "corgi.TransformDef");
+  DeclareComponentAccess();
+
+  const int update_threads = config->component_update_threads();
+  component_scheduler.SetWorkerThreadCount(
+      update_threads >= 0 ? update_threads : WorkerPool::DefaultThreadCount());
 
   physics_component.set_collision_callback(&PatronComponent::CollisionHandler,
                                            &patron_component);
@@ -193,6 +277,10 @@ void World::Initialize(
       config->rendering_config()->apply_specular_by_default_cardboard();
 }
 
+void World::UpdateComponents(corgi::WorldTime delta_time) {
+  component_scheduler.UpdateComponents(&entity_manager, delta_time);
+}
+
 void World::AddController(BasePlayerController* controller) {
   input_controllers.push_back(
       std::unique_ptr<BasePlayerController>(controller));
@@ -265,6 +353,21 @@ bool World::RenderingOptionEnabled(RenderingMode rendering_mode,
 }
 
 void LoadWorldDef(World* world, const WorldDef* world_def) {
+  LoadWorldDefEntities(world, world_def);
+  PostLoadWorldDef(world);
+}
+
+// Load the entities in `filename`. The components' decoded definitions are
+// forgotten afterwards, since the file's own definitions may not outlive the
+// load. Those from the entity library are decoded again on next use.
+static void LoadEntityFile(World* world, const char* filename) {
+  world->entity_factory->LoadEntitiesFromFile(filename,
+                                              &world->entity_manager);
+  world->patron_component.ClearCompiledDefs();
+  world->rail_denizen_component.ClearCompiledDefs();
+}
+
+void LoadWorldDefEntities(World* world, const WorldDef* world_def) {
   for (auto iter = world->entity_manager.begin();
        iter != world->entity_manager.end(); ++iter) {
     world->entity_manager.DeleteEntity(iter.ToReference());
@@ -274,18 +377,18 @@ void LoadWorldDef(World* world, const WorldDef* world_def) {
   for (size_t i = 0; i < world_def->entity_files()->size(); i++) {
     flatbuffers::uoffset_t index = static_cast<flatbuffers::uoffset_t>(i);
     const char* filename = world_def->entity_files()->Get(index)->c_str();
-    world->entity_factory->LoadEntitiesFromFile(filename,
-                                                &world->entity_manager);
+    LoadEntityFile(world, filename);
   }
   const LevelDef* level_def = world_def->levels()->Get(
     static_cast<flatbuffers::uoffset_t>(world->level_index));
   for (size_t i = 0; i < level_def->entity_files()->size(); i++) {
     const char* filename = level_def->entity_files()->Get(
       static_cast<flatbuffers::uoffset_t>(i))->c_str();
-    world->entity_factory->LoadEntitiesFromFile(filename,
-                                                &world->entity_manager);
+    LoadEntityFile(world, filename);
   }
+}
 
+void PostLoadWorldDef(World* world) {
   world->SetActiveController(kControllerDefault);
   world->active_player_entity = world->player_component.begin()->entity;
 
@@ -302,6 +405,15 @@ void LoadWorldDef(World* world, const WorldDef* world_def) {
   world->services_component.set_raft_entity(raft_entity);
 
   world->graph_component.PostLoadFixup();
+
+  // Create the projectiles up front, now that the graphs are set up.
+  auto sushi_config = world->config->sushi_config();
+  for (flatbuffers::uoffset_t i = 0; i < sushi_config->size(); ++i) {
+    const SushiConfig* sushi =
+        static_cast<const SushiConfig*>(sushi_config->Get(i)->data());
+    world->player_projectile_component.Preallocate(
+        sushi->prototype()->c_str(), world->config->projectile_pool_size());
+  }
 }
 
 }  // zooshi
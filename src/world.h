@@ -19,6 +19,8 @@
 #include <memory>
 #include <string>
 
+#include "component_profiler.h"
+#include "component_scheduler.h"
 #include "components/attributes.h"
 #include "components/audio_listener.h"
 #include "components/lap_dependent.h"
@@ -77,29 +79,14 @@ class AssetManager;
 
 namespace zooshi {
 
-// The #defines that can be applied to a shader.
-enum ShaderDefines {
-  kPhongShading,
-  kSpecularEffect,
-  kShadowEffect,
-  kNormalMaps,
-  kNumShaderDefines
-};
-
-// Different rendering modes can have different values for shader defines.
-enum RenderingMode {
-  kRenderingMonoscopic,
-  kRenderingStereoscopic,
-  kNumRenderingModes
-};
-
 class WorldRenderer;
 struct Config;
 
 struct World {
  public:
   World()
-      : draw_debug_physics(false),
+      : component_scheduler(&component_profiler),
+        draw_debug_physics(false),
         skip_rendermesh_rendering(false),
         is_single_stepping(false),
         sushi_index(0),
@@ -123,9 +110,21 @@ struct World {
                   fplbase::Renderer* renderer, scene_lab::SceneLab* scene_lab,
                   UnlockableManager* unlockable_mgr, XpSystem* xp_system);
 
+  // Update all components and delete entities marked for deletion. Use this
+  // instead of entity_manager.UpdateComponents() so that components are
+  // updated by `component_scheduler`, and timed by `component_profiler`.
+  void UpdateComponents(corgi::WorldTime delta_time);
+
   // Entity manager
   corgi::EntityManager entity_manager;
 
+  // Times the update of each component registered in Initialize().
+  ComponentProfiler component_profiler;
+
+  // Updates the components registered in Initialize(), running those whose
+  // updates don't conflict at the same time.
+  ComponentScheduler component_scheduler;
+
   // Entity factory, for creating entities from data.
   std::unique_ptr<corgi::component_library::EntityFactory> entity_factory;
 
@@ -267,6 +266,16 @@ struct World {
   size_t level_index;
 
  private:
+  // Register `component` with the entity manager and the entity factory, and
+  // add it to the component scheduler.
+  template <typename T>
+  void RegisterComponent(T* component, ComponentDataUnion data_type,
+                         const char* table_name);
+
+  // Tell the component scheduler which components' updates can run at the
+  // same time.
+  void DeclareComponentAccess();
+
   // Determines if the game is in Cardboard mode (for special rendering).
   RenderingMode rendering_mode_;
 
@@ -283,6 +292,13 @@ struct World {
 // up the player's controller to the player entity.
 void LoadWorldDef(World* world, const WorldDef* world_def);
 
+// The two halves of LoadWorldDef(), for callers that edit the loaded entities
+// before they're hooked up to each other. PostLoadWorldDef() links parents
+// and children, sets up the components' entities, and finds the player and
+// raft.
+void LoadWorldDefEntities(World* world, const WorldDef* world_def);
+void PostLoadWorldDef(World* world);
+
 }  // zooshi
 }  // fpl
 
@@ -14,15 +14,20 @@
 
 #include "world_renderer.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "components/light.h"
 #include "components/services.h"
+#include "corgi_component_library/animation.h"
 #include "corgi_component_library/transform.h"
-#include "fplbase/debug_markers.h"
 #include "fplbase/flatbuffer_utils.h"
 #include "motive/math/angle.h"
+#include "trace.h"
 
 using mathfu::vec2i;
 using mathfu::vec2;
+using mathfu::vec4i;
 using mathfu::vec3;
 using mathfu::vec4;
 using mathfu::mat3;
@@ -33,7 +38,9 @@ using motive::kDegreesToRadians;
 namespace fpl {
 namespace zooshi {
 
+using corgi::component_library::AnimationData;
 using corgi::component_library::RenderMeshComponent;
+using corgi::component_library::RenderMeshData;
 using corgi::component_library::TransformData;
 using corgi::EntityRef;
 
@@ -53,29 +60,109 @@ static_assert(FPL_ARRAYSIZE(kDefinesText) == kNumShaderDefines,
 
 const char *kEmptyString = "";
 
+// Meshes are culled against a view cone whose apex is pulled this far behind
+// the camera, so that large objects at the edge of the view aren't dropped.
+// Matches the culling in corgi's RenderMeshComponent.
+static const float kFrustumOffset = 50.0f;
+
+static bool NearToFar(const RenderSnapshotDraw &a,
+                      const RenderSnapshotDraw &b) {
+  return a.z_depth < b.z_depth;
+}
+
+// Axis aligned bounds, in world space, of the box between `min` and `max`
+// after it has been transformed by `transform`.
+static void TransformBounds(const mat4 &transform, const vec3 &min,
+                            const vec3 &max, vec3 *world_min,
+                            vec3 *world_max) {
+  const vec3 center = transform * ((min + max) * 0.5f);
+  const vec3 half_size = (max - min) * 0.5f;
+  vec3 world_half_size;
+  for (int i = 0; i < 3; ++i) {
+    world_half_size[i] = fabs(transform(i, 0)) * half_size.x +
+                         fabs(transform(i, 1)) * half_size.y +
+                         fabs(transform(i, 2)) * half_size.z;
+  }
+  *world_min = center - world_half_size;
+  *world_max = center + world_half_size;
+}
+
+// Whether any of the box between `min` and `max` might be inside the frustum
+// of `view_projection`. Each clip plane is the last row of the matrix plus or
+// minus one of the others, and the box is outside if the corner furthest
+// along a plane's normal is still behind it.
+static bool BoundsInFrustum(const mat4 &view_projection, const vec3 &min,
+                            const vec3 &max) {
+  const mat4 &m = view_projection;
+  for (int row = 0; row < 3; ++row) {
+    for (float sign = -1.0f; sign <= 1.0f; sign += 2.0f) {
+      const vec4 plane(m(3, 0) + sign * m(row, 0), m(3, 1) + sign * m(row, 1),
+                       m(3, 2) + sign * m(row, 2), m(3, 3) + sign * m(row, 3));
+      const vec3 corner(plane.x >= 0.0f ? max.x : min.x,
+                        plane.y >= 0.0f ? max.y : min.y,
+                        plane.z >= 0.0f ? max.z : min.z);
+      if (vec3::DotProduct(plane.xyz(), corner) + plane.w < 0.0f) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Whether `camera`, or either eye of a stereo camera, might see the bounds.
+static bool BoundsInView(const corgi::CameraInterface &camera,
+                         const vec3 &min, const vec3 &max) {
+  const int num_views = camera.IsStereo() ? 2 : 1;
+  for (int i = 0; i < num_views; ++i) {
+    if (BoundsInFrustum(camera.GetTransformMatrix(i), min, max)) return true;
+  }
+  return false;
+}
+
+static Camera InterpolateCamera(const Camera &from, const Camera &to,
+                                float t) {
+  Camera camera = to;
+  camera.set_position(vec3::Lerp(from.position(), to.position(), t));
+  camera.set_facing(vec3::Lerp(from.facing(), to.facing(), t).Normalized());
+  camera.set_up(vec3::Lerp(from.up(), to.up(), t).Normalized());
+  return camera;
+}
+
+static bool FarToNear(const RenderSnapshotDraw &a,
+                      const RenderSnapshotDraw &b) {
+  return a.z_depth > b.z_depth;
+}
+
 void WorldRenderer::Initialize(World *world) {
   int shadow_map_resolution =
       world->config->rendering_config()->shadow_map_resolution();
   shadow_map_.Initialize(
       mathfu::vec2i(shadow_map_resolution, shadow_map_resolution));
 
-  RefreshGlobalShaderDefines(world);
+  bool rendering_options[kNumShaderDefines];
+  for (int s = 0; s < kNumShaderDefines; ++s) {
+    rendering_options[s] =
+        world->RenderingOptionEnabled(static_cast<ShaderDefines>(s));
+  }
+  RefreshGlobalShaderDefines(rendering_options, world);
+  world->ResetRenderingDirty();
+  shader_defines_version_ = rendering_options_version_;
 }
 
-void WorldRenderer::RefreshGlobalShaderDefines(World *world) {
+void WorldRenderer::RefreshGlobalShaderDefines(const bool *rendering_options,
+                                               World *world) {
   std::vector<std::string> defines_to_add;
   std::vector<std::string> defines_to_omit;
   for (int s = 0; s < kNumShaderDefines; ++s) {
-    ShaderDefines shader_define = static_cast<ShaderDefines>(s);
-    if (!world->RenderingOptionEnabled(shader_define)) {
-      defines_to_omit.push_back(kDefinesText[shader_define]);
+    if (!rendering_options[s]) {
+      defines_to_omit.push_back(kDefinesText[s]);
     }
   }
 
   world->asset_manager->ResetGlobalShaderDefines(defines_to_add,
                                                  defines_to_omit);
 
-  PushDebugMarker("ShaderCompile");
+  TracePushMarker("ShaderCompile");
 
   depth_shader_ = world->asset_manager->FindShader("shaders/render_depth");
   depth_skinned_shader_ =
@@ -86,29 +173,27 @@ void WorldRenderer::RefreshGlobalShaderDefines(World *world) {
   depth_skinned_shader_->ReloadIfDirty();
   textured_shader_->ReloadIfDirty();
 
-  PopDebugMarker();  // ShaderCompile
+  TracePopMarker();  // ShaderCompile
+}
 
-  world->ResetRenderingDirty();
+void WorldRenderer::RefreshShaderDefinesForSnapshot(
+    const RenderSnapshot &snapshot, World *world) {
+  if (snapshot.rendering_options_version == shader_defines_version_) return;
+  RefreshGlobalShaderDefines(snapshot.rendering_options, world);
+  shader_defines_version_ = snapshot.rendering_options_version;
 }
 
-void WorldRenderer::CreateShadowMap(const corgi::CameraInterface &camera,
+void WorldRenderer::CreateShadowMap(const RenderSnapshot &snapshot,
                                     fplbase::Renderer &renderer, World *world) {
-  PushDebugMarker("CreateShadowMap");
+  TracePushMarker("CreateShadowMap");
 
-  PushDebugMarker("Setup");
+  TracePushMarker("Setup");
   float shadow_map_resolution = static_cast<float>(
       world->config->rendering_config()->shadow_map_resolution());
   float shadow_map_zoom = world->config->rendering_config()->shadow_map_zoom();
   float shadow_map_offset =
       world->config->rendering_config()->shadow_map_offset();
-  LightComponent *light_component =
-      world->entity_manager.GetComponent<LightComponent>();
-
-  const EntityRef &main_light_entity = light_component->begin()->entity;
-  const TransformData *light_transform =
-      world->entity_manager.GetComponentData<TransformData>(main_light_entity);
-  vec3 light_position = light_transform->position;
-  SetLightPosition(light_position);
+  SetLightPosition(snapshot.shadow_light_position);
 
   float viewport_angle =
       world->config->rendering_config()->shadow_map_viewport_angle() *
@@ -116,6 +201,7 @@ void WorldRenderer::CreateShadowMap(const corgi::CameraInterface &camera,
   light_camera_.set_viewport_angle(viewport_angle / shadow_map_zoom);
   light_camera_.set_viewport_resolution(
       vec2(shadow_map_resolution, shadow_map_resolution));
+  const Camera &camera = snapshot.camera;
   vec3 light_camera_focus =
       camera.position() + camera.facing() * shadow_map_offset;
   light_camera_focus.z = 0;
@@ -132,22 +218,279 @@ void WorldRenderer::CreateShadowMap(const corgi::CameraInterface &camera,
   depth_skinned_shader_->Set(renderer);
   // Generate the shadow map:
   // TODO - modify this so that shadowcast is its own render pass
-  PopDebugMarker(); // Setup
+  TracePopMarker(); // Setup
 
   for (int pass = 0; pass < corgi::RenderPass_Count; pass++) {
-    PushDebugMarker("RenderPass");
-    world->render_mesh_component.RenderPass(pass, light_camera_, renderer,
-                                            ShaderIndex_Depth);
-    PopDebugMarker();
+    TracePushMarker("RenderPass");
+    RenderPass(snapshot, pass, light_camera_, renderer, ShaderIndex_Depth);
+    TracePopMarker();
   }
 
   fplbase::RenderTarget::ScreenRenderTarget(renderer).SetAsRenderTarget();
-  PopDebugMarker(); // CreateShadowMap
+  TracePopMarker(); // CreateShadowMap
+}
+
+void WorldRenderer::SaveInterpolationState(const Camera &camera,
+                                           World *world) {
+  TracePushMarker("SaveInterpolationState");
+  previous_camera_ = camera;
+  has_previous_camera_ = true;
+  interpolation_save_count_++;
+
+  corgi::EntityManager &entity_manager = world->entity_manager;
+  RenderMeshComponent &render_mesh_component = world->render_mesh_component;
+  for (auto iter = render_mesh_component.begin();
+       iter != render_mesh_component.end(); ++iter) {
+    const RenderMeshData *rendermesh_data =
+        entity_manager.GetComponentData<RenderMeshData>(iter->entity);
+    const TransformData *transform_data =
+        entity_manager.GetComponentData<TransformData>(iter->entity);
+    const size_t index = iter->entity.index();
+    if (index >= previous_transforms_.size()) {
+      previous_transforms_.resize(index + 1);
+    }
+    PreviousTransform &previous = previous_transforms_[index];
+    previous.world_transform = transform_data->world_transform;
+    previous.mesh = rendermesh_data->mesh;
+    previous.save_count = interpolation_save_count_;
+    previous.discontinuous = false;
+  }
+  TracePopMarker();  // SaveInterpolationState
+}
+
+void WorldRenderer::SnapInterpolation(const corgi::EntityRef &entity,
+                                      World *world) {
+  const size_t index = entity.index();
+  if (index < previous_transforms_.size()) {
+    previous_transforms_[index].discontinuous = true;
+  }
+
+  // Children move with their parent, and are often the ones with the meshes.
+  const TransformData *transform_data =
+      world->entity_manager.GetComponentData<TransformData>(entity);
+  if (transform_data != nullptr) {
+    for (auto iter = transform_data->children.begin();
+         iter != transform_data->children.end(); ++iter) {
+      SnapInterpolation(iter->owner, world);
+    }
+  }
 }
 
-void WorldRenderer::RenderPrep(const corgi::CameraInterface &camera,
-                               World *world) {
-  world->render_mesh_component.RenderPrep(camera);
+void WorldRenderer::RenderPrep(const Camera &current_camera, World *world,
+                               const FullScreenFader *fader) {
+  TracePushMarker("RenderPrep");
+  RenderSnapshot &snapshot = snapshots_.back();
+  snapshot.Clear();
+
+  // Blend from the state before the last update towards the current one.
+  // Updates are short enough that lerping the matrices is indistinguishable
+  // from decomposing and slerping them.
+  const bool interpolate = interpolation_ < 1.0f && has_previous_camera_;
+  const float t = interpolation_;
+  snapshot.camera =
+      interpolate ? InterpolateCamera(previous_camera_, current_camera, t)
+                  : current_camera;
+  const Camera &camera = snapshot.camera;
+
+  corgi::EntityManager &entity_manager = world->entity_manager;
+  const float max_cos = cos(camera.viewport_angle());
+  const vec3 camera_position = camera.position();
+  const vec3 camera_facing = camera.facing().Normalized();
+  const float cull_distance =
+      world->config->rendering_config()->cull_distance();
+  const float cull_distance_squared = cull_distance * cull_distance;
+
+  // Cull and gather the meshes the same way RenderMeshComponent::RenderPrep
+  // does, but copy out what RenderPass needs instead of referencing entities.
+  RenderMeshComponent &render_mesh_component = world->render_mesh_component;
+  for (auto iter = render_mesh_component.begin();
+       iter != render_mesh_component.end(); ++iter) {
+    const RenderMeshData *rendermesh_data =
+        entity_manager.GetComponentData<RenderMeshData>(iter->entity);
+    if (!rendermesh_data->visible || rendermesh_data->mesh == nullptr) {
+      continue;
+    }
+    const TransformData *transform_data =
+        entity_manager.GetComponentData<TransformData>(iter->entity);
+    mat4 entity_transform = transform_data->world_transform;
+    if (interpolate) {
+      const size_t index = iter->entity.index();
+      if (index < previous_transforms_.size()) {
+        const PreviousTransform &previous = previous_transforms_[index];
+        if (previous.save_count == interpolation_save_count_ &&
+            previous.mesh == rendermesh_data->mesh &&
+            !previous.discontinuous) {
+          entity_transform = previous.world_transform * (1.0f - t) +
+                             entity_transform * t;
+        }
+      }
+    }
+    const vec3 entity_position = entity_transform.TranslationVector3D();
+    float z_depth = (entity_position - camera_position).LengthSquared();
+
+    if ((rendermesh_data->culling_mask & (1 << corgi::CullingTest_ViewAngle)) &&
+        vec3::DotProduct((entity_position - camera_position +
+                          camera_facing * kFrustumOffset).Normalized(),
+                         camera_facing) < max_cos) {
+      continue;
+    }
+    if ((rendermesh_data->culling_mask & (1 << corgi::CullingTest_Distance)) &&
+        z_depth > cull_distance_squared) {
+      continue;
+    }
+
+    RenderSnapshotDraw draw;
+    fplbase::Mesh *mesh = rendermesh_data->mesh;
+    draw.mesh = mesh;
+    for (int i = 0; i < ShaderIndex_Count; ++i) {
+      draw.shaders[i] = static_cast<size_t>(i) < rendermesh_data->shaders.size()
+                            ? rendermesh_data->shaders[i]
+                            : nullptr;
+    }
+    draw.tint = rendermesh_data->tint;
+
+    // River chunks are culled against their bounds when they are drawn, once
+    // the camera is final, and sorted by where they are rather than by where
+    // the river entity is.
+    const RiverChunkBounds *chunk_bounds =
+        world->river_component.ChunkBounds(iter->entity, mesh);
+    draw.has_bounds = chunk_bounds != nullptr;
+    if (draw.has_bounds) {
+      TransformBounds(entity_transform, vec3(chunk_bounds->min_position),
+                      vec3(chunk_bounds->max_position), &draw.bounds_min,
+                      &draw.bounds_max);
+      const vec3 center = (draw.bounds_min + draw.bounds_max) * 0.5f;
+      z_depth = (center - camera_position).LengthSquared();
+    }
+    draw.z_depth = z_depth;
+    draw.bone_offset = static_cast<int>(snapshot.bones.size());
+    draw.bone_count = 0;
+
+    // Apply animations, as RenderMeshComponent::RenderPass would.
+    const AnimationData *anim_data =
+        entity_manager.GetComponentData<AnimationData>(iter->entity);
+    const bool has_anim = anim_data != nullptr && anim_data->motivator.Valid();
+    const int num_mesh_bones = mesh->num_bones();
+    const int num_anim_bones =
+        has_anim ? anim_data->motivator.DefiningAnim()->NumBones() : 0;
+    const bool has_one_bone_anim =
+        has_anim && (num_mesh_bones <= 1 || num_anim_bones == 1);
+    draw.world_transform =
+        has_one_bone_anim
+            ? entity_transform *
+                  mat4::FromAffineTransform(
+                      anim_data->motivator.GlobalTransforms()[0])
+            : entity_transform;
+
+    // If the mesh has a skeleton, capture the bone positions. They normally
+    // come from the animation, but if not, use the mesh's default pose.
+    if (num_mesh_bones > 1) {
+      const bool use_default_pose =
+          num_anim_bones != num_mesh_bones || rendermesh_data->default_pose;
+      const mathfu::AffineTransform *bone_transforms =
+          use_default_pose ? mesh->bone_global_transforms()
+                           : anim_data->motivator.GlobalTransforms();
+      draw.bone_count = rendermesh_data->num_shader_transforms;
+      snapshot.bones.resize(draw.bone_offset + draw.bone_count);
+      mesh->GatherShaderTransforms(bone_transforms,
+                                   &snapshot.bones[draw.bone_offset]);
+    }
+
+    for (int pass = 0; pass < corgi::RenderPass_Count; ++pass) {
+      if (rendermesh_data->pass_mask & (1 << pass)) {
+        snapshot.passes[pass].push_back(draw);
+      }
+    }
+  }
+  RenderSnapshot::DrawList &opaque = snapshot.passes[corgi::RenderPass_Opaque];
+  std::sort(opaque.begin(), opaque.end(), NearToFar);
+  RenderSnapshot::DrawList &alpha = snapshot.passes[corgi::RenderPass_Alpha];
+  std::sort(alpha.begin(), alpha.end(), FarToNear);
+
+  Render3dTextComponent &text_component = world->render_3d_text_component;
+  for (auto iter = text_component.begin(); iter != text_component.end();
+       ++iter) {
+    const RenderMeshData *rendermesh_data =
+        entity_manager.GetComponentData<RenderMeshData>(iter->entity);
+    if (rendermesh_data == nullptr || !rendermesh_data->visible) continue;
+    snapshot.texts.push_back(RenderSnapshotText());
+    RenderSnapshotText &text = snapshot.texts.back();
+    text.model = text_component.CalculateModelTransform(iter->entity);
+    text.data = *text_component.GetComponentData(iter->entity);
+  }
+
+  LightComponent *light_component =
+      entity_manager.GetComponent<LightComponent>();
+  const EntityRef &main_light_entity = light_component->begin()->entity;
+  snapshot.light =
+      *entity_manager.GetComponentData<LightData>(main_light_entity);
+  snapshot.shadow_light_position =
+      entity_manager.GetComponentData<TransformData>(main_light_entity)
+          ->position;
+  snapshot.mesh_light_position = render_mesh_component.light_position();
+  snapshot.river_offset = world->river_component.river_offset();
+
+  // Copy the switches that rendering reads, since updates change them while
+  // the render thread draws.
+  if (world->RenderingOptionsDirty()) {
+    rendering_options_version_++;
+    world->ResetRenderingDirty();
+  }
+  snapshot.rendering_mode = world->rendering_mode();
+  for (int s = 0; s < kNumShaderDefines; ++s) {
+    snapshot.rendering_options[s] =
+        world->RenderingOptionEnabled(static_cast<ShaderDefines>(s));
+  }
+  snapshot.rendering_options_version = rendering_options_version_;
+  snapshot.skip_rendermesh_rendering = world->skip_rendermesh_rendering;
+  snapshot.draw_debug_physics = world->draw_debug_physics;
+  snapshot.fader =
+      fader != nullptr ? fader->GetState() : FullScreenFaderState();
+
+  snapshots_.Publish();
+  TracePopMarker();  // RenderPrep
+}
+
+void WorldRenderer::RenderPass(const RenderSnapshot &snapshot, int pass,
+                               const corgi::CameraInterface &camera,
+                               fplbase::Renderer &renderer, int shader_index) {
+  const RenderSnapshot::DrawList &draws = snapshot.passes[pass];
+  for (auto iter = draws.begin(); iter != draws.end(); ++iter) {
+    const RenderSnapshotDraw &draw = *iter;
+    fplbase::Shader *shader = draw.shaders[shader_index];
+    if (shader == nullptr) continue;
+    if (draw.has_bounds &&
+        !BoundsInView(camera, draw.bounds_min, draw.bounds_max)) {
+      continue;
+    }
+
+    const mat4 world_matrix_inverse = draw.world_transform.Inverse();
+    renderer.set_light_pos(world_matrix_inverse *
+                           snapshot.mesh_light_position);
+    renderer.set_color(draw.tint);
+    renderer.set_model(draw.world_transform);
+    if (draw.bone_count > 0) {
+      renderer.SetBoneTransforms(&snapshot.bones[draw.bone_offset],
+                                 draw.bone_count);
+    }
+
+    if (!camera.IsStereo()) {
+      renderer.set_camera_pos(world_matrix_inverse * camera.position());
+      renderer.set_model_view_projection(camera.GetTransformMatrix() *
+                                         draw.world_transform);
+      shader->Set(renderer);
+      draw.mesh->Render(renderer);
+    } else {
+      const vec4i viewport[] = {camera.viewport(0), camera.viewport(1)};
+      const mat4 mvp[] = {camera.GetTransformMatrix(0) * draw.world_transform,
+                          camera.GetTransformMatrix(1) * draw.world_transform};
+      const vec3 camera_position[] = {
+          world_matrix_inverse * camera.position(0),
+          world_matrix_inverse * camera.position(1)};
+      draw.mesh->RenderStereo(renderer, shader, viewport, mvp,
+                              camera_position);
+    }
+  }
 }
 
 // Draw the shadow map in the world, so we can see it.
@@ -188,52 +531,45 @@ void WorldRenderer::SetFogUniforms(fplbase::Shader *shader, World *world) {
                      world->config->rendering_config()->fog_max_saturation());
 }
 
-void WorldRenderer::SetLightingUniforms(fplbase::Shader *shader, World *world) {
-  LightComponent *light_component =
-      world->entity_manager.GetComponent<LightComponent>();
-  const EntityRef &main_light_entity = light_component->begin()->entity;
-  const LightData *light_data =
-      world->entity_manager.GetComponentData<LightData>(main_light_entity);
-
-  if (world->RenderingOptionEnabled(kShadowEffect)) {
-    shader->SetUniform("shadow_intensity", light_data->shadow_intensity);
+void WorldRenderer::SetLightingUniforms(fplbase::Shader *shader,
+                                        const RenderSnapshot &snapshot) {
+  const LightData &light_data = snapshot.light;
+  if (snapshot.rendering_options[kShadowEffect]) {
+    shader->SetUniform("shadow_intensity", light_data.shadow_intensity);
   }
   shader->SetUniform("ambient_material",
-                     light_data->ambient_color * light_data->ambient_intensity);
+                     light_data.ambient_color * light_data.ambient_intensity);
   shader->SetUniform("diffuse_material",
-                     light_data->diffuse_color * light_data->diffuse_intensity);
-  shader->SetUniform("specular_material", light_data->specular_color *
-                                              light_data->specular_intensity);
-  shader->SetUniform("shininess", light_data->specular_exponent);
+                     light_data.diffuse_color * light_data.diffuse_intensity);
+  shader->SetUniform("specular_material", light_data.specular_color *
+                                              light_data.specular_intensity);
+  shader->SetUniform("shininess", light_data.specular_exponent);
 }
 
-void WorldRenderer::RenderShadowMap(const corgi::CameraInterface &camera,
+void WorldRenderer::RenderShadowMap(const RenderSnapshot &snapshot,
                                     fplbase::Renderer &renderer, World *world) {
-  PushDebugMarker("Render ShadowMap");
+  TracePushMarker("Render ShadowMap");
 
-  PushDebugMarker("Scene Setup");
-  if (world->RenderingOptionsDirty()) {
-    RefreshGlobalShaderDefines(world);
-  }
+  TracePushMarker("Scene Setup");
+  RefreshShaderDefinesForSnapshot(snapshot, world);
 
   float shadow_map_bias = world->config->rendering_config()->shadow_map_bias();
   depth_shader_->SetUniform("bias", shadow_map_bias);
   depth_skinned_shader_->SetUniform("bias", shadow_map_bias);
-  PopDebugMarker(); // Scene Setup
+  TracePopMarker(); // Scene Setup
 
-  CreateShadowMap(camera, renderer, world);
+  CreateShadowMap(snapshot, renderer, world);
 
-  PopDebugMarker(); // Render ShadowMap
+  TracePopMarker(); // Render ShadowMap
 }
 
-void WorldRenderer::RenderWorld(const corgi::CameraInterface &camera,
+void WorldRenderer::RenderWorld(const RenderSnapshot &snapshot,
+                                const corgi::CameraInterface &camera,
                                 fplbase::Renderer &renderer, World *world) {
-  PushDebugMarker("Render World");
+  TracePushMarker("Render World");
 
-  PushDebugMarker("Scene Setup");
-  if (world->RenderingOptionsDirty()) {
-    RefreshGlobalShaderDefines(world);
-  }
+  TracePushMarker("Scene Setup");
+  RefreshShaderDefinesForSnapshot(snapshot, world);
 
   mat4 camera_transform = camera.GetTransformMatrix();
   renderer.set_color(mathfu::kOnes4f);
@@ -242,9 +578,9 @@ void WorldRenderer::RenderWorld(const corgi::CameraInterface &camera,
 
   float texture_repeats =
       world->CurrentLevel()->river_config()->texture_repeats();
-  float river_offset = world->river_component.river_offset();
+  float river_offset = snapshot.river_offset;
 
-  if (world->RenderingOptionEnabled(kShadowEffect)) {
+  if (snapshot.rendering_options[kShadowEffect]) {
     world->asset_manager->ForEachShaderWithDefine(
         kDefinesText[kShadowEffect], [&](fplbase::Shader *shader) {
           shader->SetUniform("view_projection", camera_transform);
@@ -261,34 +597,44 @@ void WorldRenderer::RenderWorld(const corgi::CameraInterface &camera,
 
   world->asset_manager->ForEachShaderWithDefine(
       kDefinesText[kPhongShading],
-      [&](fplbase::Shader *shader) { SetLightingUniforms(shader, world); });
+      [&](fplbase::Shader *shader) {
+        SetLightingUniforms(shader, snapshot);
+      });
 
   world->asset_manager->ForEachShaderWithDefine(
       "FOG_EFFECT",
       [&](fplbase::Shader *shader) { SetFogUniforms(shader, world); });
 
   shadow_map_.BindAsTexture(kShadowMapTextureID);
-  PopDebugMarker(); // Scene Setup
+  TracePopMarker(); // Scene Setup
 
-  if (!world->skip_rendermesh_rendering) {
+  if (!snapshot.skip_rendermesh_rendering) {
     for (int pass = 0; pass < corgi::RenderPass_Count; pass++) {
-      PushDebugMarker("RenderPass");
-      world->render_mesh_component.RenderPass(pass, camera, renderer);
-      PopDebugMarker();
+      TracePushMarker("RenderPass");
+      RenderPass(snapshot, pass, camera, renderer, ShaderIndex_Lit);
+      TracePopMarker();
     }
   }
 
-  if (world->draw_debug_physics) {
-    PushDebugMarker("Debug Draw World");
+  // Unlike everything else here, this reads the live physics world, so the
+  // game only renders concurrently with updates while it is turned off. A
+  // snapshot only asks for it once the update that turned it on is done, and
+  // the next update waits for this frame.
+  if (snapshot.draw_debug_physics) {
+    TracePushMarker("Debug Draw World");
     world->physics_component.DebugDrawWorld(&renderer, camera_transform);
-    PopDebugMarker();
+    TracePopMarker();
   }
 
-  PushDebugMarker("Text");
-  world->render_3d_text_component.RenderAllEntities(camera);
-  PopDebugMarker();
+  TracePushMarker("Text");
+  for (auto iter = snapshot.texts.begin(); iter != snapshot.texts.end();
+       ++iter) {
+    world->render_3d_text_component.RenderText(
+        camera_transform * iter->model, iter->data);
+  }
+  TracePopMarker();
 
-  PopDebugMarker(); // Render World
+  TracePopMarker(); // Render World
 }
 
 }  // zooshi
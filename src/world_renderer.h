@@ -15,6 +15,11 @@
 #ifndef ZOOSHI_WORLD_RENDERER_H_
 #define ZOOSHI_WORLD_RENDERER_H_
 
+#include <vector>
+
+#include "camera.h"
+#include "mathfu/utilities.h"
+#include "render_snapshot.h"
 #include "world.h"
 
 namespace fpl {
@@ -25,25 +30,58 @@ struct World;
 // Class that performs various rendering functions on a world state.
 class WorldRenderer {
  public:
+  WorldRenderer()
+      : interpolation_(1.0f),
+        interpolation_save_count_(0),
+        has_previous_camera_(false),
+        rendering_options_version_(0),
+        shader_defines_version_(0) {}
+
   // Initialize the world renderer.  Must be called before any other functions.
   void Initialize(World* world);
 
-  // Refresh global shader defines with current rendering options.
-  void RefreshGlobalShaderDefines(World* world);
+  // Call this from the update thread once the world has been updated. It
+  // culls and sorts the world as seen from the camera, and publishes
+  // everything RenderShadowMap and RenderWorld need as a snapshot for the
+  // render thread, along with `fader`, if there is one.
+  void RenderPrep(const Camera& current_camera, World* world,
+                  const FullScreenFader* fader = nullptr);
+
+  // With fixed-length updates, call this from the update thread just before
+  // the last update of a displayed frame. RenderPrep then draws the world
+  // part way between the state saved here and the state after the update.
+  void SaveInterpolationState(const Camera& camera, World* world);
+
+  // Draw `entity` and its children where they are now in the next RenderPrep,
+  // instead of blending from where they were when the state was saved. Call
+  // from the update thread when an entity jumps, so that it isn't drawn
+  // sweeping across the jump.
+  void SnapInterpolation(const corgi::EntityRef& entity, World* world);
+
+  // How far real time has run past the last update, as a fraction of an
+  // update. RenderPrep blends from the state saved by SaveInterpolationState
+  // to the current state by this much. 1, the default, renders the current
+  // state as is.
+  void set_interpolation(float interpolation) {
+    interpolation_ = interpolation;
+  }
+  float interpolation() const { return interpolation_; }
 
-  // Call this before you call RenderWorld - it takes care of clearing
-  // the frame, setting up the shadowmap, etc.
-  void RenderPrep(const corgi::CameraInterface& camera,
-                  World* world);
+  // Switch to the most recently published snapshot, and return it. Returns
+  // nullptr if RenderPrep has not been called yet. The snapshot belongs to the
+  // render thread until the next call, so it can be read, and its camera
+  // adjusted, without holding the update lock.
+  RenderSnapshot* AcquireSnapshot() { return snapshots_.AcquireFront(); }
 
-  // Render the shadowmap from the current camera.
-  void RenderShadowMap(const corgi::CameraInterface& camera,
+  // Render the shadowmap for a snapshot.
+  void RenderShadowMap(const RenderSnapshot& snapshot,
                        fplbase::Renderer& renderer, World* world);
 
-  // Render the world, viewed from the current camera.
-  void RenderWorld(const corgi::CameraInterface& camera,
-                   fplbase::Renderer& renderer,
-                   World* world);
+  // Render a snapshot of the world, viewed from `camera`. This is usually the
+  // snapshot's own camera, or a stereo camera derived from it.
+  void RenderWorld(const RenderSnapshot& snapshot,
+                   const corgi::CameraInterface& camera,
+                   fplbase::Renderer& renderer, World* world);
 
   // Render the shadowmap into the world as a billboard, for debugging.
   void DebugShowShadowMap(const corgi::CameraInterface& camera,
@@ -61,15 +99,55 @@ class WorldRenderer {
   fplbase::Shader* textured_shader_;
   Camera light_camera_;
   fplbase::RenderTarget shadow_map_;
+  RenderSnapshotBuffer snapshots_;
+
+  // A mesh's world transform, saved by SaveInterpolationState. Indexed by
+  // entity index. Only valid if `save_count` matches the latest save, and
+  // the entity still has the same mesh, so that entities created since the
+  // save are not blended with whatever used their index before. Also not
+  // valid if the entity has jumped since the save.
+  struct PreviousTransform {
+    mathfu::mat4 world_transform;
+    const fplbase::Mesh* mesh;
+    int save_count;
+    bool discontinuous;
+  };
+  std::vector<PreviousTransform, mathfu::simd_allocator<PreviousTransform>>
+      previous_transforms_;
+  Camera previous_camera_;
+  float interpolation_;
+  int interpolation_save_count_;
+  bool has_previous_camera_;
+
+  // Counts changes to the world's rendering options, on the update thread,
+  // and the count the shaders were last built for, on the render thread.
+  int rendering_options_version_;
+  int shader_defines_version_;
+
+  // Rebuild the shaders with the rendering options in `rendering_options`,
+  // indexed by ShaderDefines.
+  void RefreshGlobalShaderDefines(const bool* rendering_options,
+                                  World* world);
+
+  // Rebuild the shaders if the snapshot's rendering options have changed
+  // since they were last built. Render thread only.
+  void RefreshShaderDefinesForSnapshot(const RenderSnapshot& snapshot,
+                                       World* world);
 
   // Create the shadowmap for the current worldstate.  Needs to be called
   // before RenderWorld.
-  void CreateShadowMap(const corgi::CameraInterface& camera,
+  void CreateShadowMap(const RenderSnapshot& snapshot,
                        fplbase::Renderer& renderer, World* world);
 
+  // Draw one render pass of a snapshot, with the given ShaderIndex.
+  void RenderPass(const RenderSnapshot& snapshot, int pass,
+                  const corgi::CameraInterface& camera,
+                  fplbase::Renderer& renderer, int shader_index);
+
   void SetFogUniforms(fplbase::Shader* shader, World* world);
 
-  void SetLightingUniforms(fplbase::Shader* shader, World* world);
+  void SetLightingUniforms(fplbase::Shader* shader,
+                           const RenderSnapshot& snapshot);
 };
 
 }  // zooshi